@@ -0,0 +1,473 @@
+#include "benchmarks.h"
+#include "envfs.h"
+#include "glob_matching.h"
+#include "pluginarchives.h"
+#include "shared/directoryentry.h"
+#include "shared/fileentry.h"
+#include "shared/fileregister.h"
+#include "thread_utils.h"
+#include <utility.h>
+#include <atomic>
+#include <chrono>
+#include <format>
+
+#include <QRegularExpression>
+
+namespace benchmarks
+{
+
+using namespace MOBase;
+using namespace MOShared;
+using Clock = std::chrono::steady_clock;
+
+// runs f() and returns how long it took, in milliseconds
+//
+template <class F>
+double timed(F&& f)
+{
+  const auto start = Clock::now();
+  f();
+  const auto end = Clock::now();
+
+  return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+// runs f(threadIndex) in the given number of threads and waits for all of them
+//
+template <class F>
+void inThreads(std::size_t count, F&& f)
+{
+  std::vector<std::thread> threads;
+
+  for (std::size_t i = 0; i < count; ++i) {
+    threads.push_back(startSafeThread([&f, i] {
+      f(i);
+    }));
+  }
+
+  for (auto& t : threads) {
+    t.join();
+  }
+}
+
+// threads to use for scaling benchmarks: 1, 2, 4, ..., max
+//
+std::vector<std::size_t> threadSteps(std::size_t max)
+{
+  std::vector<std::size_t> v;
+
+  for (std::size_t n = 1; n < max; n *= 2) {
+    v.push_back(n);
+  }
+
+  v.push_back(std::max<std::size_t>(max, 1));
+
+  return v;
+}
+
+// creates files in a FileRegister from several threads, then reads all of them
+// back from the same number of threads
+//
+void fileRegister(const Options& o, std::ostream& out)
+{
+  const std::size_t count = (o.count > 0 ? o.count : 1'000'000);
+
+  out << "inserting " << count << " files in the register\n";
+
+  for (const auto threads : threadSteps(o.threads)) {
+    DirectoryEntry root(L"data", nullptr, 0);
+    auto fileRegister = root.getFileRegister();
+
+    const std::size_t perThread = count / threads;
+
+    const double insert = timed([&] {
+      inThreads(threads, [&](std::size_t t) {
+        DirectoryStats stats;
+
+        for (std::size_t i = 0; i < perThread; ++i) {
+          fileRegister->createFile(
+              StringPool::instance().intern(std::format(L"file_{}_{}.dds", t, i)),
+              &root, stats);
+        }
+      });
+    });
+
+    std::atomic<std::size_t> found = 0;
+
+    const double lookup = timed([&] {
+      inThreads(threads, [&](std::size_t t) {
+        const auto highest = fileRegister->highestCount();
+        std::size_t n      = 0;
+
+        for (std::size_t i = t; i < highest; i += threads) {
+          if (fileRegister->fileAt(static_cast<FileIndex>(i))) {
+            ++n;
+          }
+        }
+
+        found += n;
+      });
+    });
+
+    out << std::format("  {:>3} threads: insert {:>9.2f} ms, lookup {:>9.2f} ms "
+                       "({} files)\n",
+                       threads, insert, lookup, found.load());
+  }
+}
+
+// current or peak working set of this process, in bytes
+//
+std::size_t workingSet(bool peak)
+{
+  PROCESS_MEMORY_COUNTERS pmc = {};
+  pmc.cb                      = sizeof(pmc);
+
+  if (!GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) {
+    return 0;
+  }
+
+  return (peak ? pmc.PeakWorkingSetSize : pmc.WorkingSetSize);
+}
+
+std::string megabytes(std::size_t bytes)
+{
+  return std::format("{:.1f} MB", bytes / (1024.0 * 1024.0));
+}
+
+// relative path of the synthetic file with the given id
+//
+std::wstring syntheticPath(std::size_t id)
+{
+  return std::format(L"meshes\\group_{}\\sub_{}\\file_{}.nif", id / 10000,
+                     id / 200, id);
+}
+
+// builds a directory structure out of synthetic mods that all have the same
+// layout; half of the files of each mod overwrite files from the previous one
+//
+void directoryTree(const Options& o, std::ostream& out)
+{
+  const std::size_t count  = (o.count > 0 ? o.count : 500'000);
+  const std::size_t mods   = 100;
+  const std::size_t perMod = std::max<std::size_t>(count / mods, 1);
+
+  const auto before = workingSet(false);
+
+  DirectoryEntry root(L"data", nullptr, 0);
+  std::size_t unique = 0;
+
+  const double build = timed([&] {
+    for (std::size_t m = 0; m < mods; ++m) {
+      env::Directory modRoot;
+      auto* top = &modRoot.dirs.emplace_back(L"Meshes");
+
+      env::Directory* group = nullptr;
+      env::Directory* sub   = nullptr;
+
+      for (std::size_t i = 0; i < perMod; ++i) {
+        const std::size_t id = m * perMod / 2 + i;
+
+        if (!group || i == 0 || id % 10000 == 0) {
+          group = &top->dirs.emplace_back(std::format(L"Group_{}", id / 10000));
+          sub   = nullptr;
+        }
+
+        if (!sub || id % 200 == 0) {
+          sub = &group->dirs.emplace_back(std::format(L"Sub_{}", id / 200));
+        }
+
+        sub->files.emplace_back(std::format(L"File_{}.nif", id), FILETIME{}, 1000);
+        unique = std::max(unique, id + 1);
+      }
+
+      DirectoryStats stats;
+      root.addFromList(std::format(L"mod_{}", m), L"", modRoot,
+                       static_cast<int>(m + 1), stats);
+    }
+  });
+
+  const double freeze = timed([&] {
+    root.freeze();
+  });
+
+  const auto after = workingSet(false);
+  std::size_t found = 0;
+
+  const double lookup = timed([&] {
+    for (std::size_t id = 0; id < unique; ++id) {
+      if (root.searchFile(syntheticPath(id))) {
+        ++found;
+      }
+    }
+  });
+
+  out << std::format("{} files in {} mods, {} unique, {} found\n", perMod * mods,
+                     mods, unique, found)
+      << std::format("  build  {:>9.2f} ms\n", build)
+      << std::format("  freeze {:>9.2f} ms\n", freeze)
+      << std::format("  lookup {:>9.2f} ms\n", lookup)
+      << std::format("  indices       {}\n", megabytes(root.indexMemoryUsage()))
+      << std::format("  string pool   {} ({} strings)\n",
+                     megabytes(StringPool::instance().memoryUsage()),
+                     StringPool::instance().size())
+      << std::format("  working set   {} -> {}\n", megabytes(before),
+                     megabytes(after))
+      << std::format("  peak          {}\n", megabytes(workingSet(true)));
+}
+
+// finds the archives of every plugin in a synthetic data directory, first by
+// going through all the files for each plugin like PluginList::refresh() used
+// to, then with PluginArchives
+//
+void pluginArchives(const Options& o, std::ostream& out)
+{
+  const std::size_t plugins = (o.count > 0 ? o.count : 2000);
+
+  // each plugin has two archives and there are a few loose files for each one
+  env::Directory dataRoot;
+
+  for (std::size_t i = 0; i < plugins; ++i) {
+    const auto name = std::format(L"Plugin_{}", i);
+
+    dataRoot.files.emplace_back(name + L".esp", FILETIME{}, 1000);
+    dataRoot.files.emplace_back(name + L".bsa", FILETIME{}, 1000);
+    dataRoot.files.emplace_back(name + L" - Textures.ba2", FILETIME{}, 1000);
+
+    for (std::size_t j = 0; j < 3; ++j) {
+      dataRoot.files.emplace_back(std::format(L"{}_{}.ini", name, j), FILETIME{}, 10);
+    }
+  }
+
+  DirectoryEntry root(L"data", nullptr, 0);
+  DirectoryStats stats;
+  root.addFromList(L"data", L"", dataRoot, 0, stats);
+  root.freeze();
+
+  const auto files = root.getFiles();
+
+  std::vector<QString> baseNames;
+  for (std::size_t i = 0; i < plugins; ++i) {
+    baseNames.push_back(QString("Plugin_%1").arg(i));
+  }
+
+  std::size_t scanned = 0;
+
+  const double scan = timed([&] {
+    for (auto&& baseName : baseNames) {
+      std::set<QString> found;
+
+      for (auto&& candidate : files) {
+        const QString name = ToQString(candidate->getName());
+        if (name.startsWith(baseName, Qt::CaseInsensitive) &&
+            (name.endsWith(".bsa", Qt::CaseInsensitive) ||
+             name.endsWith(".ba2", Qt::CaseInsensitive))) {
+          found.insert(name);
+        }
+      }
+
+      scanned += found.size();
+    }
+  });
+
+  std::size_t indexed = 0;
+
+  const double index = timed([&] {
+    const PluginArchives archives(files);
+
+    for (auto&& baseName : baseNames) {
+      indexed += archives.forPlugin(baseName).size();
+    }
+  });
+
+  // prefixes overlap, "Plugin_1" also loads the archives of "Plugin_10", so
+  // both have to find the same number
+  out << std::format("{} plugins, {} files in the data directory\n", plugins,
+                     files.size())
+      << std::format("  scan  {:>9.2f} ms ({} archives)\n", scan, scanned)
+      << std::format("  index {:>9.2f} ms ({} archives)\n", index, indexed);
+}
+
+// GlobPattern::match() before patterns were compiled, kept as a reference for
+// the glob benchmark
+//
+bool uncompiledGlobMatch(const QString& pattern, const QString& str)
+{
+  if (pattern.isEmpty()) {
+    return str.isEmpty();
+  }
+
+  auto pat_it  = pattern.begin();
+  auto pat_end = pattern.end();
+
+  auto str_it  = str.begin();
+  auto str_end = str.end();
+
+  auto anyrep_pos_pat = pat_end;
+  auto anyrep_pos_str = str_end;
+
+  auto set_pos_pat = pat_end;
+
+  while (str_it != str_end) {
+    QChar current_pat = QChar(0);
+    QChar current_str = QChar(-1);
+    if (pat_it != pat_end) {
+      current_pat = pat_it->toLower();
+      current_str = str_it->toLower();
+    }
+    if (pat_it != pat_end && current_pat == '[') {
+      set_pos_pat = pat_it;
+      pat_it++;
+    } else if (pat_it != pat_end && current_pat == ']') {
+      if (anyrep_pos_pat != pat_end) {
+        set_pos_pat = pat_end;
+        pat_it++;
+      } else {
+        return false;
+      }
+    } else if (set_pos_pat != pat_end) {
+      if (current_pat == current_str) {
+        set_pos_pat = pat_end;
+        pat_it      = std::find(pat_it, pat_end, ']') + 1;
+        str_it++;
+      } else {
+        if (pat_it == pat_end) {
+          return false;
+        }
+        pat_it++;
+      }
+    } else if (pat_it != pat_end && current_pat == current_str) {
+      pat_it++;
+      str_it++;
+    } else if (pat_it != pat_end && current_pat == '?') {
+      pat_it++;
+      str_it++;
+    } else if (pat_it != pat_end && current_pat == '*') {
+      anyrep_pos_pat = pat_it;
+      anyrep_pos_str = str_it;
+      pat_it++;
+    } else if (anyrep_pos_pat != pat_end) {
+      pat_it = anyrep_pos_pat + 1;
+      str_it = anyrep_pos_str + 1;
+      anyrep_pos_str++;
+    } else {
+      return false;
+    }
+  }
+  while (pat_it != pat_end) {
+    if (pat_it->toLower() == '*')
+      pat_it++;
+    else
+      break;
+  }
+  return pat_it == pat_end;
+}
+
+// matches synthetic file names against glob patterns of different shapes, with
+// the uncompiled matcher, GlobPattern and QRegularExpression
+//
+void glob(const Options& o, std::ostream& out)
+{
+  const std::size_t count = (o.count > 0 ? o.count : 200'000);
+
+  std::vector<QString> names;
+  names.reserve(count);
+
+  for (std::size_t i = 0; i < count; ++i) {
+    switch (i % 4) {
+    case 0:
+      names.push_back(QString("Plugin_%1.esp").arg(i));
+      break;
+    case 1:
+      names.push_back(QString("texture_%1_n.DDS").arg(i));
+      break;
+    case 2:
+      names.push_back(QString("Mesh_%1.nif").arg(i));
+      break;
+    default:
+      names.push_back(QString("readme_%1.txt").arg(i));
+      break;
+    }
+  }
+
+  const QStringList patterns = {"*.dds", "plugin_1*", "*_12*", "mesh_??2.nif",
+                                "*_[13]?.*", "*"};
+
+  out << std::format("{} names\n", names.size());
+
+  for (auto&& pattern : patterns) {
+    std::size_t uncompiled = 0, compiled = 0, regex = 0;
+
+    const double tu = timed([&] {
+      for (auto&& name : names) {
+        uncompiled += uncompiledGlobMatch(pattern, name) ? 1 : 0;
+      }
+    });
+
+    const double tc = timed([&] {
+      const GlobPattern<QChar> g(pattern);
+
+      for (auto&& name : names) {
+        compiled += g.match(name) ? 1 : 0;
+      }
+    });
+
+    const double tr = timed([&] {
+      const QRegularExpression re(
+          QRegularExpression::wildcardToRegularExpression(pattern),
+          QRegularExpression::CaseInsensitiveOption);
+
+      for (auto&& name : names) {
+        regex += re.match(name).hasMatch() ? 1 : 0;
+      }
+    });
+
+    out << std::format("  {:<14} uncompiled {:>8.2f} ms, compiled {:>8.2f} ms, "
+                       "regex {:>8.2f} ms ({}/{}/{} matches)\n",
+                       pattern.toStdString(), tu, tc, tr, uncompiled, compiled,
+                       regex);
+  }
+}
+
+struct Benchmark
+{
+  Info info;
+  void (*f)(const Options&, std::ostream&);
+};
+
+const std::vector<Benchmark>& benchmarks()
+{
+  static const std::vector<Benchmark> v = {
+      {{"register", "concurrent file creation and lookups in the file register"},
+       &fileRegister},
+      {{"tree", "memory used by a synthetic directory structure"}, &directoryTree},
+      {{"plugin-archives", "finding the archives loaded by each plugin"},
+       &pluginArchives},
+      {{"glob", "matching file names against glob patterns"}, &glob}};
+
+  return v;
+}
+
+std::vector<Info> list()
+{
+  std::vector<Info> v;
+
+  for (auto&& b : benchmarks()) {
+    v.push_back(b.info);
+  }
+
+  return v;
+}
+
+bool run(const std::string& name, const Options& o, std::ostream& out)
+{
+  for (auto&& b : benchmarks()) {
+    if (b.info.name == name) {
+      b.f(o, out);
+      return true;
+    }
+  }
+
+  return false;
+}
+
+}  // namespace benchmarks
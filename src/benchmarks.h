@@ -0,0 +1,41 @@
+#ifndef MODORGANIZER_BENCHMARKS_INCLUDED
+#define MODORGANIZER_BENCHMARKS_INCLUDED
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// synthetic benchmarks for the performance-sensitive parts of MO, run with
+// `ModOrganizer.exe benchmark NAME`; they don't need an instance and write
+// their results to the given stream
+//
+namespace benchmarks
+{
+
+struct Options
+{
+  // maximum number of threads, benchmarks that scale with threads run with
+  // 1, 2, 4, ... up to this number
+  std::size_t threads = 1;
+
+  // number of items to generate, such as files; 0 uses the benchmark's default
+  std::size_t count = 0;
+};
+
+struct Info
+{
+  std::string name;
+  std::string description;
+};
+
+// all available benchmarks
+//
+std::vector<Info> list();
+
+// runs the benchmark with the given name, returns false if it doesn't exist
+//
+bool run(const std::string& name, const Options& o, std::ostream& out);
+
+}  // namespace benchmarks
+
+#endif  // MODORGANIZER_BENCHMARKS_INCLUDED
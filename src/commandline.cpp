@@ -1,4 +1,5 @@
 #include "commandline.h"
+#include "benchmarks.h"
 #include "env.h"
 #include "instancemanager.h"
 #include "loglist.h"
@@ -51,7 +52,7 @@ CommandLine::CommandLine() : m_command(nullptr)
   createOptions();
 
   add<RunCommand, ReloadPluginCommand, DownloadFileCommand, RefreshCommand,
-      CrashDumpCommand, LaunchCommand>();
+      CrashDumpCommand, BenchmarkCommand, LaunchCommand>();
 }
 
 std::optional<int> CommandLine::process(const std::wstring& line)
@@ -605,6 +606,73 @@ std::optional<int> CrashDumpCommand::runEarly()
   return (b ? 0 : 1);
 }
 
+po::options_description BenchmarkCommand::getVisibleOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("threads",
+                  po::value<std::size_t>()->default_value(
+                      std::max(std::thread::hardware_concurrency(), 1u)),
+                  "maximum number of threads")(
+      "count", po::value<std::size_t>()->default_value(0),
+      "number of items to generate, 0 for the default");
+
+  return d;
+}
+
+po::options_description BenchmarkCommand::getInternalOptions() const
+{
+  po::options_description d;
+
+  d.add_options()("NAME", po::value<std::string>(), "benchmark name");
+
+  return d;
+}
+
+po::positional_options_description BenchmarkCommand::getPositional() const
+{
+  po::positional_options_description d;
+
+  d.add("NAME", 1);
+
+  return d;
+}
+
+Command::Meta BenchmarkCommand::meta() const
+{
+  std::string more = "Benchmarks:\n";
+
+  for (auto&& b : benchmarks::list()) {
+    more += "  " + pad_right(b.name, 12) + b.description + "\n";
+  }
+
+  return {"benchmark", "runs an internal performance benchmark", "NAME [options]",
+          more};
+}
+
+std::optional<int> BenchmarkCommand::runEarly()
+{
+  env::Console console;
+
+  if (!vm().count("NAME")) {
+    std::cerr << "usage: " << usageLine() << "\n";
+    return 1;
+  }
+
+  const auto name = vm()["NAME"].as<std::string>();
+
+  benchmarks::Options o;
+  o.threads = std::max<std::size_t>(vm()["threads"].as<std::size_t>(), 1);
+  o.count   = vm()["count"].as<std::size_t>();
+
+  if (!benchmarks::run(name, o, std::cout)) {
+    std::cerr << "unknown benchmark '" << name << "'\n";
+    return 1;
+  }
+
+  return 0;
+}
+
 Command::Meta LaunchCommand::meta() const
 {
   return {"launch", "(internal, do not use)", "", ""};
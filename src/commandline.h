@@ -149,6 +149,20 @@ protected:
   std::optional<int> runEarly() override;
 };
 
+// runs one of the internal benchmarks, see benchmarks.h
+//
+class BenchmarkCommand : public Command
+{
+protected:
+  Meta meta() const override;
+
+  po::options_description getVisibleOptions() const override;
+  po::options_description getInternalOptions() const override;
+  po::positional_options_description getPositional() const override;
+
+  std::optional<int> runEarly() override;
+};
+
 // this is the `launch` command used when starting a process from within the
 // virtualized directory, see processrunner.cpp
 //
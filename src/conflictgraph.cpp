@@ -0,0 +1,244 @@
+#include "conflictgraph.h"
+#include "modinfo.h"
+#include "shared/directoryentry.h"
+#include "shared/fileentry.h"
+#include "shared/fileregister.h"
+#include "shared/filesorigin.h"
+#include <utility.h>
+
+#include <algorithm>
+#include <filesystem>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace MOBase;
+using namespace MOShared;
+namespace fs = std::filesystem;
+
+static constexpr std::size_t EdgeCount =
+    static_cast<std::size_t>(ConflictGraph::Edge::Count);
+
+static bool isHidden(const std::wstring& name, const std::wstring& hideExt)
+{
+  return (fs::path(name).extension().wstring() == hideExt);
+}
+
+// whether the directory or one of its parents is hidden, remembers the result
+// for every directory it goes through
+//
+static bool inHiddenDirectory(const DirectoryEntry* dir, const std::wstring& hideExt,
+                              std::unordered_map<const DirectoryEntry*, bool>& cache)
+{
+  if (!dir) {
+    return false;
+  }
+
+  auto itor = cache.find(dir);
+  if (itor != cache.end()) {
+    return itor->second;
+  }
+
+  const bool hidden = isHidden(dir->getName(), hideExt) ||
+                      inHiddenDirectory(dir->getParent(), hideExt, cache);
+
+  cache.emplace(dir, hidden);
+
+  return hidden;
+}
+
+ConflictGraph ConflictGraph::build(DirectoryEntry& root)
+{
+  ConflictGraph g;
+
+  const std::wstring hideExt = ToWString(ModInfo::s_HiddenExt);
+
+  OriginID dataID = 0;
+  if (root.originExists(L"data")) {
+    dataID = root.getOriginByName(L"data").getID();
+  }
+
+  // mod index of each origin, looked up by name only once
+  std::vector<std::optional<unsigned int>> modIndices;
+
+  auto modIndex = [&](OriginID id) {
+    const auto i = static_cast<std::size_t>(id);
+    if (i >= modIndices.size()) {
+      modIndices.resize(i + 1);
+    }
+
+    if (!modIndices[i]) {
+      const FilesOrigin* origin = root.findOriginByID(id);
+      modIndices[i] =
+          (origin ? ModInfo::getIndex(ToQString(origin->getName())) : UINT_MAX);
+    }
+
+    return *modIndices[i];
+  };
+
+  auto flagsOf = [&](OriginID id) -> Flags& {
+    const auto i = static_cast<std::size_t>(id);
+    if (i >= g.m_Flags.size()) {
+      g.m_Flags.resize(i + 1);
+    }
+
+    return g.m_Flags[i];
+  };
+
+  // row in the high bits, target in the low bits, so sorting them gives the
+  // final order
+  std::unordered_set<std::uint64_t> edges;
+
+  auto addEdge = [&](OriginID from, Edge e, unsigned int to) {
+    const auto row = static_cast<std::size_t>(from) * EdgeCount +
+                     static_cast<std::size_t>(e);
+
+    edges.insert((static_cast<std::uint64_t>(row) << 32) | to);
+  };
+
+  std::unordered_map<const DirectoryEntry*, bool> hiddenDirs;
+
+  auto fileRegister  = root.getFileRegister();
+  const auto highest = fileRegister->highestCount();
+
+  // origins already visited for the current file
+  std::vector<OriginID> visited;
+
+  for (std::size_t i = 0; i < highest; ++i) {
+    FileEntry* file = fileRegister->fileAt(static_cast<FileIndex>(i));
+    if (!file) {
+      continue;
+    }
+
+    const auto& alternatives = file->getAlternatives();
+    const OriginID winner    = file->getOrigin();
+
+    const bool hidden = isHidden(file->getName(), hideExt) ||
+                        inHiddenDirectory(file->getParent(), hideExt, hiddenDirs);
+
+    // files only overwriting the data directory are not conflicts
+    const bool conflicted =
+        !alternatives.empty() && alternatives.back().originID() != dataID;
+
+    // adds the edges from the given origin of this file to all the others
+    auto visit = [&](OriginID origin, const DataArchiveOrigin& archive) {
+      Flags& f = flagsOf(origin);
+
+      f.hasFiles       = true;
+      f.hasHiddenFiles = f.hasHiddenFiles || hidden;
+
+      if (!conflicted) {
+        f.providesAnything = true;
+        return;
+      }
+
+      if (origin != winner) {
+        const auto target = modIndex(winner);
+
+        if (!file->isFromArchive()) {
+          addEdge(origin,
+                  archive.isValid() ? Edge::ArchiveLooseOverwritten : Edge::Overwritten,
+                  target);
+        } else {
+          addEdge(origin, Edge::ArchiveOverwritten, target);
+        }
+      } else {
+        f.providesAnything = true;
+      }
+
+      for (const auto& alt : alternatives) {
+        const OriginID altID = alt.originID();
+        if (altID == dataID || altID == origin) {
+          continue;
+        }
+
+        const auto target = modIndex(altID);
+
+        if (!alt.isFromArchive()) {
+          if (!archive.isValid()) {
+            if (root.getOriginPriority(origin) > root.getOriginPriority(altID)) {
+              addEdge(origin, Edge::Overwrite, target);
+            } else {
+              addEdge(origin, Edge::Overwritten, target);
+            }
+          } else {
+            addEdge(origin, Edge::ArchiveLooseOverwritten, target);
+          }
+        } else {
+          if (!archive.isValid()) {
+            addEdge(origin, Edge::ArchiveLooseOverwrite, target);
+          } else if (archive.order() > alt.archive().order()) {
+            addEdge(origin, Edge::ArchiveOverwrite, target);
+          } else if (archive.order() < alt.archive().order()) {
+            addEdge(origin, Edge::ArchiveOverwritten, target);
+          }
+        }
+      }
+    };
+
+    // an origin can be both the winner and an alternative, like when one of its
+    // archives has the same file as its loose files; it's only visited once,
+    // with the winner's archive or the one of its first alternative
+    visited.clear();
+
+    auto visitOnce = [&](OriginID origin, const DataArchiveOrigin& archive) {
+      if (std::find(visited.begin(), visited.end(), origin) == visited.end()) {
+        visited.push_back(origin);
+        visit(origin, archive);
+      }
+    };
+
+    visitOnce(winner, file->getArchive());
+
+    for (const auto& alt : alternatives) {
+      visitOnce(alt.originID(), alt.archive());
+    }
+  }
+
+  std::vector<std::uint64_t> sorted(edges.begin(), edges.end());
+  std::sort(sorted.begin(), sorted.end());
+
+  const std::size_t rows = g.m_Flags.size() * EdgeCount;
+
+  g.m_Offsets.assign(rows + 1, 0);
+  g.m_Targets.reserve(sorted.size());
+
+  std::size_t row = 0;
+
+  for (const auto e : sorted) {
+    const auto r = static_cast<std::size_t>(e >> 32);
+
+    while (row <= r) {
+      g.m_Offsets[row++] = static_cast<std::uint32_t>(g.m_Targets.size());
+    }
+
+    g.m_Targets.push_back(static_cast<unsigned int>(e & 0xffffffff));
+  }
+
+  while (row <= rows) {
+    g.m_Offsets[row++] = static_cast<std::uint32_t>(g.m_Targets.size());
+  }
+
+  return g;
+}
+
+std::span<const unsigned int> ConflictGraph::edges(OriginID origin, Edge e) const
+{
+  if (origin < 0 || static_cast<std::size_t>(origin) >= m_Flags.size()) {
+    return {};
+  }
+
+  const auto row =
+      static_cast<std::size_t>(origin) * EdgeCount + static_cast<std::size_t>(e);
+
+  return {m_Targets.data() + m_Offsets[row], m_Offsets[row + 1] - m_Offsets[row]};
+}
+
+ConflictGraph::Flags ConflictGraph::flags(OriginID origin) const
+{
+  if (origin < 0 || static_cast<std::size_t>(origin) >= m_Flags.size()) {
+    return {};
+  }
+
+  return m_Flags[static_cast<std::size_t>(origin)];
+}
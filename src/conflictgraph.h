@@ -0,0 +1,82 @@
+#ifndef CONFLICTGRAPH_H
+#define CONFLICTGRAPH_H
+
+#include "shared/fileregisterfwd.h"
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// conflicts between all the origins of a directory structure, built in a
+// single pass over the files of its register instead of going through the
+// files of each mod separately
+//
+// edges go from an origin to the indices of the mods it conflicts with and are
+// stored per kind in one array (compressed sparse rows), sorted and unique
+//
+class ConflictGraph
+{
+public:
+  enum class Edge
+  {
+    // loose files of this origin overwrite loose files of the target
+    Overwrite = 0,
+
+    // loose files of the target overwrite loose files of this origin
+    Overwritten,
+
+    // archive files of this origin overwrite archive files of the target
+    ArchiveOverwrite,
+
+    // archive files of the target overwrite archive files of this origin
+    ArchiveOverwritten,
+
+    // loose files of this origin overwrite archive files of the target
+    ArchiveLooseOverwrite,
+
+    // loose files of the target overwrite archive files of this origin
+    ArchiveLooseOverwritten,
+
+    Count
+  };
+
+  struct Flags
+  {
+    // whether the origin has any file at all
+    bool hasFiles = false;
+
+    // whether at least one file of the origin is not overwritten
+    bool providesAnything = false;
+
+    // whether a file or one of its parent directories is hidden
+    bool hasHiddenFiles = false;
+  };
+
+  // empty graph
+  //
+  ConflictGraph() = default;
+
+  // walks all the files in the structure's register
+  //
+  static ConflictGraph build(MOShared::DirectoryEntry& root);
+
+  // indices of the mods connected to the given origin by the given kind of
+  // edge; empty if the origin has no files
+  //
+  std::span<const unsigned int> edges(MOShared::OriginID origin, Edge e) const;
+
+  // flags of the given origin, all false if it has no files
+  //
+  Flags flags(MOShared::OriginID origin) const;
+
+private:
+  // start of the edges for origin * Edge::Count + kind in m_Targets, with one
+  // more element for the end of the last one
+  std::vector<std::uint32_t> m_Offsets;
+  std::vector<unsigned int> m_Targets;
+
+  // by origin id
+  std::vector<Flags> m_Flags;
+};
+
+#endif  // CONFLICTGRAPH_H
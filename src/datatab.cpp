@@ -1,19 +1,71 @@
 #include "datatab.h"
+#include "filesearchindex.h"
 #include "filetree.h"
 #include "filetreemodel.h"
 #include "messagedialog.h"
 #include "organizercore.h"
 #include "settings.h"
+#include "shared/util.h"
 #include "ui_mainwindow.h"
 #include <log.h>
 #include <report.h>
 
+#include <QRegularExpression>
+#include <optional>
+
 using namespace MOShared;
 using namespace MOBase;
 
 // in mainwindow.cpp
 QString UnmanagedModName();
 
+// splits the text of the filter like FilterWidget does: "||", "|" and "OR"
+// separate alternatives, spaces separate words that must all be found
+//
+// this gives the directories that can have matches so only those are loaded,
+// the actual filtering is still done by the filter widget; anything that's
+// matched differently as a regular expression splits the words further or
+// makes this return nothing, so the tree is fully loaded instead
+//
+static std::optional<FileSearchIndex::Groups> searchGroups(const QString& text)
+{
+  static const QString special = "\\^$*+?()[]{}\"";
+
+  for (const QChar c : text) {
+    if (special.contains(c)) {
+      return {};
+    }
+  }
+
+  QString s = text;
+  s.replace("||", "|").replace("OR", "|");
+
+  FileSearchIndex::Groups groups;
+
+  for (auto&& alternative : s.split('|', Qt::SkipEmptyParts)) {
+    if (alternative.trimmed().isEmpty()) {
+      continue;
+    }
+
+    std::vector<std::wstring> words;
+
+    // a dot matches any character in a regular expression
+    for (auto&& word : alternative.split(QRegularExpression("[\\s.]"),
+                                         Qt::SkipEmptyParts)) {
+      words.push_back(MOShared::ToLowerCopy(word.toStdWString()));
+    }
+
+    if (words.empty()) {
+      // would match everything
+      return {};
+    }
+
+    groups.push_back(std::move(words));
+  }
+
+  return groups;
+}
+
 DataTab::DataTab(OrganizerCore& core, PluginContainer& pc, QWidget* parent,
                  Ui::MainWindow* mwui)
     : m_core(core), m_pluginContainer(pc), m_parent(parent),
@@ -22,7 +74,8 @@ DataTab::DataTab(OrganizerCore& core, PluginContainer& pc, QWidget* parent,
          mwui->dataTabRefresh,
          mwui->dataTree,
          mwui->dataTabShowOnlyConflicts,
-         mwui->dataTabShowFromArchives},
+         mwui->dataTabShowFromArchives,
+         mwui->dataTabFilter},
       m_needUpdate(true)
 {
   m_filetree.reset(new FileTree(core, m_pluginContainer, ui.tree));
@@ -37,7 +90,7 @@ DataTab::DataTab(OrganizerCore& core, PluginContainer& pc, QWidget* parent,
   }
 
   connect(&m_filter, &FilterWidget::aboutToChange, [&] {
-    ensureFullyLoaded();
+    ensureLoadedForFilter();
   });
 
   connect(ui.refresh, &QPushButton::clicked, [&] {
@@ -117,7 +170,7 @@ void DataTab::doUpdateTree()
   m_filetree->refresh();
 
   if (!m_filter.empty()) {
-    ensureFullyLoaded();
+    ensureLoadedForFilter();
 
     if (auto* m = m_filter.proxyModel()) {
       m->invalidate();
@@ -136,6 +189,30 @@ void DataTab::ensureFullyLoaded()
   }
 }
 
+void DataTab::ensureLoadedForFilter()
+{
+  if (m_filetree->fullyLoaded()) {
+    return;
+  }
+
+  const auto groups = searchGroups(ui.filter->text());
+  if (!groups) {
+    ensureFullyLoaded();
+    return;
+  }
+
+  if (groups->empty()) {
+    // no filter
+    return;
+  }
+
+  const auto paths = m_core.searchIndex()->directoriesMatching(*groups);
+
+  m_filter.setFilteringEnabled(false);
+  m_filetree->ensureLoaded(paths);
+  m_filter.setFilteringEnabled(true);
+}
+
 void DataTab::onConflicts()
 {
   updateOptions();
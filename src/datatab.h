@@ -4,6 +4,7 @@
 #include "modinfo.h"
 #include "modinfodialogfwd.h"
 #include <QCheckBox>
+#include <QLineEdit>
 #include <QPushButton>
 #include <QTreeWidget>
 #include <filterwidget.h>
@@ -54,6 +55,7 @@ private:
     QTreeView* tree;
     QCheckBox* conflicts;
     QCheckBox* archives;
+    QLineEdit* filter;
   };
 
   OrganizerCore& m_core;
@@ -71,6 +73,7 @@ private:
   void onArchives();
   void updateOptions();
   void ensureFullyLoaded();
+  void ensureLoadedForFilter();
   bool isActive() const;
   void doUpdateTree();
 };
@@ -28,6 +28,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "report.h"
 #include "settings.h"
 #include "shared/util.h"
+#include "thread_utils.h"
 #include "utility.h"
 
 #include <gameplugins.h>
@@ -36,7 +37,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDir>
 #include <QString>
 
+#include <algorithm>
 #include <fstream>
+#include <numeric>
 
 using namespace MOBase;
 using namespace MOShared;
@@ -163,12 +166,64 @@ DirectoryRefresher::DirectoryRefresher(std::size_t threadCount)
     : m_threadCount(threadCount), m_lastFileCount(0)
 {}
 
+DirectoryRefresher::~DirectoryRefresher()
+{
+  if (m_SnapshotWriter.joinable()) {
+    m_SnapshotWriter.join();
+  }
+}
+
 DirectoryEntry* DirectoryRefresher::stealDirectoryStructure()
 {
   QMutexLocker locker(&m_RefreshLock);
+
+  if (m_Root) {
+    std::scoped_lock recycleLock(m_RecycleLock);
+    m_HandedOut.push_back(m_RootState);
+
+    // only the structure in use and the one it replaced can be given back
+    if (m_HandedOut.size() > 2) {
+      m_HandedOut.erase(m_HandedOut.begin());
+    }
+  }
+
   return m_Root.release();
 }
 
+std::shared_ptr<const FileSearchIndex> DirectoryRefresher::stealSearchIndex()
+{
+  QMutexLocker locker(&m_RefreshLock);
+  return std::move(m_SearchIndex);
+}
+
+std::shared_ptr<const FileQuery> DirectoryRefresher::stealFileQuery()
+{
+  QMutexLocker locker(&m_RefreshLock);
+  return std::move(m_FileQuery);
+}
+
+DirectoryEntry* DirectoryRefresher::recycleDirectoryStructure(DirectoryEntry* structure)
+{
+  std::scoped_lock lock(m_RecycleLock);
+  std::unique_ptr<DirectoryEntry> replaced(structure);
+  std::swap(m_Recycled, replaced);
+
+  // a structure that wasn't handed out by this refresher has no state, it's
+  // thrown away by the next refresh
+  m_RecycledState.reset();
+
+  auto itor = std::find_if(m_HandedOut.begin(), m_HandedOut.end(), [&](auto&& b) {
+    return b.root == structure;
+  });
+
+  if (itor != m_HandedOut.end()) {
+    m_RecycledState = *itor;
+    m_HandedOut.erase(itor);
+  }
+
+  return replaced.release();
+}
+
 void DirectoryRefresher::setMods(
     const std::vector<std::tuple<QString, QString, int>>& mods,
     const std::set<QString>& managedArchives)
@@ -197,6 +252,17 @@ void DirectoryRefresher::cleanStructure(DirectoryEntry* structure)
   for (int i = 0; i < sizeof(dirs) / sizeof(wchar_t*); ++i) {
     structure->removeDir(std::wstring(dirs[i]));
   }
+
+  structure->freeze();
+}
+
+// archive indices are kept in the cache directory, see ArchiveIndexCache
+//
+ArchiveIndexCache archiveIndexCache()
+{
+  const QDir cache(Settings::instance().paths().cache());
+  return ArchiveIndexCache(
+      QDir::toNativeSeparators(cache.filePath("archives")).toStdWString());
 }
 
 void DirectoryRefresher::addModBSAToStructure(DirectoryEntry* root,
@@ -232,7 +298,7 @@ void DirectoryRefresher::addModBSAToStructure(DirectoryEntry* root,
 
   root->addFromAllBSAs(modName.toStdWString(),
                        QDir::toNativeSeparators(directory).toStdWString(), priority,
-                       archivesW, enabledArchives, lo, dummy);
+                       archivesW, enabledArchives, lo, archiveIndexCache(), dummy);
 }
 
 void DirectoryRefresher::stealModFilesIntoStructure(DirectoryEntry* directoryStructure,
@@ -318,97 +384,140 @@ void DirectoryRefresher::addModToStructure(DirectoryEntry* directoryStructure,
   }
 }
 
-struct ModThread
+void DirectoryRefresher::updateProgress(const DirectoryRefreshProgress* p)
 {
-  DirectoryRefreshProgress* progress = nullptr;
-  DirectoryEntry* ds                 = nullptr;
-  std::wstring modName;
-  std::wstring path;
-  int prio = -1;
-  std::vector<std::wstring> archives;
+  // careful: called from multiple threads
+  emit progress(p);
+}
+
+// fingerprint of a tree returned by env::getFilesAndDirs(), same as walking
+// the directory again with fingerprintOf()
+//
+void addToFingerprint(OriginFingerprint& fp, const env::Directory& d)
+{
+  for (auto&& f : d.files) {
+    fp.addFile(f.name, f.lastModified, f.size);
+  }
+
+  for (auto&& sd : d.dirs) {
+    fp.addDirectory(sd.name);
+    addToFingerprint(fp, sd);
+    fp.endDirectory();
+  }
+}
+
+void DirectoryRefresher::addMultipleModsFilesToStructure(
+    MOShared::DirectoryEntry* directoryStructure, const std::vector<EntryInfo>& entries,
+    DirectoryRefreshProgress* progress)
+{
+  std::vector<DirectoryStats> stats(entries.size());
+
+  if (progress) {
+    progress->start(entries.size());
+  }
+
+  log::debug("refresher: using {} threads", m_threadCount);
+
+  // the same for all mods
+  const bool archiveParsing = Settings::instance().archiveParsing();
+  std::vector<std::wstring> loadOrder;
   std::set<std::wstring> enabledArchives;
-  DirectoryStats* stats = nullptr;
-  env::DirectoryWalker walker;
 
-  std::condition_variable cv;
-  std::mutex mutex;
-  bool ready = false;
+  if (archiveParsing) {
+    const IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
 
-  void wakeup()
-  {
-    {
-      std::scoped_lock lock(mutex);
-      ready = true;
+    if (GamePlugins* gamePlugins = game->feature<GamePlugins>()) {
+      for (auto&& s : gamePlugins->getLoadOrder()) {
+        loadOrder.push_back(s.toStdWString());
+      }
     }
 
-    cv.notify_one();
+    for (auto&& a : m_EnabledArchives) {
+      enabledArchives.insert(a.toStdWString());
+    }
   }
 
-  void run()
+  // everything a mod needs to be added to the structure, read in the first
+  // phase
+  struct ModScan
   {
-    std::unique_lock lock(mutex);
-    cv.wait(lock, [&] {
-      return ready;
-    });
+    env::Directory tree;
+    OriginFingerprint fingerprint;
+    std::vector<DirectoryEntry::LoadedBSA> archives;
+
+    // first failure while listing the mod or reading its archives, reported
+    // when the mod is added
+    std::exception_ptr treeError;
+    std::exception_ptr archivesError;
+  };
 
-    SetThisThreadName(QString::fromStdWString(modName + L" refresher"));
-    ds->addFromOrigin(walker, modName, path, prio, *stats);
+  std::vector<ModScan> scans(entries.size());
+  const auto archiveIndices = archiveIndexCache();
 
-    if (Settings::instance().archiveParsing()) {
-      const IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
+  // first phase: every mod is read into its own tree without touching the
+  // structure; directories are listed by separate tasks, so threads that are
+  // done with small mods help with the large ones
+  {
+    TaskScheduler scheduler(m_threadCount);
 
-      QStringList loadOrder;
-      GamePlugins* gamePlugins = game->feature<GamePlugins>();
-      if (gamePlugins) {
-        loadOrder = gamePlugins->getLoadOrder();
-      }
+    for (std::size_t i = 0; i < entries.size(); ++i) {
+      const auto& e = entries[i];
 
-      std::vector<std::wstring> lo;
-      for (auto&& s : loadOrder) {
-        lo.push_back(s.toStdWString());
+      if (e.stealFiles.length() > 0) {
+        continue;
       }
 
-      ds->addFromAllBSAs(modName, path, prio, archives, enabledArchives, lo, *stats);
-    }
-
-    if (progress) {
-      progress->addDone();
-    }
+      auto& scan      = scans[i];
+      const auto path = QDir::toNativeSeparators(e.absolutePath).toStdWString();
 
-    SetThisThreadName(QString::fromStdWString(L"idle refresher"));
-    ready = false;
-  }
-};
+      env::getFilesAndDirs(scheduler, path, scan.tree, [&scan, progress](auto error) {
+        scan.treeError = error;
+        addToFingerprint(scan.fingerprint, scan.tree);
 
-env::ThreadPool<ModThread> g_threads;
+        if (progress) {
+          progress->addDone();
+        }
+      });
 
-void DirectoryRefresher::updateProgress(const DirectoryRefreshProgress* p)
-{
-  // careful: called from multiple threads
-  emit progress(p);
-}
+      if (archiveParsing && !e.archives.isEmpty()) {
+        std::vector<std::wstring> archives;
+        for (auto&& a : e.archives) {
+          archives.push_back(a.toStdWString());
+        }
 
-void DirectoryRefresher::addMultipleModsFilesToStructure(
-    MOShared::DirectoryEntry* directoryStructure, const std::vector<EntryInfo>& entries,
-    DirectoryRefreshProgress* progress)
-{
-  std::vector<DirectoryStats> stats(entries.size());
+        scheduler.submit([&, path, archives = std::move(archives)] {
+          try {
+            scan.archives = DirectoryEntry::readBSAs(path, archives, enabledArchives,
+                                                     loadOrder, archiveIndices);
+          } catch (...) {
+            scan.archivesError = std::current_exception();
+          }
+        });
+      }
+    }
 
-  if (progress) {
-    progress->start(entries.size());
+    scheduler.wait();
   }
 
-  log::debug("refresher: using {} threads", m_threadCount);
-  g_threads.setMax(m_threadCount);
+  // second phase: the trees are merged into the structure on this thread by
+  // increasing priority, so nothing is contended and, unless mods are added
+  // back to an existing structure, a file's new origin is always the highest
+  // one so far and FileEntry::appendOrigin() doesn't have to look at the
+  // alternatives
+  //
+  // mods that failed to be read in the first phase are added with whatever
+  // could be read, and the error is reported once they're in
+  std::vector<std::size_t> order(entries.size());
+  std::iota(order.begin(), order.end(), 0);
+
+  std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) {
+    return entries[a].priority < entries[b].priority;
+  });
 
-  for (std::size_t i = 0; i < entries.size(); ++i) {
+  for (const auto i : order) {
     const auto& e  = entries[i];
     const int prio = e.priority + 1;
 
-    if constexpr (DirectoryStats::EnableInstrumentation) {
-      stats[i].mod = entries[i].modName.toStdString();
-    }
-
     try {
       if (e.stealFiles.length() > 0) {
         stealModFilesIntoStructure(directoryStructure, e.modName, prio, e.absolutePath,
@@ -418,83 +527,457 @@ void DirectoryRefresher::addMultipleModsFilesToStructure(
           progress->addDone();
         }
       } else {
-        auto& mt = g_threads.request();
+        auto& scan         = scans[i];
+        const auto modName = e.modName.toStdWString();
+        const auto path    = QDir::toNativeSeparators(e.absolutePath).toStdWString();
 
-        mt.progress = progress;
-        mt.ds       = directoryStructure;
-        mt.modName  = e.modName.toStdWString();
-        mt.path     = QDir::toNativeSeparators(e.absolutePath).toStdWString();
-        mt.prio     = prio;
+        directoryStructure->addFromList(modName, path, scan.tree, prio, stats[i]);
+        directoryStructure->getOriginByName(modName).setFingerprint(scan.fingerprint);
 
-        mt.archives.clear();
-        for (auto&& a : e.archives) {
-          mt.archives.push_back(a.toStdWString());
+        if (archiveParsing) {
+          directoryStructure->addFromBSAs(modName, path, prio, scan.archives,
+                                          stats[i]);
         }
 
-        mt.enabledArchives.clear();
-        for (auto&& a : m_EnabledArchives) {
-          mt.enabledArchives.insert(a.toStdWString());
-        }
+        const auto failure = (scan.treeError ? scan.treeError : scan.archivesError);
 
-        mt.stats = &stats[i];
+        // releases the tree and archives now instead of holding on to all of
+        // them until the end
+        scan = {};
 
-        mt.wakeup();
+        if (failure) {
+          std::rethrow_exception(failure);
+        }
       }
     } catch (const std::exception& ex) {
       emit error(tr("failed to read mod (%1): %2").arg(e.modName, ex.what()));
     }
-  }
 
-  g_threads.waitForAll();
+    if constexpr (DirectoryStats::EnableInstrumentation) {
+      stats[i].mod = e.modName.toStdString();
+    }
+  }
 
   if constexpr (DirectoryStats::EnableInstrumentation) {
     dumpStats(stats);
   }
 }
 
+// returns the name and path of the game's data directory and all secondary
+// data directories, in the order they're added to the structure
+//
+std::vector<std::pair<std::wstring, std::wstring>> dataDirectories()
+{
+  IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
+
+  std::vector<std::pair<std::wstring, std::wstring>> v;
+
+  v.push_back(
+      {L"data",
+       QDir::toNativeSeparators(game->dataDirectory().absolutePath()).toStdWString()});
+
+  for (auto directory : game->secondaryDataDirectories().toStdMap()) {
+    v.push_back(
+        {directory.first.toStdWString(),
+         QDir::toNativeSeparators(directory.second.absolutePath()).toStdWString()});
+  }
+
+  return v;
+}
+
+OriginFingerprint DirectoryRefresher::fingerprintOf(const std::wstring& path)
+{
+  OriginFingerprint fp;
+
+  if (path.empty()) {
+    return fp;
+  }
+
+  env::forEachEntry(
+      path, &fp,
+      [](void* pfp, std::wstring_view name) {
+        static_cast<OriginFingerprint*>(pfp)->addDirectory(name);
+      },
+
+      [](void* pfp, std::wstring_view) {
+        static_cast<OriginFingerprint*>(pfp)->endDirectory();
+      },
+
+      [](void* pfp, std::wstring_view name, FILETIME ft, uint64_t size) {
+        static_cast<OriginFingerprint*>(pfp)->addFile(name, ft, size);
+      });
+
+  return fp;
+}
+
+DirectoryRefresher::GlobalState DirectoryRefresher::currentGlobalState() const
+{
+  GlobalState s;
+
+  s.archiveParsing = Settings::instance().archiveParsing();
+
+  if (s.archiveParsing) {
+    const IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
+
+    if (GamePlugins* gamePlugins = game->feature<GamePlugins>()) {
+      s.loadOrder = gamePlugins->getLoadOrder();
+    }
+
+    s.enabledArchives = m_EnabledArchives;
+  }
+
+  return s;
+}
+
+DirectorySnapshot::Tags DirectoryRefresher::GlobalState::tags() const
+{
+  DirectorySnapshot::Tags tags;
+
+  tags.push_back(archiveParsing ? L"archive parsing" : L"no archive parsing");
+
+  for (auto&& a : enabledArchives) {
+    tags.push_back(L"archive:" + a.toStdWString());
+  }
+
+  for (auto&& p : loadOrder) {
+    tags.push_back(L"plugin:" + p.toStdWString());
+  }
+
+  return tags;
+}
+
+std::wstring snapshotPath()
+{
+  const QDir cache(Settings::instance().paths().cache());
+  return QDir::toNativeSeparators(cache.filePath("directory.snapshot")).toStdWString();
+}
+
+std::unique_ptr<DirectoryEntry>
+DirectoryRefresher::loadSnapshot(const GlobalState& state)
+{
+  TimeThis tt("DirectoryRefresher::loadSnapshot()");
+
+  DirectorySnapshot::Tags tags;
+  auto root = DirectorySnapshot::load(snapshotPath(), tags);
+
+  if (root && tags != state.tags()) {
+    log::debug("refresher: ignoring directory snapshot, archives have changed");
+    return {};
+  }
+
+  return root;
+}
+
+void DirectoryRefresher::saveSnapshot(const DirectorySnapshot::Tags& tags,
+                                      std::uint64_t generation)
+{
+  TimeThis tt("DirectoryRefresher::saveSnapshot()");
+
+  auto snapshot =
+      std::make_shared<DirectorySnapshot>(DirectorySnapshot::capture(*m_Root, tags));
+
+  // the previous snapshot is older than this one, but it has to be done before
+  // the file can be replaced
+  if (m_SnapshotWriter.joinable()) {
+    m_SnapshotWriter.join();
+  }
+
+  m_SnapshotGeneration = 0;
+
+  if (snapshot->empty()) {
+    return;
+  }
+
+  const QString dir       = Settings::instance().paths().cache();
+  const std::wstring path = snapshotPath();
+
+  m_SnapshotWriter = MOShared::startSafeThread([this, snapshot, dir, path,
+                                                generation] {
+    if (!QDir(dir).exists() && !QDir().mkpath(dir)) {
+      log::error("failed to create '{}', can't save directory snapshot", dir);
+      return;
+    }
+
+    if (snapshot->write(path)) {
+      m_SnapshotGeneration = generation;
+    }
+  });
+}
+
+bool DirectoryRefresher::refreshIncremental(DirectoryEntry* root,
+                                            DirectoryRefreshProgress* progress,
+                                            bool& modified)
+{
+  TimeThis tt("DirectoryRefresher::refreshIncremental()");
+
+  modified = false;
+
+  if (!root->isPopulated()) {
+    return false;
+  }
+
+  // removed files stay in the register until it's destroyed, start over with
+  // a new one once they take too much space
+  if (root->getFileRegister()->tooManyRemoved()) {
+    log::debug("refresher: too many removed files, full refresh needed");
+    return false;
+  }
+
+  struct Candidate
+  {
+    std::wstring name;
+    std::wstring path;
+    FilesOrigin* origin = nullptr;
+    OriginFingerprint fingerprint;
+  };
+
+  const auto dataDirs = dataDirectories();
+  std::vector<Candidate> candidates;
+
+  for (auto&& [name, path] : dataDirs) {
+    if (!root->originExists(name)) {
+      return false;
+    }
+
+    candidates.push_back({name, path, &root->getOriginByName(name)});
+  }
+
+  for (auto&& e : m_Mods) {
+    if (!e.stealFiles.isEmpty()) {
+      // stolen files are moved out of the data origin, this can't be undone
+      // without rebuilding everything
+      return false;
+    }
+
+    Candidate c;
+    c.name = e.modName.toStdWString();
+    c.path = QDir::toNativeSeparators(e.absolutePath).toStdWString();
+
+    if (root->originExists(c.name)) {
+      c.origin = &root->getOriginByName(c.name);
+
+      if (c.origin->getPath() != c.path) {
+        return false;
+      }
+    }
+
+    candidates.push_back(std::move(c));
+  }
+
+  // walking the origins without adding anything to the structure is much
+  // cheaper than inserting all the files; origins that are new or disabled
+  // will be added anyway and don't need a fingerprint
+  parallelMap(
+      candidates.begin(), candidates.end(),
+      [](Candidate& c) {
+        if (c.origin && !c.origin->isDisabled()) {
+          c.fingerprint = fingerprintOf(c.path);
+        }
+      },
+      m_threadCount);
+
+  for (std::size_t i = 0; i < dataDirs.size(); ++i) {
+    const auto& c = candidates[i];
+
+    if (c.origin->isDisabled() || c.origin->fingerprint() != c.fingerprint) {
+      log::debug("refresher: data directory '{}' has changed", c.name);
+      return false;
+    }
+  }
+
+  std::set<std::wstring> activeNames;
+  for (auto&& c : candidates) {
+    activeNames.insert(c.name);
+  }
+
+  // origins that are still enabled in the structure but aren't active anymore
+  // and origins that have changed on disk
+  std::vector<FilesOrigin*> toDisable;
+
+  root->forEachOrigin([&](FilesOrigin& o) {
+    if (!o.isDisabled() && !activeNames.contains(o.getName())) {
+      toDisable.push_back(&o);
+    }
+  });
+
+  const std::size_t removedCount = toDisable.size();
+  std::vector<EntryInfo> changed;
+
+  for (std::size_t i = 0; i < m_Mods.size(); ++i) {
+    const auto& e = m_Mods[i];
+    auto& c       = candidates[dataDirs.size() + i];
+
+    if (c.origin) {
+      // files are sorted again by priority once all the origins are up to date,
+      // so unchanged origins only need their new priority
+      if (c.origin->getPriority() != e.priority + 1) {
+        c.origin->setPriority(e.priority + 1);
+        modified = true;
+      }
+
+      if (c.origin->isDisabled()) {
+        changed.push_back(e);
+      } else if (c.origin->fingerprint() != c.fingerprint) {
+        toDisable.push_back(c.origin);
+        changed.push_back(e);
+      }
+    } else {
+      changed.push_back(e);
+    }
+  }
+
+  log::debug("refresher: incremental refresh, {} of {} mods changed, {} removed",
+             changed.size(), m_Mods.size(), removedCount);
+
+  if (!toDisable.empty() || !changed.empty()) {
+    modified = true;
+  }
+
+  std::set<OriginID> removedOrigins;
+
+  for (auto* o : toDisable) {
+    o->enable(false);
+    removedOrigins.insert(o->getID());
+  }
+
+  // directories that only the removed origins had are dropped, changed origins
+  // register again on the ones they still have when they're added back below
+  if (!removedOrigins.empty()) {
+    root->removeOrigins(removedOrigins);
+  }
+
+  addMultipleModsFilesToStructure(root, changed, progress);
+
+  return true;
+}
+
+void DirectoryRefresher::refreshFull(DirectoryEntry* root,
+                                     DirectoryRefreshProgress* progress)
+{
+  for (auto&& [name, path] : dataDirectories()) {
+    DirectoryStats dummy;
+    root->addFromOrigin(name, path, 0, dummy);
+  }
+
+  addMultipleModsFilesToStructure(root, m_Mods, progress);
+}
+
 void DirectoryRefresher::refresh()
 {
   SetThisThreadName("DirectoryRefresher");
   TimeThis tt("DirectoryRefresher::refresh()");
   auto* p = new DirectoryRefreshProgress(this);
 
+  // set when the snapshot has to be saved once the lock is released
+  std::optional<DirectorySnapshot::Tags> snapshotTags;
+  std::uint64_t generation = 0;
+
+  // archives of all the mods, set when archives are parsed so unused indices
+  // can be removed from the cache
+  std::optional<std::vector<std::wstring>> archives;
+
   {
     QMutexLocker locker(&m_RefreshLock);
 
-    m_Root.reset(new DirectoryEntry(L"data", nullptr, 0));
-
-    IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
+    std::sort(m_Mods.begin(), m_Mods.end(), [](auto lhs, auto rhs) {
+      return lhs.priority < rhs.priority;
+    });
 
-    std::wstring dataDirectory =
-        QDir::toNativeSeparators(game->dataDirectory().absolutePath()).toStdWString();
+    const auto state       = currentGlobalState();
+    const bool incremental = Settings::instance().incrementalRefresh();
+    const bool snapshot    = incremental && Settings::instance().directorySnapshot();
 
+    std::unique_ptr<DirectoryEntry> previous;
+    std::optional<BuiltState> previousState;
     {
-      DirectoryStats dummy;
-      m_Root->addFromOrigin(L"data", dataDirectory, 0, dummy);
+      std::scoped_lock recycleLock(m_RecycleLock);
+      previous      = std::move(m_Recycled);
+      previousState = std::exchange(m_RecycledState, std::nullopt);
     }
 
-    for (auto directory : game->secondaryDataDirectories().toStdMap()) {
-      DirectoryStats dummy;
-      m_Root->addFromOrigin(
-          directory.first.toStdWString(),
-          QDir::toNativeSeparators(directory.second.absolutePath()).toStdWString(), 0,
-          dummy);
+    generation = ++m_Generation;
+
+    // the file on disk can't change while it's compared with `previous`
+    if (m_SnapshotWriter.joinable()) {
+      m_SnapshotWriter.join();
     }
 
-    std::sort(m_Mods.begin(), m_Mods.end(), [](auto lhs, auto rhs) {
-      return lhs.priority < rhs.priority;
-    });
+    // whether the snapshot on disk matches `previous`
+    bool onDisk = false;
 
-    addMultipleModsFilesToStructure(m_Root.get(), m_Mods, p);
+    // the recycled structure may have been built two refreshes ago, with
+    // different archives or load order than the last one
+    if (!incremental || !previous || !previous->isPopulated() || !previousState ||
+        previousState->state != state) {
+      previous.reset();
+
+      // the snapshot is validated and updated exactly like a recycled
+      // structure would be
+      if (snapshot) {
+        previous = loadSnapshot(state);
+      }
+
+      onDisk = (previous != nullptr);
+    } else {
+      onDisk = (m_SnapshotGeneration == previousState->generation);
+    }
+
+    bool modified = true;
+
+    if (previous && refreshIncremental(previous.get(), p, modified)) {
+      m_Root = std::move(previous);
+    } else {
+      // a partially updated structure is useless
+      previous.reset();
+      modified = true;
+
+      m_Root.reset(new DirectoryEntry(L"data", nullptr, 0));
+      refreshFull(m_Root.get(), p);
+    }
+
+    m_RootState = {m_Root.get(), state, generation};
 
     m_Root->getFileRegister()->sortOrigins();
 
     cleanStructure(m_Root.get());
 
+    // built here so the data tab and the file queries of plugins don't have to
+    // walk the whole structure on the gui thread the first time they're used
+    m_SearchIndex =
+        std::make_shared<const FileSearchIndex>(FileSearchIndex::build(*m_Root));
+    m_FileQuery = std::make_shared<const FileQuery>(FileQuery::build(*m_Root));
+
+    if (snapshot && (modified || !onDisk)) {
+      snapshotTags = state.tags();
+    } else if (!modified && onDisk) {
+      // the file on disk still matches the structure
+      m_SnapshotGeneration = generation;
+    }
+
+    if (state.archiveParsing) {
+      archives.emplace();
+
+      for (auto&& e : m_Mods) {
+        for (auto&& a : e.archives) {
+          archives->push_back(a.toStdWString());
+        }
+      }
+    }
+
     m_lastFileCount = m_Root->getFileRegister()->highestCount();
     log::debug("refresher saw {} files", m_lastFileCount);
   }
 
+  // the structure is only handed over by refreshed(), so it can still be
+  // captured without holding the lock; the file is written in the background
+  if (snapshotTags) {
+    saveSnapshot(*snapshotTags, generation);
+  }
+
+  if (archives) {
+    archiveIndexCache().prune(*archives);
+  }
+
   p->finish();
 
   emit progress(p);
@@ -20,13 +20,22 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DIRECTORYREFRESHER_H
 #define DIRECTORYREFRESHER_H
 
+#include "filequery.h"
+#include "filesearchindex.h"
 #include "profile.h"
 #include "shared/directoryentry.h"
+#include "shared/directorysnapshot.h"
 #include "shared/fileregisterfwd.h"
 #include <QMutex>
 #include <QObject>
 #include <QStringList>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
 #include <set>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -56,6 +65,10 @@ public:
 
   DirectoryRefresher(std::size_t threadCount);
 
+  // waits until the last snapshot has been written
+  //
+  ~DirectoryRefresher();
+
   /**
    * @brief retrieve the updated directory structure
    *
@@ -66,6 +79,37 @@ public:
    **/
   MOShared::DirectoryEntry* stealDirectoryStructure();
 
+  /**
+   * @brief retrieve the search index of the updated directory structure, built
+   *        along with it; empty if the refresh failed
+   **/
+  std::shared_ptr<const FileSearchIndex> stealSearchIndex();
+
+  /**
+   * @brief retrieve the file query index of the updated directory structure,
+   *        built along with it; empty if the refresh failed
+   **/
+  std::shared_ptr<const FileQuery> stealFileQuery();
+
+  /**
+   * @brief gives back a structure that was previously stolen and is not used
+   *        anymore
+   *
+   * when incremental refreshes are enabled, the next refresh will update this
+   * structure in place instead of building a new one from scratch, only
+   * re-adding origins that have changed on disk; the refresher takes custody of
+   * the pointer
+   *
+   * this never waits for a refresh to finish
+   *
+   * @param structure structure that is not used anymore
+   * @return a structure that was recycled before and never used by a refresh,
+   *         or null; the caller takes custody of it and should delete it on
+   *         another thread, it can be very large
+   **/
+  MOShared::DirectoryEntry*
+  recycleDirectoryStructure(MOShared::DirectoryEntry* structure);
+
   /**
    * @brief sets up the mods to be included in the directory structure
    *
@@ -84,7 +128,7 @@ public:
 
   /**
    * @brief remove files from the directory structure that are known to be irrelevant to
-   * the game
+   * the game and freeze it, which must be done after every change
    * @param the structure to clean
    */
   static void cleanStructure(MOShared::DirectoryEntry* structure);
@@ -132,6 +176,12 @@ public:
 
   void updateProgress(const DirectoryRefreshProgress* p);
 
+  /**
+   * @brief walks the given directory without adding anything to a structure,
+   *        the result can be compared with FilesOrigin::fingerprint()
+   **/
+  static MOShared::OriginFingerprint fingerprintOf(const std::wstring& path);
+
 public slots:
 
   /**
@@ -146,13 +196,81 @@ signals:
   void refreshed();
 
 private:
+  // state that affects the contents of all origins at once and that can't be
+  // captured by fingerprints; an incremental refresh is only possible when it
+  // hasn't changed since the last refresh
+  struct GlobalState
+  {
+    bool archiveParsing = false;
+    std::set<QString> enabledArchives;
+    QStringList loadOrder;
+
+    bool operator==(const GlobalState& o) const = default;
+
+    // saved in directory snapshots
+    MOShared::DirectorySnapshot::Tags tags() const;
+  };
+
+  // what a structure was built with; structures are handed out and given back
+  // one refresh later, so a recycled structure can be older than the last
+  // refresh and is only updated if it was built with the current global state
+  struct BuiltState
+  {
+    const MOShared::DirectoryEntry* root = nullptr;
+    GlobalState state;
+
+    // numbers the refreshes, see m_SnapshotGeneration
+    std::uint64_t generation = 0;
+  };
+
   std::vector<EntryInfo> m_Mods;
   std::set<QString> m_EnabledArchives;
   std::unique_ptr<MOShared::DirectoryEntry> m_Root;
+  BuiltState m_RootState;
+  std::uint64_t m_Generation = 0;
+  std::shared_ptr<const FileSearchIndex> m_SearchIndex;
+  std::shared_ptr<const FileQuery> m_FileQuery;
   QMutex m_RefreshLock;
+
+  // the gui thread gives structures back while a refresh might be running, so
+  // this has its own lock instead of m_RefreshLock; m_HandedOut has the state
+  // of the last structures given by stealDirectoryStructure(), only those can
+  // be recycled
+  std::mutex m_RecycleLock;
+  std::unique_ptr<MOShared::DirectoryEntry> m_Recycled;
+  std::optional<BuiltState> m_RecycledState;
+  std::vector<BuiltState> m_HandedOut;
+
+  // snapshots are written to disk on this thread, see saveSnapshot(); the
+  // generation is the one of the structure the file on disk was made from, 0 if
+  // there is none
+  std::thread m_SnapshotWriter;
+  std::atomic<std::uint64_t> m_SnapshotGeneration = 0;
   std::size_t m_threadCount;
   std::size_t m_lastFileCount;
 
+  GlobalState currentGlobalState() const;
+
+  // updates the given structure so it matches the current mods, returns false
+  // if a full refresh is required instead; `modified` is set when origins were
+  // added, removed or moved
+  //
+  bool refreshIncremental(MOShared::DirectoryEntry* root,
+                          DirectoryRefreshProgress* progress, bool& modified);
+
+  void refreshFull(MOShared::DirectoryEntry* root, DirectoryRefreshProgress* progress);
+
+  // structure from the last session, null if there is none or it was made with
+  // a different global state
+  //
+  std::unique_ptr<MOShared::DirectoryEntry> loadSnapshot(const GlobalState& state);
+
+  // captures m_Root in memory and writes it in the background; must be called
+  // before the structure is handed over with refreshed()
+  //
+  void saveSnapshot(const MOShared::DirectorySnapshot::Tags& tags,
+                    std::uint64_t generation);
+
   void stealModFilesIntoStructure(MOShared::DirectoryEntry* directoryStructure,
                                   const QString& modName, int priority,
                                   const QString& directory,
@@ -28,7 +28,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "nxmurl.h"
 #include "organizercore.h"
 #include "selectiondialog.h"
+#include "settings.h"
 #include "shared/util.h"
+#include "thread_utils.h"
 #include "utility.h"
 #include <nxmurl.h>
 #include <report.h>
@@ -55,6 +57,12 @@ using namespace MOBase;
 
 static const char UNFINISHED[] = ".unfinished";
 
+// segments of a split download are never smaller than this
+static const qint64 MIN_SEGMENT_SIZE = 16 * 1024 * 1024;
+
+// how often the progress of segments is saved to the .meta file
+static const qint64 CHECKPOINT_INTERVAL = 5 * 1000;
+
 unsigned int DownloadManager::DownloadInfo::s_NextDownloadID = 1U;
 int DownloadManager::m_DirWatcherDisabler                    = 0;
 
@@ -82,7 +90,8 @@ DownloadManager::DownloadInfo::createNew(const ModRepositoryFileInfo* fileInfo,
 DownloadManager::DownloadInfo*
 DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool showHidden,
                                               const QString outputDirectory,
-                                              std::optional<uint64_t> fileSize)
+                                              std::optional<uint64_t> fileSize,
+                                              const MetaIni* meta)
 {
   DownloadInfo* info = new DownloadInfo;
 
@@ -92,7 +101,14 @@ DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool show
           .compare(QDir::fromNativeSeparators(outputDirectory), Qt::CaseInsensitive) !=
       0)
     return nullptr;
-  QSettings metaFile(metaFileName, QSettings::IniFormat);
+
+  MetaIni read;
+  if (meta == nullptr) {
+    read = MetaIni::read(metaFileName);
+    meta = &read;
+  }
+
+  const MetaIni& metaFile = *meta;
   if (!showHidden && metaFile.value("removed", false).toBool()) {
     return nullptr;
   } else {
@@ -123,6 +139,9 @@ DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool show
   info->m_Output.setFileName(filePath);
   info->m_TotalSize      = fileSize ? *fileSize : QFileInfo(filePath).size();
   info->m_PreResumeSize  = info->m_TotalSize;
+  info->m_Segments =
+      DownloadSegments::fromString(metaFile.value("segments").toString(),
+                                   static_cast<qint64>(info->m_TotalSize));
   info->m_CurrentUrl     = 0;
   info->m_Urls           = metaFile.value("url", "").toString().split(";");
   info->m_Tries          = 0;
@@ -150,6 +169,14 @@ DownloadManager::DownloadInfo::createFromMeta(const QString& filePath, bool show
   info->m_FileInfo->userData     = metaFile.value("userData").toMap();
   info->m_Reply                  = nullptr;
 
+  // the hash is only trusted if the file still has the size it had when it was
+  // hashed
+  const QByteArray md5 = QByteArray::fromHex(metaFile.value("md5").toByteArray());
+  if (md5.size() == 16 &&
+      metaFile.value("md5Size", -1).toLongLong() == info->m_TotalSize) {
+    info->m_Hash = md5;
+  }
+
   return info;
 }
 
@@ -231,12 +258,20 @@ DownloadManager::DownloadManager(NexusInterface* nexusInterface, QObject* parent
   m_TimeoutTimer.setSingleShot(false);
   // connect(&m_TimeoutTimer, SIGNAL(timeout()), this, SLOT(checkDownloadTimeout()));
   m_TimeoutTimer.start(5 * 1000);
+
+  connect(&m_Hasher, &FileHasher::progress, this, &DownloadManager::hashProgress);
+  connect(&m_Hasher, &FileHasher::finished, this, &DownloadManager::hashFinished);
+  connect(&m_Hasher, &FileHasher::failed, this, &DownloadManager::hashFailed);
+  connect(&m_Writer, &DownloadWriter::failed, this, &DownloadManager::writerFailed);
+  connect(&m_Writer, &DownloadWriter::reached, this, &DownloadManager::writerReached);
 }
 
 DownloadManager::~DownloadManager()
 {
   for (QVector<DownloadInfo*>::iterator iter = m_ActiveDownloads.begin();
        iter != m_ActiveDownloads.end(); ++iter) {
+    // the writer may still be feeding the download's hash
+    m_Writer.close((*iter)->m_DownloadID);
     delete *iter;
   }
   m_ActiveDownloads.clear();
@@ -358,33 +393,33 @@ void DownloadManager::refreshList()
 
     nameFilters.push_back(QString(UNFINISHED).toLower().toStdWString());
 
-    QDir dir(QDir::fromNativeSeparators(m_OutputDirectory));
+    const QString outputDirectory = QDir::fromNativeSeparators(m_OutputDirectory);
 
-    // find orphaned meta files and delete them (sounds cruel but it's better for
-    // everyone)
-    QStringList orphans;
-    QStringList metaFiles = dir.entryList(QStringList() << "*.meta");
-    foreach (const QString& metaFile, metaFiles) {
-      QString baseFile = metaFile.left(metaFile.length() - 5);
-      if (!QFile::exists(dir.absoluteFilePath(baseFile))) {
-        orphans.append(dir.absoluteFilePath(metaFile));
-      }
-    }
-    if (orphans.size() > 0) {
-      log::debug("{} orphaned meta files will be deleted", orphans.size());
-      shellDelete(orphans, true);
-    }
+    struct MetaFile
+    {
+      std::wstring name;
+      quint64 size;
+      quint64 time;
+    };
 
-    std::set<std::wstring> seen;
+    struct Found
+    {
+      QString path;
+      uint64_t size;
+      const MetaFile* metaFile;
+      MetaIni meta;
+    };
 
     struct Context
     {
-      DownloadManager& self;
-      std::set<std::wstring>& seen;
-      std::vector<std::wstring>& extensions;
+      const std::vector<std::wstring>& extensions;
+      std::set<std::wstring> seen;
+      std::set<std::wstring> files;
+      std::map<std::wstring, MetaFile> metas;
+      std::vector<std::tuple<std::wstring, std::wstring, uint64_t>> archives;
     };
 
-    Context cx = {*this, seen, nameFilters};
+    Context cx = {nameFilters};
 
     for (auto&& d : m_ActiveDownloads) {
       cx.seen.insert(d->m_FileName.toLower().toStdWString());
@@ -392,12 +427,24 @@ void DownloadManager::refreshList()
           QFileInfo(d->m_Output.fileName()).fileName().toLower().toStdWString());
     }
 
-    env::forEachEntry(
+    // a single listing gives the archives, their .meta files along with their
+    // size and time for the cache, and what's needed to find orphans
+    env::DirectoryWalker().listDirectory(
         QDir::toNativeSeparators(m_OutputDirectory).toStdWString(), &cx, nullptr,
-        nullptr, [](void* data, std::wstring_view f, FILETIME, uint64_t size) {
+        [](void* data, std::wstring_view f, FILETIME ft, uint64_t size) {
           auto& cx = *static_cast<Context*>(data);
 
           std::wstring lc = MOShared::ToLowerCopy(f);
+          cx.files.insert(lc);
+
+          if (lc.ends_with(L".meta")) {
+            const quint64 time =
+                (static_cast<quint64>(ft.dwHighDateTime) << 32) | ft.dwLowDateTime;
+
+            cx.metas.emplace(lc.substr(0, lc.size() - 5),
+                             MetaFile{std::wstring(f), size, time});
+            return;
+          }
 
           bool interestingExt = false;
           for (auto&& ext : cx.extensions) {
@@ -407,29 +454,58 @@ void DownloadManager::refreshList()
             }
           }
 
-          if (!interestingExt) {
-            return;
+          if (interestingExt && !cx.seen.contains(lc)) {
+            cx.archives.push_back({std::wstring(f), std::move(lc), size});
           }
+        });
 
-          if (cx.seen.contains(lc)) {
-            return;
-          }
+    // find orphaned meta files and delete them (sounds cruel but it's better for
+    // everyone)
+    QStringList orphans;
+    for (auto&& [base, m] : cx.metas) {
+      if (!cx.files.contains(base)) {
+        orphans.append(outputDirectory + "/" + QString::fromStdWString(m.name));
+      }
+    }
+    if (orphans.size() > 0) {
+      log::debug("{} orphaned meta files will be deleted", orphans.size());
+      shellDelete(orphans, true);
+    }
 
-          QString fileName = QDir::fromNativeSeparators(cx.self.m_OutputDirectory) +
-                             "/" + QString::fromWCharArray(f.data(), f.size());
+    std::vector<Found> found;
+    found.reserve(cx.archives.size());
 
-          DownloadInfo* info = DownloadInfo::createFromMeta(
-              fileName, cx.self.m_ShowHidden, cx.self.m_OutputDirectory, size);
+    for (auto&& [name, lc, size] : cx.archives) {
+      auto itor = cx.metas.find(lc);
 
-          if (info == nullptr) {
-            return;
+      found.push_back({outputDirectory + "/" + QString::fromStdWString(name), size,
+                       itor != cx.metas.end() ? &itor->second : nullptr});
+    }
+
+    // the .meta files are parsed in parallel, most of them come from the cache;
+    // creating the downloads is cheap after that but not thread-safe
+    m_MetaCache.setPath(Settings::instance().paths().cache() + "/downloads.cache");
+
+    parallelMap(
+        found.begin(), found.end(),
+        [&](Found& f) {
+          if (f.metaFile != nullptr) {
+            f.meta = m_MetaCache.get(f.path + ".meta", f.metaFile->size,
+                                     f.metaFile->time);
           }
+        },
+        std::min(Settings::instance().refreshThreadCount(), found.size()));
 
-          cx.self.m_ActiveDownloads.push_front(info);
-          cx.seen.insert(std::move(lc));
-          cx.seen.insert(
-              QFileInfo(info->m_Output.fileName()).fileName().toLower().toStdWString());
-        });
+    m_MetaCache.save();
+
+    for (auto&& f : found) {
+      DownloadInfo* info = DownloadInfo::createFromMeta(
+          f.path, m_ShowHidden, m_OutputDirectory, f.size, &f.meta);
+
+      if (info != nullptr) {
+        m_ActiveDownloads.push_front(info);
+      }
+    }
 
     log::debug("saw {} downloads", m_ActiveDownloads.size());
 
@@ -563,18 +639,27 @@ void DownloadManager::startDownload(QNetworkReply* reply, DownloadInfo* newDownl
     newDownload->m_Urls = QStringList(reply->url().toString());
   }
 
-  QIODevice::OpenMode mode = QIODevice::WriteOnly;
-  if (resume) {
-    mode |= QIODevice::Append;
-  }
-
   newDownload->m_StartTime.start();
   createMetaFile(newDownload);
 
-  if (!newDownload->m_Output.open(mode)) {
-    reportError(tr("failed to download %1: could not open output file: %2")
+  // the hash can only be kept when resuming if all the bytes already in the file
+  // went through it, which isn't the case for downloads resumed after a restart;
+  // those are hashed by m_Hasher when needed
+  if (!resume || newDownload->m_Output.size() == 0) {
+    newDownload->m_StreamHash =
+        std::make_unique<QCryptographicHash>(QCryptographicHash::Md5);
+    newDownload->m_StreamHashSize = 0;
+  } else if (newDownload->m_StreamHashSize != newDownload->m_Output.size()) {
+    newDownload->m_StreamHash.reset();
+  }
+
+  QString error;
+  if (!m_Writer.open(newDownload->m_DownloadID, newDownload->m_Output.fileName(),
+                     resume, newDownload->m_StreamHash.get(), &error)) {
+    reportError(tr("failed to download %1: could not open output file: %2 (%3)")
                     .arg(reply->url().toString())
-                    .arg(newDownload->m_Output.fileName()));
+                    .arg(newDownload->m_Output.fileName())
+                    .arg(error));
     return;
   }
 
@@ -784,6 +869,9 @@ void DownloadManager::removeFile(int index, bool deleteFile)
     return;
   }
 
+  // the file can't be deleted while it's being hashed
+  m_Hasher.cancel(download->m_DownloadID);
+
   if ((download->m_State == STATE_PAUSED) || (download->m_State == STATE_ERROR)) {
     filePath = download->m_Output.fileName();
   }
@@ -971,8 +1059,10 @@ void DownloadManager::resumeDownloadInt(int index)
   }
   DownloadInfo* info = m_ActiveDownloads[index];
 
-  // Check for finished download;
-  if (info->m_TotalSize <= info->m_Output.size() && info->m_Reply != nullptr &&
+  // Check for finished download; segmented downloads have their final size from
+  // the start
+  if (info->m_TotalSize <= info->m_Output.size() && info->m_Segments.complete() &&
+      info->m_Reply != nullptr &&
       info->m_Reply->isFinished() && info->m_State != STATE_ERROR) {
     setState(info, STATE_DOWNLOADING);
     downloadFinished(index);
@@ -981,7 +1071,7 @@ void DownloadManager::resumeDownloadInt(int index)
 
   if (info->isPausedState() || info->m_State == STATE_PAUSING) {
     if (info->m_State == STATE_PAUSING) {
-      if (info->m_Output.isOpen()) {
+      if (m_Writer.isOpen(info->m_DownloadID)) {
         writeData(info);
         if (info->m_State == STATE_PAUSING) {
           setState(info, STATE_PAUSED);
@@ -1001,7 +1091,32 @@ void DownloadManager::resumeDownloadInt(int index)
     QNetworkRequest request(QUrl::fromEncoded(info->currentURL().toLocal8Bit()));
     request.setHeader(QNetworkRequest::UserAgentHeader,
                       m_NexusInterface->getAccessManager()->userAgent());
-    if (info->m_State != STATE_ERROR) {
+    DownloadSegments::Segment* primary = nullptr;
+    if (!info->m_Segments.empty()) {
+      // m_Reply continues the first segment that isn't complete, the others get
+      // their own request once it has started
+      for (auto&& seg : info->m_Segments) {
+        seg.reply = nullptr;
+        seg.tries = AUTOMATIC_RETRIES;
+
+        if (primary == nullptr && !seg.complete()) {
+          primary = &seg;
+        }
+      }
+
+      if (primary == nullptr) {
+        // everything was received but the download was interrupted before it
+        // could complete, the last byte is fetched again to go through the
+        // normal path
+        primary = &*std::prev(info->m_Segments.end());
+        --primary->done;
+      }
+
+      request.setRawHeader("Range", QString("bytes=%1-%2")
+                                        .arg(primary->position())
+                                        .arg(primary->end - 1)
+                                        .toLatin1());
+    } else if (info->m_State != STATE_ERROR) {
       info->m_ResumePos      = info->m_Output.size();
       QByteArray rangeHeader = "bytes=" + QByteArray::number(info->m_ResumePos) + "-";
       request.setRawHeader("Range", rangeHeader);
@@ -1014,6 +1129,19 @@ void DownloadManager::resumeDownloadInt(int index)
         tag::rolling_window::window_size = 200);
     log::debug("resume at {} bytes", info->m_ResumePos);
     startDownload(m_NexusInterface->getAccessManager()->get(request), info, true);
+
+    if (primary != nullptr && m_Writer.isOpen(info->m_DownloadID)) {
+      primary->reply       = info->m_Reply;
+      info->m_DownloadLast = info->m_Segments.done();
+
+      for (auto&& seg : info->m_Segments) {
+        if (!seg.complete() && seg.reply == nullptr) {
+          startSegment(info, seg);
+        }
+      }
+
+      log::debug("resuming {} segments", info->m_Segments.toString());
+    }
   }
   emit update(index);
 }
@@ -1108,48 +1236,42 @@ void DownloadManager::queryInfoMd5(int index)
     return;
   }
 
-  info->m_GamesToQuery << m_ManagedGame->gameShortName();
-  info->m_GamesToQuery << m_ManagedGame->validShortNames();
+  if (m_Hasher.pending(info->m_DownloadID)) {
+    // already being hashed, the query starts when it's done
+    if (info->m_GamesToQuery.isEmpty()) {
+      info->m_GamesToQuery << m_ManagedGame->gameShortName();
+      info->m_GamesToQuery << m_ManagedGame->validShortNames();
+    }
+    return;
+  }
 
-  QFile downloadFile(info->m_FileName);
-  if (!downloadFile.exists()) {
-    downloadFile.setFileName(m_OrganizerCore->downloadsPath() + "\\" +
-                             info->m_FileName);
+  QString filePath = info->m_FileName;
+  if (!QFile::exists(filePath)) {
+    filePath = m_OrganizerCore->downloadsPath() + "\\" + info->m_FileName;
   }
-  if (!downloadFile.exists()) {
+  if (!QFile::exists(filePath)) {
     log::error("Can't find download file '{}'", info->m_FileName);
     return;
   }
-  if (!downloadFile.open(QIODevice::ReadOnly)) {
-    log::error("Can't open download file '{}'", info->m_FileName);
-    return;
-  }
 
-  QCryptographicHash hash(QCryptographicHash::Md5);
-  const qint64 progressStep = 10 * 1024 * 1024;
-  QProgressDialog progress(tr("Hashing download file '%1'").arg(info->m_FileName),
-                           tr("Cancel"), 0, downloadFile.size() / progressStep);
-  progress.setWindowModality(Qt::WindowModal);
-  progress.setMinimumDuration(1000);
+  info->m_GamesToQuery << m_ManagedGame->gameShortName();
+  info->m_GamesToQuery << m_ManagedGame->validShortNames();
 
-  for (qint64 i = 0; i < downloadFile.size(); i += progressStep) {
-    progress.setValue(progress.value() + 1);
-    if (progress.wasCanceled()) {
-      break;
-    }
-    hash.addData(downloadFile.read(progressStep));
-  }
-  if (progress.wasCanceled()) {
-    downloadFile.close();
+  // downloads made by this version have their hash in their .meta file, older
+  // ones are hashed in the background and queried in hashFinished()
+  if (!info->m_Hash.isEmpty() && QFileInfo(filePath).size() == info->m_TotalSize) {
+    info->m_ReQueried = true;
+    setState(info, STATE_FETCHINGMODINFO_MD5);
     return;
   }
 
-  progress.close();
-  downloadFile.close();
+  if (!m_Hasher.submit(info->m_DownloadID, filePath)) {
+    info->m_GamesToQuery.clear();
+    emit showMessage(tr("Too many downloads are being hashed, try again later."));
+    return;
+  }
 
-  info->m_Hash      = hash.result();
-  info->m_ReQueried = true;
-  setState(info, STATE_FETCHINGMODINFO_MD5);
+  log::debug("hashing download file '{}'", filePath);
 }
 
 void DownloadManager::visitOnNexus(int index)
@@ -1553,16 +1675,19 @@ void DownloadManager::setState(DownloadManager::DownloadInfo* info,
   switch (state) {
   case STATE_PAUSED: {
     info->m_Reply->abort();
-    info->m_Output.close();
+    abortSegments(info);
+    m_Writer.close(info->m_DownloadID);
     m_DownloadPaused(row);
   } break;
   case STATE_ERROR: {
     info->m_Reply->abort();
-    info->m_Output.close();
+    abortSegments(info);
+    m_Writer.close(info->m_DownloadID);
     m_DownloadFailed(row);
   } break;
   case STATE_CANCELED: {
     info->m_Reply->abort();
+    abortSegments(info);
     m_DownloadFailed(row);
   } break;
   case STATE_FETCHINGMODINFO: {
@@ -1588,12 +1713,25 @@ void DownloadManager::setState(DownloadManager::DownloadInfo* info,
   default: /* NOP */
     break;
   }
+
+  // aborting m_Reply doesn't do anything if it was done with its segment
+  // already, it's been waiting in downloadFinished() for the others
+  if (info->m_WaitingForSegments &&
+      (state == STATE_CANCELING || state == STATE_CANCELED || state == STATE_PAUSING ||
+       state == STATE_PAUSED || state == STATE_ERROR)) {
+    finishLater(info);
+  }
+
   emit stateChanged(row, state);
 }
 
 DownloadManager::DownloadInfo* DownloadManager::findDownload(QObject* reply,
                                                              int* index) const
 {
+  if (reply == nullptr) {
+    return nullptr;
+  }
+
   // reverse search as newer, thus more relevant, downloads are at the end
   for (int i = m_ActiveDownloads.size() - 1; i >= 0; --i) {
     if (m_ActiveDownloads[i]->m_Reply == reply) {
@@ -1624,31 +1762,14 @@ void DownloadManager::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
         if (bytesTotal > info->m_TotalSize) {
           info->m_TotalSize = bytesTotal;
         }
-        int oldProgress        = info->m_Progress.first;
-        info->m_Progress.first = ((info->m_ResumePos + bytesReceived) * 100) /
-                                 (info->m_ResumePos + bytesTotal);
-
-        qint64 elapsed = info->m_StartTime.elapsed();
-        info->m_DownloadAcc(bytesReceived - info->m_DownloadLast);
-        info->m_DownloadLast = bytesReceived;
-        info->m_DownloadTimeAcc(elapsed - info->m_DownloadTimeLast);
-        info->m_DownloadTimeLast = elapsed;
-
-        // calculate the download speed
-        const double speed = rolling_mean(info->m_DownloadAcc) /
-                             (rolling_mean(info->m_DownloadTimeAcc) / 1000.0);
-        ;
-
-        const qint64 remaining = (bytesTotal - bytesReceived) / speed * 1000;
-
-        info->m_Progress.second = tr("%1% - %2 - ~%3")
-                                      .arg(info->m_Progress.first)
-                                      .arg(MOBase::localizedByteSpeed(speed))
-                                      .arg(MOBase::localizedTimeRemaining(remaining));
-
-        TaskProgressManager::instance().updateProgress(info->m_TaskProgressId,
-                                                       bytesReceived, bytesTotal);
-        emit update(index);
+
+        // m_Reply only has its own segment, the progress is for all of them
+        if (!info->m_Segments.empty()) {
+          reportProgress(index, info, 0, info->m_Segments.done(),
+                         info->m_Segments.total());
+        } else {
+          reportProgress(index, info, info->m_ResumePos, bytesReceived, bytesTotal);
+        }
       }
     }
   } catch (const std::bad_alloc&) {
@@ -1656,6 +1777,37 @@ void DownloadManager::downloadProgress(qint64 bytesReceived, qint64 bytesTotal)
   }
 }
 
+void DownloadManager::reportProgress(int index, DownloadInfo* info, qint64 base,
+                                     qint64 received, qint64 total)
+{
+  if (total <= 0) {
+    return;
+  }
+
+  info->m_Progress.first = ((base + received) * 100) / (base + total);
+
+  qint64 elapsed = info->m_StartTime.elapsed();
+  info->m_DownloadAcc(received - info->m_DownloadLast);
+  info->m_DownloadLast = received;
+  info->m_DownloadTimeAcc(elapsed - info->m_DownloadTimeLast);
+  info->m_DownloadTimeLast = elapsed;
+
+  // calculate the download speed
+  const double speed = rolling_mean(info->m_DownloadAcc) /
+                       (rolling_mean(info->m_DownloadTimeAcc) / 1000.0);
+
+  const qint64 remaining = (total - received) / speed * 1000;
+
+  info->m_Progress.second = tr("%1% - %2 - ~%3")
+                                .arg(info->m_Progress.first)
+                                .arg(MOBase::localizedByteSpeed(speed))
+                                .arg(MOBase::localizedTimeRemaining(remaining));
+
+  TaskProgressManager::instance().updateProgress(info->m_TaskProgressId, received,
+                                                 total);
+  emit update(index);
+}
+
 void DownloadManager::downloadReadyRead()
 {
   try {
@@ -1692,6 +1844,25 @@ void DownloadManager::createMetaFile(DownloadInfo* info)
                                   (info->m_State == DownloadManager::STATE_ERROR));
   metaFile.setValue("removed", info->m_Hidden);
 
+  if (info->m_Segments.empty()) {
+    metaFile.remove("segments");
+  } else if (m_Writer.isOpen(info->m_DownloadID)) {
+    // some of the data may still be queued, only what's known to be on disk can
+    // be saved
+    metaFile.setValue("segments", info->m_SavedSegments);
+  } else {
+    info->m_SavedSegments = info->m_Segments.toString();
+    metaFile.setValue("segments", info->m_SavedSegments);
+  }
+
+  if (info->m_Hash.isEmpty()) {
+    metaFile.remove("md5");
+    metaFile.remove("md5Size");
+  } else {
+    metaFile.setValue("md5", QString(info->m_Hash.toHex()));
+    metaFile.setValue("md5Size", info->m_Output.size());
+  }
+
   // slightly hackish...
   for (int i = 0; i < m_ActiveDownloads.size(); ++i) {
     if (m_ActiveDownloads[i] == info) {
@@ -2144,6 +2315,7 @@ void DownloadManager::nxmRequestFailed(QString gameName, int modID, int fileID,
     if (info->m_FileInfo->modID == modID) {
       if (info->m_State < STATE_FETCHINGMODINFO) {
         m_ActiveDownloads.erase(iter);
+        m_Writer.close(info->m_DownloadID);
         delete info;
       } else {
         setState(info, STATE_READY);
@@ -2174,9 +2346,20 @@ void DownloadManager::downloadFinished(int index)
     QByteArray data;
     if (reply->isOpen() && info->m_HasData) {
       data = reply->readAll();
-      info->m_Output.write(data);
+      writeOutput(info, data);
     }
-    info->m_Output.close();
+
+    // with segments, m_Reply can be done with its own range before the others;
+    // this is called again when they're done, see segmentFinished()
+    const auto* own = info->m_Segments.find(reply);
+    if (info->m_State == STATE_DOWNLOADING && own != nullptr && own->complete() &&
+        !info->m_Segments.complete()) {
+      info->m_WaitingForSegments = true;
+      return;
+    }
+
+    info->m_WaitingForSegments = false;
+    m_Writer.close(info->m_DownloadID);
     TaskProgressManager::instance().forgetMe(info->m_TaskProgressId);
 
     bool error = false;
@@ -2190,7 +2373,8 @@ void DownloadManager::downloadFinished(int index)
                 .arg(reply->header(QNetworkRequest::ContentTypeHeader).toString()));
       if ((info->m_Output.size() == 0) ||
           ((reply->error() != QNetworkReply::NoError) &&
-           (reply->error() != QNetworkReply::OperationCanceledError))) {
+           (reply->error() != QNetworkReply::OperationCanceledError)) ||
+          (info->m_State == STATE_DOWNLOADING && !info->m_Segments.complete())) {
         if (reply->error() == QNetworkReply::UnknownContentError)
           emit showMessage(
               tr("Download header content length: %1 downloaded file size: %2")
@@ -2209,8 +2393,8 @@ void DownloadManager::downloadFinished(int index)
     if (info->m_State == STATE_CANCELING) {
       setState(info, STATE_CANCELED);
     } else if (info->m_State == STATE_PAUSING) {
-      if (info->m_Output.isOpen() && info->m_HasData) {
-        info->m_Output.write(info->m_Reply->readAll());
+      if (m_Writer.isOpen(info->m_DownloadID) && info->m_HasData) {
+        writeOutput(info, info->m_Reply->readAll());
       }
       setState(info, STATE_PAUSED);
     }
@@ -2226,7 +2410,7 @@ void DownloadManager::downloadFinished(int index)
                "There may be an issue with the Nexus servers."));
       emit update(-1);
     } else if (info->isPausedState() || info->m_State == STATE_PAUSING) {
-      info->m_Output.close();
+      m_Writer.close(info->m_DownloadID);
       createMetaFile(info);
       emit update(index);
     } else {
@@ -2248,6 +2432,13 @@ void DownloadManager::downloadFinished(int index)
         }
       }
 
+      // the hash is stored in the .meta file once the download is ready
+      if (info->m_StreamHash && info->m_StreamHashSize == info->m_Output.size()) {
+        info->m_Hash = info->m_StreamHash->result();
+      }
+      info->m_StreamHash.reset();
+      info->m_Segments.clear();
+
       bool isNexus = info->m_FileInfo->repository == "Nexus";
       // need to change state before changing the file name, otherwise .unfinished is
       // appended
@@ -2273,6 +2464,15 @@ void DownloadManager::downloadFinished(int index)
         setState(info, STATE_READY);
       }
 
+      // segments arrive out of order and can't be streamed into the hash, so
+      // the finished file is hashed in the background instead; hashFinished()
+      // stores the result in the .meta file
+      if (info->m_Hash.isEmpty() &&
+          !m_Hasher.submit(info->m_DownloadID, info->m_Output.fileName())) {
+        log::debug("hasher is busy, '{}' will be hashed when queried",
+                   info->m_FileName);
+      }
+
       emit update(index);
     }
     reply->close();
@@ -2303,18 +2503,34 @@ void DownloadManager::metaDataChanged()
 
   DownloadInfo* info = findDownload(this->sender(), &index);
   if (info != nullptr) {
+    // the length is what's left to download when resuming; segmented downloads
+    // have their final size already
+    bool ok            = false;
+    const qint64 total = info->m_Reply->header(QNetworkRequest::ContentLengthHeader)
+                             .toLongLong(&ok);
+    if (ok && info->m_Segments.empty()) {
+      m_Writer.reserve(info->m_DownloadID, info->m_ResumePos + total);
+    }
+
     QString newName = getFileNameFromNetworkReply(info->m_Reply);
     if (!newName.isEmpty() && (info->m_FileName.isEmpty())) {
+      // the file has to be closed to be renamed
+      const bool wasOpen = m_Writer.isOpen(info->m_DownloadID);
+      m_Writer.close(info->m_DownloadID);
+
       startDisableDirWatcher();
       info->setName(getDownloadFileName(newName), true);
       endDisableDirWatcher();
       refreshAlphabeticalTranslation();
-      if (!info->m_Output.isOpen() &&
-          !info->m_Output.open(QIODevice::WriteOnly | QIODevice::Append)) {
+      if (wasOpen && !m_Writer.open(info->m_DownloadID, info->m_Output.fileName(), true,
+                                    info->m_StreamHash.get(), nullptr)) {
         reportError(tr("failed to re-open %1").arg(info->m_FileName));
         setState(info, STATE_CANCELING);
+        return;
       }
     }
+
+    splitDownload(info);
   } else {
     log::warn("meta data event for unknown download");
   }
@@ -2350,20 +2566,344 @@ void DownloadManager::checkDownloadTimeout()
 void DownloadManager::writeData(DownloadInfo* info)
 {
   if (info != nullptr) {
-    qint64 ret = info->m_Output.write(info->m_Reply->readAll());
-    if (ret < info->m_Reply->size()) {
+    // failures while writing are reported later through writerFailed(), this
+    // only fails if the file isn't open
+    if (!writeOutput(info, info->m_Reply->readAll())) {
       QString fileName =
           info->m_FileName;  // m_FileName may be destroyed after setState
       setState(info, DownloadState::STATE_CANCELED);
 
-      log::error("Unable to write download \"{}\" to drive (return {})",
-                 info->m_FileName, ret);
+      log::error("Unable to write download \"{}\" to drive, file is not open",
+                 info->m_FileName);
 
-      reportError(tr("Unable to write download to drive (return %1).\n"
-                     "Check the drive's available storage.\n\n"
-                     "Canceling download \"%2\"...")
-                      .arg(ret)
+      reportError(tr("Unable to write download to drive.\n\n"
+                     "Canceling download \"%1\"...")
                       .arg(fileName));
     }
   }
 }
+
+bool DownloadManager::writeOutput(DownloadInfo* info, const QByteArray& data)
+{
+  if (!info->m_Segments.empty()) {
+    auto* seg = info->m_Segments.find(info->m_Reply);
+    if (seg == nullptr) {
+      // segments have been aborted, this is what was left in the buffer
+      return true;
+    }
+
+    if (!writeSegment(info, *seg, info->m_Reply, data)) {
+      log::error("server ignored the range requested for {}", info->m_FileName);
+      QTimer::singleShot(0, info->m_Reply, &QNetworkReply::abort);
+    } else if (seg->complete() && info->m_Reply->isRunning()) {
+      // the first request of a split download was for the whole file, the rest
+      // is fetched by the other segments; aborting from the event loop avoids
+      // getting into downloadFinished() from here
+      QTimer::singleShot(0, info->m_Reply, &QNetworkReply::abort);
+    }
+
+    return true;
+  }
+
+  if (!m_Writer.write(info->m_DownloadID, data)) {
+    return false;
+  }
+
+  // the writer adds the data to the hash once it's on disk
+  if (info->m_StreamHash) {
+    info->m_StreamHashSize += data.size();
+  }
+
+  return true;
+}
+
+void DownloadManager::writerFailed(unsigned int id, QString error)
+{
+  DownloadInfo* info = downloadInfoByID(id);
+  if (info == nullptr ||
+      (info->m_State != STATE_DOWNLOADING && info->m_State != STATE_PAUSING)) {
+    return;
+  }
+
+  QString fileName = info->m_FileName;  // m_FileName may be destroyed after setState
+  setState(info, DownloadState::STATE_CANCELED);
+
+  log::error("Unable to write download \"{}\" to drive: {}", fileName, error);
+
+  reportError(tr("Unable to write download to drive (%1).\n"
+                 "Check the drive's available storage.\n\n"
+                 "Canceling download \"%2\"...")
+                  .arg(error)
+                  .arg(fileName));
+}
+
+void DownloadManager::hashProgress(unsigned int id, qint64 done, qint64 total)
+{
+  DownloadInfo* info = downloadInfoByID(id);
+  if (info != nullptr) {
+    TaskProgressManager::instance().updateProgress(info->m_TaskProgressId, done,
+                                                   total);
+  }
+}
+
+void DownloadManager::hashFinished(unsigned int id, QByteArray hash)
+{
+  DownloadInfo* info = downloadInfoByID(id);
+  if (info == nullptr) {
+    // removed while it was being hashed
+    return;
+  }
+
+  TaskProgressManager::instance().forgetMe(info->m_TaskProgressId);
+
+  info->m_Hash = hash;
+
+  if (info->m_GamesToQuery.isEmpty()) {
+    // hashed automatically after the download finished, nothing to query; if
+    // it isn't ready yet, the hash is written when it becomes ready
+    if (info->m_State >= STATE_READY) {
+      createMetaFile(info);
+    }
+    return;
+  }
+
+  if (info->m_State < STATE_READY) {
+    return;
+  }
+
+  info->m_ReQueried = true;
+  setState(info, STATE_FETCHINGMODINFO_MD5);
+}
+
+void DownloadManager::hashFailed(unsigned int id, QString error)
+{
+  DownloadInfo* info = downloadInfoByID(id);
+  if (info == nullptr) {
+    return;
+  }
+
+  TaskProgressManager::instance().forgetMe(info->m_TaskProgressId);
+  info->m_GamesToQuery.clear();
+
+  log::error("Can't hash download file '{}': {}", info->m_FileName, error);
+}
+
+void DownloadManager::writerReached(unsigned int id, quint64 token)
+{
+  DownloadInfo* info = downloadInfoByID(id);
+  if (info == nullptr || info->m_Segments.empty() ||
+      token != info->m_CheckpointToken) {
+    return;
+  }
+
+  // Avoid triggering refreshes from DirWatcher
+  ScopedDisableDirWatcher scopedDirWatcher(this);
+
+  info->m_SavedSegments = info->m_Checkpoint;
+
+  QSettings metaFile(info->m_Output.fileName() + ".meta", QSettings::IniFormat);
+  metaFile.setValue("segments", info->m_SavedSegments);
+}
+
+void DownloadManager::splitDownload(DownloadInfo* info)
+{
+  QNetworkReply* reply = info->m_Reply;
+
+  // only downloads that start from scratch are split, resumed ones continue the
+  // way they started
+  if (!info->m_Segments.empty() || info->m_ResumePos != 0 ||
+      info->m_State != STATE_DOWNLOADING || !m_Writer.isOpen(info->m_DownloadID)) {
+    return;
+  }
+
+  if (reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 200 ||
+      reply->rawHeader("Accept-Ranges").trimmed().toLower() != "bytes") {
+    return;
+  }
+
+  bool ok = false;
+  const qint64 total =
+      reply->header(QNetworkRequest::ContentLengthHeader).toLongLong(&ok);
+  if (!ok) {
+    return;
+  }
+
+  auto segments = DownloadSegments::split(
+      total, Settings::instance().network().downloadSegments(), MIN_SEGMENT_SIZE);
+
+  if (segments.empty()) {
+    return;
+  }
+
+  info->m_Segments  = std::move(segments);
+  info->m_TotalSize = total;
+
+  // the file gets its final size so every segment can write into its range
+  m_Writer.resize(info->m_DownloadID, total);
+
+  // m_Reply is already fetching the file from the start, it's used for the
+  // first segment
+  auto first   = info->m_Segments.begin();
+  first->reply = reply;
+  first->tries = AUTOMATIC_RETRIES;
+
+  for (auto itor = std::next(first); itor != info->m_Segments.end(); ++itor) {
+    itor->tries = AUTOMATIC_RETRIES;
+    startSegment(info, *itor);
+  }
+
+  log::debug("downloading {} in segments {}", info->m_FileName,
+             info->m_Segments.toString());
+
+  // nothing has been received yet, this is safe to save right away
+  info->m_SavedSegments = info->m_Segments.toString();
+  createMetaFile(info);
+}
+
+void DownloadManager::startSegment(DownloadInfo* info, DownloadSegments::Segment& seg)
+{
+  QNetworkRequest request(info->m_Reply->url());
+  request.setHeader(QNetworkRequest::UserAgentHeader,
+                    m_NexusInterface->getAccessManager()->userAgent());
+  request.setRawHeader(
+      "Range",
+      QString("bytes=%1-%2").arg(seg.position()).arg(seg.end - 1).toLatin1());
+
+  seg.reply = m_NexusInterface->getAccessManager()->get(request);
+  seg.reply->setReadBufferSize(1024 * 1024);
+
+  connect(seg.reply, SIGNAL(readyRead()), this, SLOT(segmentReadyRead()));
+  connect(seg.reply, SIGNAL(finished()), this, SLOT(segmentFinished()));
+}
+
+void DownloadManager::abortSegments(DownloadInfo* info)
+{
+  for (auto&& seg : info->m_Segments) {
+    QNetworkReply* reply = std::exchange(seg.reply, nullptr);
+
+    if (reply != nullptr && reply != info->m_Reply) {
+      reply->disconnect(this);
+      reply->abort();
+      reply->deleteLater();
+    }
+  }
+}
+
+bool DownloadManager::writeSegment(DownloadInfo* info, DownloadSegments::Segment& seg,
+                                   QNetworkReply* reply, const QByteArray& data)
+{
+  // a server that ignores the range sends the file from the start, which doesn't
+  // belong in this segment
+  if (reply->request().hasRawHeader("Range") &&
+      reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt() != 206) {
+    return false;
+  }
+
+  const qint64 n = std::min<qint64>(data.size(), seg.remaining());
+  if (n <= 0) {
+    return true;
+  }
+
+  const QByteArray part = (n == data.size()) ? data : data.left(n);
+
+  if (m_Writer.write(info->m_DownloadID, part, seg.position())) {
+    seg.done += n;
+    checkpoint(info);
+  }
+
+  return true;
+}
+
+void DownloadManager::checkpoint(DownloadInfo* info)
+{
+  if (info->m_CheckpointTimer.isValid() &&
+      info->m_CheckpointTimer.elapsed() < CHECKPOINT_INTERVAL) {
+    return;
+  }
+
+  info->m_CheckpointTimer.start();
+  info->m_Checkpoint = info->m_Segments.toString();
+
+  // saved in writerReached() once the writer has caught up
+  m_Writer.mark(info->m_DownloadID, ++info->m_CheckpointToken);
+}
+
+void DownloadManager::finishLater(DownloadInfo* info)
+{
+  QTimer::singleShot(0, this, [this, id = info->m_DownloadID] {
+    DownloadInfo* info = downloadInfoByID(id);
+    if (info != nullptr && info->m_WaitingForSegments) {
+      downloadFinished(indexByInfo(info));
+    }
+  });
+}
+
+void DownloadManager::segmentReadyRead()
+{
+  QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+
+  int index = 0;
+  for (auto&& info : m_ActiveDownloads) {
+    if (auto* seg = info->m_Segments.find(reply)) {
+      if (!writeSegment(info, *seg, reply, reply->readAll())) {
+        log::error("server ignored the range requested for {}", info->m_FileName);
+        seg->tries = 0;
+        reply->abort();
+        return;
+      }
+
+      reportProgress(index, info, 0, info->m_Segments.done(),
+                     info->m_Segments.total());
+      return;
+    }
+
+    ++index;
+  }
+}
+
+void DownloadManager::segmentFinished()
+{
+  QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+  reply->deleteLater();
+
+  int index = 0;
+  for (auto&& info : m_ActiveDownloads) {
+    auto* seg = info->m_Segments.find(reply);
+    if (seg == nullptr) {
+      ++index;
+      continue;
+    }
+
+    if (reply->error() == QNetworkReply::NoError) {
+      writeSegment(info, *seg, reply, reply->readAll());
+    }
+
+    seg->reply = nullptr;
+
+    if (info->m_State != STATE_DOWNLOADING) {
+      return;
+    }
+
+    if (!seg->complete()) {
+      if (seg->tries > 0) {
+        --seg->tries;
+        log::warn("segment {}-{} of {} failed: {}, retrying", seg->begin, seg->end,
+                  info->m_FileName, reply->errorString());
+        startSegment(info, *seg);
+      } else {
+        emit showMessage(tr("Download failed: %1 (%2)")
+                             .arg(reply->errorString())
+                             .arg(reply->error()));
+        setState(info, STATE_ERROR);
+      }
+
+      return;
+    }
+
+    if (info->m_Segments.complete() && info->m_WaitingForSegments) {
+      downloadFinished(index);
+    }
+
+    return;
+  }
+}
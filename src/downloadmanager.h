@@ -20,7 +20,12 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef DOWNLOADMANAGER_H
 #define DOWNLOADMANAGER_H
 
+#include "downloadsegments.h"
+#include "downloadwriter.h"
+#include "filehasher.h"
+#include "metaini.h"
 #include "serverinfo.h"
+#include <QCryptographicHash>
 #include <QElapsedTimer>
 #include <QFile>
 #include <QFileSystemWatcher>
@@ -39,6 +44,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <boost/accumulators/statistics/rolling_mean.hpp>
 #include <boost/signals2.hpp>
 #include <idownloadmanager.h>
+#include <memory>
 #include <modrepositoryfileinfo.h>
 #include <set>
 using namespace boost::accumulators;
@@ -103,6 +109,30 @@ private:
     QDateTime m_Created;  // used as a cache in DownloadManager::getFileTime, may not be
                           // valid elsewhere
     QByteArray m_Hash;
+
+    // md5 of everything written to m_Output, fed by m_Writer as data arrives so
+    // the hash is ready when the download completes; null if the beginning of
+    // the file was written by an earlier session, m_StreamHashSize is the number
+    // of bytes given to the writer so far
+    std::unique_ptr<QCryptographicHash> m_StreamHash;
+    qint64 m_StreamHashSize = 0;
+
+    // ranges fetched over separate connections, empty if the download uses only
+    // m_Reply; m_Reply fetches one of the segments
+    DownloadSegments m_Segments;
+
+    // set when m_Reply is done with its segment and downloadFinished() waits
+    // for the others
+    bool m_WaitingForSegments = false;
+
+    // progress of the segments saved in the .meta file, only what's known to be
+    // on disk; m_Checkpoint is saved once the writer reaches the mark with
+    // m_CheckpointToken, see checkpoint()
+    QString m_SavedSegments;
+    QElapsedTimer m_CheckpointTimer;
+    QString m_Checkpoint;
+    quint64 m_CheckpointToken = 0;
+
     QStringList m_GamesToQuery;
     QString m_RemoteFileName;
 
@@ -119,7 +149,8 @@ private:
                                    const QStringList& URLs);
     static DownloadInfo* createFromMeta(const QString& filePath, bool showHidden,
                                         const QString outputDirectory,
-                                        std::optional<uint64_t> fileSize = {});
+                                        std::optional<uint64_t> fileSize = {},
+                                        const MetaIni* meta              = nullptr);
 
     /**
      * @brief rename the file
@@ -532,6 +563,13 @@ private slots:
   void metaDataChanged();
   void directoryChanged(const QString& dirctory);
   void checkDownloadTimeout();
+  void hashProgress(unsigned int id, qint64 done, qint64 total);
+  void hashFinished(unsigned int id, QByteArray hash);
+  void hashFailed(unsigned int id, QString error);
+  void writerFailed(unsigned int id, QString error);
+  void writerReached(unsigned int id, quint64 token);
+  void segmentReadyRead();
+  void segmentFinished();
 
 private:
   void createMetaFile(DownloadInfo* info);
@@ -586,6 +624,46 @@ private:
 
   void writeData(DownloadInfo* info);
 
+  // queues the given data to be written to the download's file and its
+  // streaming hash, returns false if the file isn't open
+  //
+  bool writeOutput(DownloadInfo* info, const QByteArray& data);
+
+  // splits a download that just started into segments fetched in parallel if
+  // the server allows it and the file is large enough
+  //
+  void splitDownload(DownloadInfo* info);
+
+  // starts a request for the rest of the given segment
+  //
+  void startSegment(DownloadInfo* info, DownloadSegments::Segment& seg);
+
+  // aborts the requests of all the segments other than m_Reply
+  //
+  void abortSegments(DownloadInfo* info);
+
+  // queues data received for a segment at its position in the file, returns
+  // false if the server didn't honour the range of the request
+  //
+  bool writeSegment(DownloadInfo* info, DownloadSegments::Segment& seg,
+                    QNetworkReply* reply, const QByteArray& data);
+
+  // saves the progress of the segments to the .meta file once everything
+  // received so far is on disk, at most every few seconds
+  //
+  void checkpoint(DownloadInfo* info);
+
+  // runs downloadFinished() from the event loop for a download that's waiting
+  // for its segments but has been paused, cancelled or has failed
+  //
+  void finishLater(DownloadInfo* info);
+
+  // updates the progress and speed shown for a download; `base` is what was
+  // already on disk before `received`
+  //
+  void reportProgress(int index, DownloadInfo* info, qint64 base, qint64 received,
+                      qint64 total);
+
 private:
   static const int AUTOMATIC_RETRIES = 3;
 
@@ -624,6 +702,17 @@ private:
   MOBase::IPluginGame const* m_ManagedGame;
 
   QTimer m_TimeoutTimer;
+
+  // writes the data of all the downloads in progress, m_Output is only used for
+  // the name and size of the file
+  DownloadWriter m_Writer;
+
+  // hashes downloads that don't have their md5 stored in their .meta file
+  FileHasher m_Hasher;
+
+  // .meta files of the downloads, so refreshList() only reads the ones that
+  // have changed
+  MetaIniCache m_MetaCache;
 };
 
 class ScopedDisableDirWatcher
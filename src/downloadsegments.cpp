@@ -0,0 +1,121 @@
+#include "downloadsegments.h"
+
+#include <QStringList>
+
+DownloadSegments DownloadSegments::split(qint64 total, int count, qint64 minSize)
+{
+  DownloadSegments s;
+
+  if (minSize > 0) {
+    count = static_cast<int>(std::min<qint64>(count, total / minSize));
+  }
+
+  if (count < 2) {
+    return s;
+  }
+
+  const qint64 size = total / count;
+
+  for (int i = 0; i < count; ++i) {
+    Segment seg;
+    seg.begin = i * size;
+    seg.end   = (i == count - 1) ? total : (i + 1) * size;
+
+    s.m_Segments.push_back(seg);
+  }
+
+  return s;
+}
+
+DownloadSegments DownloadSegments::fromString(const QString& s, qint64 fileSize)
+{
+  DownloadSegments r;
+
+  if (s.isEmpty()) {
+    return r;
+  }
+
+  qint64 expected = 0;
+
+  for (auto&& part : s.split(';')) {
+    const QStringList v = part.split('-');
+    if (v.size() != 3) {
+      return {};
+    }
+
+    bool ok1 = false, ok2 = false, ok3 = false;
+
+    Segment seg;
+    seg.begin = v[0].toLongLong(&ok1);
+    seg.end   = v[1].toLongLong(&ok2);
+    seg.done  = v[2].toLongLong(&ok3);
+
+    // segments must cover the file without holes or overlaps
+    if (!ok1 || !ok2 || !ok3 || seg.begin != expected || seg.end <= seg.begin ||
+        seg.done < 0 || seg.done > seg.end - seg.begin) {
+      return {};
+    }
+
+    expected = seg.end;
+    r.m_Segments.push_back(seg);
+  }
+
+  if (expected != fileSize) {
+    return {};
+  }
+
+  return r;
+}
+
+QString DownloadSegments::toString() const
+{
+  QStringList parts;
+
+  for (auto&& seg : m_Segments) {
+    parts.append(QString("%1-%2-%3").arg(seg.begin).arg(seg.end).arg(seg.done));
+  }
+
+  return parts.join(';');
+}
+
+bool DownloadSegments::complete() const
+{
+  for (auto&& seg : m_Segments) {
+    if (!seg.complete()) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+qint64 DownloadSegments::done() const
+{
+  qint64 n = 0;
+
+  for (auto&& seg : m_Segments) {
+    n += seg.done;
+  }
+
+  return n;
+}
+
+qint64 DownloadSegments::total() const
+{
+  return m_Segments.empty() ? 0 : m_Segments.back().end;
+}
+
+DownloadSegments::Segment* DownloadSegments::find(const QNetworkReply* reply)
+{
+  if (reply == nullptr) {
+    return nullptr;
+  }
+
+  for (auto&& seg : m_Segments) {
+    if (seg.reply == reply) {
+      return &seg;
+    }
+  }
+
+  return nullptr;
+}
@@ -0,0 +1,79 @@
+#ifndef DOWNLOADSEGMENTS_H
+#define DOWNLOADSEGMENTS_H
+
+#include <QString>
+#include <QtGlobal>
+
+#include <vector>
+
+class QNetworkReply;
+
+// byte ranges of a download that are fetched over separate connections; the
+// file is created with its final size and every segment writes into its own
+// region
+//
+// segments are saved in the .meta file as "begin-end-done;..." so a paused or
+// interrupted download continues each of them where it stopped
+//
+class DownloadSegments
+{
+public:
+  struct Segment
+  {
+    // [begin, end) of the file
+    qint64 begin = 0;
+    qint64 end   = 0;
+
+    // bytes of the range that have been received
+    qint64 done = 0;
+
+    // request fetching the rest of the range, null when there's none
+    QNetworkReply* reply = nullptr;
+
+    // automatic retries left for this segment
+    int tries = 0;
+
+    qint64 position() const { return begin + done; }
+    qint64 remaining() const { return end - begin - done; }
+    bool complete() const { return done >= end - begin; }
+  };
+
+  // splits a file of the given size in `count` segments, less if they would be
+  // smaller than `minSize`; returns empty segments if there would be only one
+  //
+  static DownloadSegments split(qint64 total, int count, qint64 minSize);
+
+  // parses the value saved in the .meta file, returns empty segments if it's
+  // invalid or doesn't match the size of the file
+  //
+  static DownloadSegments fromString(const QString& s, qint64 fileSize);
+
+  // value saved in the .meta file
+  //
+  QString toString() const;
+
+  bool empty() const { return m_Segments.empty(); }
+
+  // whether all the segments are complete, true if there are none
+  //
+  bool complete() const;
+
+  // sum of the bytes received for all the segments and size of the file
+  //
+  qint64 done() const;
+  qint64 total() const;
+
+  // segment fetched by the given request, or null
+  //
+  Segment* find(const QNetworkReply* reply);
+
+  auto begin() { return m_Segments.begin(); }
+  auto end() { return m_Segments.end(); }
+
+  void clear() { m_Segments.clear(); }
+
+private:
+  std::vector<Segment> m_Segments;
+};
+
+#endif  // DOWNLOADSEGMENTS_H
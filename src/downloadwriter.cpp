@@ -0,0 +1,389 @@
+#include "downloadwriter.h"
+#include "envmodule.h"
+#include <log.h>
+#include <utility.h>
+
+#include <QCryptographicHash>
+#include <QDir>
+
+#include <Windows.h>
+
+using namespace MOBase;
+
+// largest block given to WriteFile() at once, buffers are merged up to this
+static constexpr qint64 BlockSize = 4 * 1024 * 1024;
+
+// write() blocks while this much is queued for all the downloads, which only
+// happens when the disk can't keep up with the network
+static constexpr qint64 MaxQueued = 64 * 1024 * 1024;
+
+// one entry in the queue of a file: data to write, a size for the file or a
+// mark to report
+//
+struct DownloadWriter::Chunk
+{
+  QByteArray data;
+
+  // -1 to write after the previous chunk
+  qint64 offset = -1;
+
+  // set by resize()
+  qint64 size = -1;
+
+  // set by mark()
+  bool mark     = false;
+  quint64 token = 0;
+};
+
+struct DownloadWriter::File
+{
+  env::HandlePtr handle;
+  QString path;
+  QCryptographicHash* hash = nullptr;
+
+  std::deque<Chunk> queue;
+  qint64 queued  = 0;
+  qint64 reserve = 0;
+
+  // set while the worker is writing a block for this file without the lock
+  bool busy   = false;
+  bool failed = false;
+};
+
+DownloadWriter::DownloadWriter(QObject* parent) : QObject(parent)
+{
+  m_Thread = std::thread([this] {
+    run();
+  });
+}
+
+DownloadWriter::~DownloadWriter()
+{
+  {
+    std::scoped_lock lock(m_Mutex);
+    m_Stop = true;
+  }
+
+  m_Wake.notify_all();
+  m_Thread.join();
+}
+
+bool DownloadWriter::open(unsigned int id, const QString& path, bool append,
+                          QCryptographicHash* hash, QString* error)
+{
+  // the file can still be renamed or deleted while it's open, like it could when
+  // it was a QFile
+  env::HandlePtr h(::CreateFileW(
+      ToWString(QDir::toNativeSeparators(path)).c_str(), GENERIC_WRITE,
+      FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr,
+      append ? OPEN_ALWAYS : CREATE_ALWAYS,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr));
+
+  if (h.get() == INVALID_HANDLE_VALUE) {
+    const auto e = ::GetLastError();
+    if (error) {
+      *error = QString::fromStdWString(formatSystemMessage(e));
+    }
+    return false;
+  }
+
+  if (append) {
+    LARGE_INTEGER zero = {};
+    if (!::SetFilePointerEx(h.get(), zero, nullptr, FILE_END)) {
+      const auto e = ::GetLastError();
+      if (error) {
+        *error = QString::fromStdWString(formatSystemMessage(e));
+      }
+      return false;
+    }
+  }
+
+  auto f    = std::make_unique<File>();
+  f->handle = std::move(h);
+  f->path   = path;
+  f->hash   = hash;
+
+  std::scoped_lock lock(m_Mutex);
+
+  if (m_Files.contains(id)) {
+    log::error("download {} is already open for writing", path);
+    if (error) {
+      *error = tr("already open");
+    }
+    return false;
+  }
+
+  m_Files.emplace(id, std::move(f));
+
+  return true;
+}
+
+void DownloadWriter::reserve(unsigned int id, qint64 size)
+{
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    auto itor = m_Files.find(id);
+    if (itor == m_Files.end() || size <= 0) {
+      return;
+    }
+
+    itor->second->reserve = size;
+  }
+
+  m_Wake.notify_one();
+}
+
+void DownloadWriter::resize(unsigned int id, qint64 size)
+{
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    auto itor = m_Files.find(id);
+    if (itor == m_Files.end() || itor->second->failed) {
+      return;
+    }
+
+    Chunk c;
+    c.size = size;
+    itor->second->queue.push_back(std::move(c));
+  }
+
+  m_Wake.notify_one();
+}
+
+void DownloadWriter::mark(unsigned int id, quint64 token)
+{
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    auto itor = m_Files.find(id);
+    if (itor == m_Files.end() || itor->second->failed) {
+      return;
+    }
+
+    Chunk c;
+    c.mark  = true;
+    c.token = token;
+    itor->second->queue.push_back(std::move(c));
+  }
+
+  m_Wake.notify_one();
+}
+
+bool DownloadWriter::write(unsigned int id, QByteArray data, qint64 offset)
+{
+  {
+    std::unique_lock lock(m_Mutex);
+
+    m_Done.wait(lock, [&] {
+      return m_Queued < MaxQueued;
+    });
+
+    auto itor = m_Files.find(id);
+    if (itor == m_Files.end()) {
+      return false;
+    }
+
+    File& f = *itor->second;
+    if (f.failed || data.isEmpty()) {
+      return true;
+    }
+
+    f.queued += data.size();
+    m_Queued += data.size();
+    f.queue.push_back({std::move(data), offset});
+  }
+
+  m_Wake.notify_one();
+  return true;
+}
+
+bool DownloadWriter::close(unsigned int id)
+{
+  std::unique_lock lock(m_Mutex);
+
+  auto itor = m_Files.find(id);
+  if (itor == m_Files.end()) {
+    return true;
+  }
+
+  File& f = *itor->second;
+
+  m_Done.wait(lock, [&] {
+    return f.queue.empty() && !f.busy;
+  });
+
+  const bool ok = !f.failed;
+
+  // closing can take a moment when the file is large, but it must be closed
+  // before returning so the caller can rename it
+  m_Files.erase(itor);
+
+  return ok;
+}
+
+bool DownloadWriter::isOpen(unsigned int id) const
+{
+  std::scoped_lock lock(m_Mutex);
+  return m_Files.contains(id);
+}
+
+void DownloadWriter::run()
+{
+  std::unique_lock lock(m_Mutex);
+
+  for (;;) {
+    File* f = nullptr;
+
+    m_Wake.wait(lock, [&] {
+      f = nextFile();
+      return f != nullptr || m_Stop;
+    });
+
+    if (f == nullptr) {
+      // stopping and nothing left to write
+      return;
+    }
+
+    writeBlock(m_Next, *f, lock);
+    m_Done.notify_all();
+  }
+}
+
+DownloadWriter::File* DownloadWriter::nextFile()
+{
+  auto hasWork = [](auto&& p) {
+    return !p.second->busy && (!p.second->queue.empty() || p.second->reserve > 0);
+  };
+
+  // starts after the last file that was written so one fast download doesn't
+  // keep the others waiting
+  auto itor = std::find_if(m_Files.upper_bound(m_Next), m_Files.end(), hasWork);
+
+  if (itor == m_Files.end()) {
+    itor = std::find_if(m_Files.begin(), m_Files.end(), hasWork);
+  }
+
+  if (itor == m_Files.end()) {
+    return nullptr;
+  }
+
+  m_Next = itor->first;
+  return itor->second.get();
+}
+
+void DownloadWriter::writeBlock(unsigned int id, File& f,
+                                std::unique_lock<std::mutex>& lock)
+{
+  const qint64 reserve = std::exchange(f.reserve, 0);
+
+  // a mark or a resize is handled on its own; otherwise, contiguous chunks are
+  // taken until the block is full, a single chunk larger than a block is
+  // written as is
+  Chunk block;
+
+  if (!f.queue.empty() && (f.queue.front().mark || f.queue.front().size >= 0)) {
+    block = std::move(f.queue.front());
+    f.queue.pop_front();
+  } else {
+    while (!f.queue.empty()) {
+      Chunk& front = f.queue.front();
+
+      if (front.mark || front.size >= 0) {
+        break;
+      }
+
+      if (!block.data.isEmpty()) {
+        const bool contiguous =
+            (front.offset == -1 && block.offset == -1) ||
+            (front.offset >= 0 && block.offset >= 0 &&
+             front.offset == block.offset + block.data.size());
+
+        if (!contiguous || block.data.size() + front.data.size() > BlockSize) {
+          break;
+        }
+      }
+
+      if (block.data.isEmpty()) {
+        block = std::move(front);
+      } else {
+        block.data.reserve(BlockSize);
+        block.data.append(front.data);
+      }
+
+      f.queue.pop_front();
+    }
+  }
+
+  f.busy = true;
+  lock.unlock();
+
+  QString error;
+
+  if (reserve > 0) {
+    FILE_ALLOCATION_INFO info = {};
+    info.AllocationSize.QuadPart = reserve;
+
+    // only a hint, some file systems don't support it
+    if (!::SetFileInformationByHandle(f.handle.get(), FileAllocationInfo, &info,
+                                      sizeof(info))) {
+      const auto e = ::GetLastError();
+      log::debug("can't reserve {} bytes for {}: {}", reserve, f.path,
+                 formatSystemMessage(e));
+    }
+  }
+
+  if (block.size >= 0) {
+    LARGE_INTEGER pos = {};
+    pos.QuadPart      = block.size;
+
+    if (!::SetFilePointerEx(f.handle.get(), pos, nullptr, FILE_BEGIN) ||
+        !::SetEndOfFile(f.handle.get())) {
+      error = QString::fromStdWString(formatSystemMessage(::GetLastError()));
+    }
+  } else if (!block.data.isEmpty()) {
+    // writes at an offset go through an OVERLAPPED even though the handle is
+    // synchronous, it only gives the position
+    OVERLAPPED ov = {};
+    if (block.offset >= 0) {
+      ov.Offset     = static_cast<DWORD>(block.offset & 0xffffffff);
+      ov.OffsetHigh = static_cast<DWORD>(block.offset >> 32);
+    }
+
+    DWORD written = 0;
+
+    if (!::WriteFile(f.handle.get(), block.data.constData(),
+                     static_cast<DWORD>(block.data.size()), &written,
+                     block.offset >= 0 ? &ov : nullptr)) {
+      error = QString::fromStdWString(formatSystemMessage(::GetLastError()));
+    } else if (written != static_cast<DWORD>(block.data.size())) {
+      error = tr("only %1 of %2 bytes were written")
+                  .arg(written)
+                  .arg(block.data.size());
+    } else if (f.hash && block.offset == -1) {
+      f.hash->addData(block.data);
+    }
+  }
+
+  lock.lock();
+
+  f.busy = false;
+  f.queued -= block.data.size();
+  m_Queued -= block.data.size();
+
+  if (!error.isEmpty()) {
+    log::error("failed to write to {}: {}", f.path, error);
+
+    f.failed = true;
+    m_Queued -= f.queued;
+    f.queued = 0;
+    f.queue.clear();
+
+    // the signals are queued to the gui thread, emitting them under the lock is
+    // fine
+    emit failed(id, error);
+  } else if (block.mark) {
+    emit reached(id, block.token);
+  }
+}
@@ -0,0 +1,114 @@
+#ifndef DOWNLOADWRITER_H
+#define DOWNLOADWRITER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class QCryptographicHash;
+
+// writes the data of downloads to disk on a worker thread shared by all of
+// them, so the gui thread only hands over the buffers it got from the network
+//
+// buffers that pile up while the disk is busy are written together in large
+// sequential blocks; the disk space for a download is reserved once its size is
+// known, without changing the size of the file, so resuming still works from
+// whatever is on disk
+//
+// downloads are identified by an arbitrary id given by the caller
+//
+class DownloadWriter : public QObject
+{
+  Q_OBJECT
+
+public:
+  explicit DownloadWriter(QObject* parent = nullptr);
+
+  // writes everything that's still queued, closes all the files and waits for
+  // the worker to finish
+  //
+  ~DownloadWriter();
+
+  // opens the file for the given download, truncating it unless `append` is
+  // set; if `hash` is given, everything written is also added to it, it must
+  // stay valid until close()
+  //
+  // returns false and sets `error` if the file can't be opened
+  //
+  bool open(unsigned int id, const QString& path, bool append,
+            QCryptographicHash* hash, QString* error);
+
+  // reserves disk space for a file that will be `size` bytes once complete
+  //
+  void reserve(unsigned int id, qint64 size);
+
+  // sets the size of the file before anything else that's queued after this
+  // is written, used by segmented downloads that write at arbitrary offsets
+  //
+  void resize(unsigned int id, qint64 size);
+
+  // queues data to be written at the given offset, or after the last write if
+  // it's -1; returns false if the download isn't open
+  //
+  // only data written without an offset is added to the hash given to open()
+  //
+  // this blocks if too much data is already waiting for the disk
+  //
+  bool write(unsigned int id, QByteArray data, qint64 offset = -1);
+
+  // reached() is emitted with the given token once everything queued for the
+  // download before this call has been written
+  //
+  void mark(unsigned int id, quint64 token);
+
+  // waits until everything queued for the download has been written and
+  // closes the file, returns false if writing failed at some point
+  //
+  bool close(unsigned int id);
+
+  // whether the given download has been opened and not closed yet
+  //
+  bool isOpen(unsigned int id) const;
+
+signals:
+  // emitted once when writing to a download's file fails, whatever was queued
+  // for it is dropped and later writes are ignored until it's closed
+  //
+  void failed(unsigned int id, QString error);
+
+  // see mark()
+  //
+  void reached(unsigned int id, quint64 token);
+
+private:
+  struct Chunk;
+  struct File;
+
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_Wake;
+  std::condition_variable m_Done;
+  bool m_Stop = false;
+
+  std::map<unsigned int, std::unique_ptr<File>> m_Files;
+
+  // bytes queued for all the files, write() waits while this is too large
+  qint64 m_Queued = 0;
+
+  // where the worker starts looking for work, so downloads take turns
+  unsigned int m_Next = 0;
+
+  std::thread m_Thread;
+
+  void run();
+  File* nextFile();
+  void writeBlock(unsigned int id, File& f, std::unique_lock<std::mutex>& lock);
+};
+
+#endif  // DOWNLOADWRITER_H
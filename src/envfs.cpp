@@ -205,10 +205,15 @@ void setHandleCloserThreadCount(std::size_t n)
   g_handleClosers.setMax(n);
 }
 
-void forEachEntryImpl(void* cx, HandleCloserThread& hc,
+// walks the directory given in poa; handles are given to hc to be closed later,
+// or closed before returning if hc is null
+//
+// when recurse is false, subdirectories are only given to dirStartF
+//
+void forEachEntryImpl(void* cx, HandleCloserThread* hc,
                       std::vector<std::unique_ptr<unsigned char[]>>& buffers,
-                      POBJECT_ATTRIBUTES poa, std::size_t depth, DirStartF* dirStartF,
-                      DirEndF* dirEndF, FileF* fileF)
+                      POBJECT_ATTRIBUTES poa, std::size_t depth, bool recurse,
+                      DirStartF* dirStartF, DirEndF* dirEndF, FileF* fileF)
 {
   IO_STATUS_BLOCK iosb;
   UNICODE_STRING ObjectName;
@@ -226,7 +231,10 @@ void forEachEntryImpl(void* cx, HandleCloserThread& hc,
     return;
   }
 
-  hc.add(oa.RootDirectory);
+  if (hc) {
+    hc->add(oa.RootDirectory);
+  }
+
   unsigned char* buffer;
 
   if (depth >= buffers.size()) {
@@ -292,10 +300,14 @@ void forEachEntryImpl(void* cx, HandleCloserThread& hc,
         ObjectName.MaximumLength = ObjectName.Length;
 
         if (DirInfo->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-          if (dirStartF && dirEndF) {
+          if (!recurse) {
+            if (dirStartF) {
+              dirStartF(cx, toStringView(&oa));
+            }
+          } else if (dirStartF && dirEndF) {
             dirStartF(cx, toStringView(&oa));
-            forEachEntryImpl(cx, hc, buffers, &oa, depth + 1, dirStartF, dirEndF,
-                             fileF);
+            forEachEntryImpl(cx, hc, buffers, &oa, depth + 1, true, dirStartF,
+                             dirEndF, fileF);
             dirEndF(cx, toStringView(&oa));
           }
         } else {
@@ -314,6 +326,10 @@ void forEachEntryImpl(void* cx, HandleCloserThread& hc,
       }
     }
   }
+
+  if (!hc) {
+    NtClose(oa.RootDirectory);
+  }
 }
 
 std::wstring makeNtPath(const std::wstring& path)
@@ -334,18 +350,25 @@ std::wstring makeNtPath(const std::wstring& path)
   }
 }
 
-void DirectoryWalker::forEachEntry(const std::wstring& path, void* cx,
-                                   DirStartF* dirStartF, DirEndF* dirEndF, FileF* fileF)
+void loadNtFunctions()
 {
-  auto& hc = g_handleClosers.request();
+  static std::once_flag once;
 
-  if (!NtOpenFile) {
+  std::call_once(once, [] {
     LibraryPtr m(::LoadLibraryW(L"ntdll.dll"));
     NtOpenFile = (NtOpenFile_type)::GetProcAddress(m.get(), "NtOpenFile");
     NtQueryDirectoryFile =
         (NtQueryDirectoryFile_type)::GetProcAddress(m.get(), "NtQueryDirectoryFile");
     NtClose = (NtClose_type)::GetProcAddress(m.get(), "NtClose");
-  }
+  });
+}
+
+void DirectoryWalker::forEachEntry(const std::wstring& path, void* cx,
+                                   DirStartF* dirStartF, DirEndF* dirEndF, FileF* fileF)
+{
+  auto& hc = g_handleClosers.request();
+
+  loadNtFunctions();
 
   const std::wstring ntpath = makeNtPath(path);
 
@@ -358,10 +381,30 @@ void DirectoryWalker::forEachEntry(const std::wstring& path, void* cx,
   oa.Length            = sizeof(oa);
   oa.ObjectName        = &ObjectName;
 
-  forEachEntryImpl(cx, hc, m_buffers, &oa, 0, dirStartF, dirEndF, fileF);
+  forEachEntryImpl(cx, &hc, m_buffers, &oa, 0, true, dirStartF, dirEndF, fileF);
   hc.wakeup();
 }
 
+void DirectoryWalker::listDirectory(const std::wstring& path, void* cx,
+                                    DirStartF* dirF, FileF* fileF)
+{
+  loadNtFunctions();
+
+  const std::wstring ntpath = makeNtPath(path);
+
+  UNICODE_STRING ObjectName = {};
+  ObjectName.Buffer         = const_cast<wchar_t*>(ntpath.c_str());
+  ObjectName.Length         = (USHORT)ntpath.size() * sizeof(wchar_t);
+  ObjectName.MaximumLength  = ObjectName.Length;
+
+  OBJECT_ATTRIBUTES oa = {};
+  oa.Length            = sizeof(oa);
+  oa.ObjectName        = &ObjectName;
+
+  // a single handle, not worth handing to a closer thread
+  forEachEntryImpl(cx, nullptr, m_buffers, &oa, 0, false, dirF, nullptr, fileF);
+}
+
 void forEachEntry(const std::wstring& path, void* cx, DirStartF* dirStartF,
                   DirEndF* dirEndF, FileF* fileF)
 {
@@ -403,6 +446,103 @@ Directory getFilesAndDirs(const std::wstring& path)
   return root;
 }
 
+// state shared by all the tasks listing the same tree
+//
+struct TreeListing
+{
+  MOShared::TaskScheduler& scheduler;
+  std::function<void(std::exception_ptr)> done;
+
+  // directories that are queued or being listed
+  std::atomic<std::size_t> pending;
+
+  // first error, given to `done`
+  std::mutex mutex;
+  std::exception_ptr error;
+
+  TreeListing(MOShared::TaskScheduler& s, std::function<void(std::exception_ptr)> f)
+      : scheduler(s), done(std::move(f)), pending(1)
+  {}
+
+  void fail(std::exception_ptr e)
+  {
+    std::scoped_lock lock(mutex);
+
+    if (!error) {
+      error = e;
+    }
+  }
+};
+
+void listDirectoryTask(std::shared_ptr<TreeListing> listing, const std::wstring& path,
+                       Directory& d)
+{
+  // this task is done even if something below throws; the directory is left
+  // partially listed, but the listing still finishes instead of never calling
+  // `done`
+  Guard g([&] {
+    if (--listing->pending == 0 && listing->done) {
+      std::exception_ptr error;
+
+      {
+        std::scoped_lock lock(listing->mutex);
+        error = listing->error;
+      }
+
+      try {
+        listing->done(error);
+      } catch (std::exception& e) {
+        log::error("failed to finish listing '{}': {}", path, e.what());
+      }
+    }
+  });
+
+  // keeps its buffer for the next tasks on this thread
+  thread_local DirectoryWalker walker;
+
+  try {
+    walker.listDirectory(
+        path, &d,
+        [](void* pd, std::wstring_view name) {
+          static_cast<Directory*>(pd)->dirs.push_back(Directory(name));
+        },
+
+        [](void* pd, std::wstring_view name, FILETIME ft, uint64_t size) {
+          static_cast<Directory*>(pd)->files.push_back(File(name, ft, size));
+        });
+  } catch (...) {
+    // given to `done` instead of only being logged by the scheduler
+    listing->fail(std::current_exception());
+    return;
+  }
+
+  // d.dirs doesn't change anymore, each subdirectory is now filled by its own
+  // task; each one is counted before it's submitted, and this task is still
+  // counted until it returns, so the listing can't finish early
+  for (auto& sd : d.dirs) {
+    ++listing->pending;
+
+    try {
+      listing->scheduler.submit([listing, p = path + L"\\" + sd.name, &sd] {
+        listDirectoryTask(listing, p, sd);
+      });
+    } catch (...) {
+      --listing->pending;
+      throw;
+    }
+  }
+}
+
+void getFilesAndDirs(MOShared::TaskScheduler& scheduler, const std::wstring& path,
+                     Directory& root, std::function<void(std::exception_ptr)> done)
+{
+  auto listing = std::make_shared<TreeListing>(scheduler, std::move(done));
+
+  scheduler.submit([listing, path, &root] {
+    listDirectoryTask(listing, path, root);
+  });
+}
+
 File::File(std::wstring_view n, FILETIME ft, uint64_t s)
     : name(n.begin(), n.end()), lcname(MOShared::ToLowerCopy(name)), lastModified(ft),
       size(s)
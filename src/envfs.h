@@ -2,6 +2,7 @@
 #define ENV_ENVFS_H
 
 #include "thread_utils.h"
+#include <exception>
 #include <thread>
 
 namespace env
@@ -29,6 +30,9 @@ struct Directory
   Directory(std::wstring_view name);
 };
 
+// fixed number of threads, each running its own T; request() hands out an idle
+// one and blocks until there is one
+//
 template <class T>
 class ThreadPool
 {
@@ -37,7 +41,16 @@ public:
 
   ~ThreadPool() { stopAndJoin(); }
 
-  void setMax(std::size_t n) { m_threads.resize(n); }
+  void setMax(std::size_t n)
+  {
+    while (m_threads.size() < n) {
+      m_threads.emplace_back(*this);
+    }
+
+    while (m_threads.size() > n) {
+      m_threads.pop_back();
+    }
+  }
 
   void stopAndJoin()
   {
@@ -55,22 +68,17 @@ public:
 
   void waitForAll()
   {
-    for (;;) {
-      bool done = true;
+    std::unique_lock lock(m_mutex);
 
+    m_idle.wait(lock, [&] {
       for (auto& ti : m_threads) {
         if (ti.busy) {
-          done = false;
-          break;
+          return false;
         }
       }
 
-      if (done) {
-        break;
-      }
-
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
-    }
+      return true;
+    });
   }
 
   T& request()
@@ -79,17 +87,22 @@ public:
       std::terminate();
     }
 
+    std::unique_lock lock(m_mutex);
+
     for (;;) {
       for (auto& ti : m_threads) {
         bool expected = false;
 
         if (ti.busy.compare_exchange_strong(expected, true)) {
+          // wakeup() locks the thread's mutex, which the thread holds while
+          // it's marking itself as idle under m_mutex
+          lock.unlock();
           ti.wakeup();
           return ti.o;
         }
       }
 
-      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      m_idle.wait(lock);
     }
   }
 
@@ -104,6 +117,7 @@ public:
 private:
   struct ThreadInfo
   {
+    ThreadPool& pool;
     std::thread thread;
     std::atomic<bool> busy;
     T o;
@@ -114,7 +128,7 @@ private:
 
     std::atomic<bool> stop;
 
-    ThreadInfo() : busy(true), ready(false), stop(false)
+    ThreadInfo(ThreadPool& p) : pool(p), busy(true), ready(false), stop(false)
     {
       thread = MOShared::startSafeThread([&] {
         run();
@@ -140,9 +154,19 @@ private:
       cv.notify_one();
     }
 
+    void setIdle()
+    {
+      {
+        std::scoped_lock lock(pool.m_mutex);
+        busy = false;
+      }
+
+      pool.m_idle.notify_all();
+    }
+
     void run()
     {
-      busy = false;
+      setIdle();
 
       while (!stop) {
         std::unique_lock lock(mutex);
@@ -157,11 +181,16 @@ private:
         o.run();
 
         ready = false;
-        busy  = false;
+        setIdle();
       }
     }
   };
 
+  // notified when a thread becomes idle, busy flags are changed to false under
+  // m_mutex
+  std::mutex m_mutex;
+  std::condition_variable m_idle;
+
   std::list<ThreadInfo> m_threads;
 };
 
@@ -177,6 +206,12 @@ public:
   void forEachEntry(const std::wstring& path, void* cx, DirStartF* dirStartF,
                     DirEndF* dirEndF, FileF* fileF);
 
+  // lists the given directory without going into subdirectories: dirF is called
+  // with the name of every subdirectory and fileF for every file
+  //
+  void listDirectory(const std::wstring& path, void* cx, DirStartF* dirF,
+                     FileF* fileF);
+
 private:
   std::vector<std::unique_ptr<unsigned char[]>> m_buffers;
 };
@@ -185,6 +220,18 @@ void forEachEntry(const std::wstring& path, void* cx, DirStartF* dirStartF,
                   DirEndF* dirEndF, FileF* fileF);
 
 Directory getFilesAndDirs(const std::wstring& path);
+
+// same as above, but every directory is listed by its own task on the given
+// scheduler so a large tree is spread over all its threads; returns right away
+// and calls done() from the last task once root has been filled
+//
+// directories that fail to be listed are left empty and the listing goes on;
+// done() is given the first error, or null if there were none
+//
+// root must not be touched by anything else until then
+//
+void getFilesAndDirs(MOShared::TaskScheduler& scheduler, const std::wstring& path,
+                     Directory& root, std::function<void(std::exception_ptr)> done);
 Directory getFilesAndDirsWithFind(const std::wstring& path);
 
 }  // namespace env
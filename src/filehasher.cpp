@@ -0,0 +1,172 @@
+#include "filehasher.h"
+#include <log.h>
+
+#include <QCryptographicHash>
+#include <QFile>
+
+using namespace MOBase;
+
+// size of the mapped windows, also how often cancellation is checked and
+// progress reported
+static constexpr qint64 WindowSize = 16 * 1024 * 1024;
+
+FileHasher::FileHasher(std::size_t maxQueued, QObject* parent)
+    : QObject(parent), m_MaxQueued(maxQueued)
+{
+  m_Thread = std::thread([this] {
+    run();
+  });
+}
+
+FileHasher::~FileHasher()
+{
+  {
+    std::scoped_lock lock(m_Mutex);
+    m_Stop = true;
+    m_Queue.clear();
+    m_CancelCurrent = true;
+  }
+
+  m_Wake.notify_all();
+  m_Thread.join();
+}
+
+bool FileHasher::submit(unsigned int id, const QString& path)
+{
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    if (m_Queue.size() >= m_MaxQueued) {
+      return false;
+    }
+
+    if (m_Running && m_Current == id) {
+      return false;
+    }
+
+    for (auto&& j : m_Queue) {
+      if (j.id == id) {
+        return false;
+      }
+    }
+
+    m_Queue.push_back({id, path});
+  }
+
+  m_Wake.notify_one();
+  return true;
+}
+
+void FileHasher::cancel(unsigned int id)
+{
+  std::unique_lock lock(m_Mutex);
+
+  std::erase_if(m_Queue, [&](auto&& j) {
+    return j.id == id;
+  });
+
+  if (m_Running && m_Current == id) {
+    m_CancelCurrent = true;
+
+    m_Done.wait(lock, [&] {
+      return !m_Running || m_Current != id;
+    });
+  }
+}
+
+bool FileHasher::pending(unsigned int id) const
+{
+  std::scoped_lock lock(m_Mutex);
+
+  if (m_Running && m_Current == id) {
+    return true;
+  }
+
+  for (auto&& j : m_Queue) {
+    if (j.id == id) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+void FileHasher::run()
+{
+  for (;;) {
+    Job job;
+
+    {
+      std::unique_lock lock(m_Mutex);
+
+      if (m_Running) {
+        m_Running = false;
+        m_Done.notify_all();
+      }
+
+      m_Wake.wait(lock, [&] {
+        return m_Stop || !m_Queue.empty();
+      });
+
+      if (m_Stop) {
+        return;
+      }
+
+      job = std::move(m_Queue.front());
+      m_Queue.pop_front();
+
+      m_Current       = job.id;
+      m_Running       = true;
+      m_CancelCurrent = false;
+    }
+
+    hash(job);
+  }
+}
+
+void FileHasher::hash(const Job& job)
+{
+  QFile file(job.path);
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    emit failed(job.id, file.errorString());
+    return;
+  }
+
+  const qint64 total = file.size();
+  QCryptographicHash md5(QCryptographicHash::Md5);
+
+  for (qint64 offset = 0; offset < total; offset += WindowSize) {
+    if (m_CancelCurrent) {
+      log::debug("hashing of '{}' was cancelled", job.path);
+      return;
+    }
+
+    const qint64 size = std::min(WindowSize, total - offset);
+
+    // mapping can fail on some network drives, reading the window is slower
+    // but works everywhere
+    if (uchar* p = file.map(offset, size)) {
+      md5.addData(reinterpret_cast<const char*>(p), static_cast<int>(size));
+      file.unmap(p);
+    } else {
+      file.seek(offset);
+      const QByteArray data = file.read(size);
+
+      if (data.size() != size) {
+        emit failed(job.id, file.errorString());
+        return;
+      }
+
+      md5.addData(data);
+    }
+
+    emit progress(job.id, offset + size, total);
+  }
+
+  if (m_CancelCurrent) {
+    return;
+  }
+
+  emit finished(job.id, md5.result());
+}
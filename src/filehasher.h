@@ -0,0 +1,80 @@
+#ifndef FILEHASHER_H
+#define FILEHASHER_H
+
+#include <QByteArray>
+#include <QObject>
+#include <QString>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// computes md5 hashes of files on a worker thread, used for downloads that
+// don't have their hash stored in their .meta file yet
+//
+// files are read through memory mappings in windows of a few megabytes; jobs
+// are identified by an arbitrary id given by the caller, finished() and
+// failed() are emitted on the thread the hasher lives in
+//
+class FileHasher : public QObject
+{
+  Q_OBJECT
+
+public:
+  // at most `maxQueued` files can be waiting, submit() refuses more
+  //
+  explicit FileHasher(std::size_t maxQueued = 16, QObject* parent = nullptr);
+
+  // cancels everything and waits for the worker to finish
+  //
+  ~FileHasher();
+
+  // queues the given file, returns false if the queue is full or if a job with
+  // the same id is already queued or running
+  //
+  bool submit(unsigned int id, const QString& path);
+
+  // drops the given job if it's queued or stops it if it's running, nothing is
+  // emitted for it; if it's running, this waits until the file has been closed
+  // so it can be deleted or renamed right after
+  //
+  void cancel(unsigned int id);
+
+  // whether the given job is queued or running
+  //
+  bool pending(unsigned int id) const;
+
+signals:
+  void progress(unsigned int id, qint64 done, qint64 total);
+  void finished(unsigned int id, QByteArray hash);
+  void failed(unsigned int id, QString error);
+
+private:
+  struct Job
+  {
+    unsigned int id;
+    QString path;
+  };
+
+  const std::size_t m_MaxQueued;
+
+  mutable std::mutex m_Mutex;
+  std::condition_variable m_Wake;
+  std::condition_variable m_Done;
+  std::deque<Job> m_Queue;
+  bool m_Stop = false;
+
+  // id of the job being hashed, only meaningful while m_Running is set
+  unsigned int m_Current = 0;
+  bool m_Running         = false;
+  std::atomic<bool> m_CancelCurrent{false};
+
+  std::thread m_Thread;
+
+  void run();
+  void hash(const Job& job);
+};
+
+#endif  // FILEHASHER_H
@@ -0,0 +1,249 @@
+#include "filequery.h"
+#include "glob_matching.h"
+#include "shared/directoryentry.h"
+#include "shared/fileentry.h"
+#include "shared/fileregister.h"
+
+#include <algorithm>
+#include <span>
+
+using namespace MOShared;
+
+// hash of the path of a child given the hash of its parent's path; children of
+// the root are hashed on their own
+//
+static std::size_t childHash(std::wstring_view name, std::size_t parentHash, bool top)
+{
+  if (top) {
+    return hashCaseFolded(name);
+  }
+
+  return hashCaseFolded(name, hashCaseFolded(L"\\", parentHash));
+}
+
+// extension of the given name without the dot, empty if there is none
+//
+static std::wstring_view extension(std::wstring_view name)
+{
+  const auto dot = name.rfind(L'.');
+  if (dot == std::wstring_view::npos) {
+    return {};
+  }
+
+  return name.substr(dot + 1);
+}
+
+// whether the glob is "*.ext" with a plain extension, which can be answered by
+// the extension index
+//
+static bool isExtensionGlob(const QString& glob)
+{
+  if (glob.size() < 3 || !glob.startsWith("*.")) {
+    return false;
+  }
+
+  for (int i = 2; i < glob.size(); ++i) {
+    const QChar c = glob[i];
+    if (c == '*' || c == '?' || c == '[' || c == ']' || c == '.') {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+// whether the file is at the given path, compares the names of the file and
+// its parents with the components of the path, starting from the end
+//
+static bool isAt(FileEntry& file, std::span<const std::wstring_view> parts)
+{
+  if (!equalsCaseFolded(file.getName(), parts.back())) {
+    return false;
+  }
+
+  const DirectoryEntry* dir = file.getParent();
+
+  for (std::size_t i = parts.size() - 1; i-- > 0;) {
+    if (!dir || !equalsCaseFolded(dir->getName(), parts[i])) {
+      return false;
+    }
+
+    dir = dir->getParent();
+  }
+
+  // must have reached the root
+  return (dir != nullptr && dir->getParent() == nullptr);
+}
+
+FileQuery FileQuery::build(DirectoryEntry& root)
+{
+  FileQuery q;
+
+  // the counts are taken first, files added during the walk make the index
+  // stale instead of being missed silently
+  q.m_Register     = root.getFileRegister();
+  q.m_FileCount    = q.m_Register->highestCount();
+  q.m_RemovedCount = q.m_Register->removedCount();
+
+  const auto expected = q.m_FileCount - std::min(q.m_FileCount, q.m_RemovedCount);
+  q.m_Paths.reserve(expected);
+  q.m_Extensions.reserve(expected);
+
+  q.add(root, 0, true);
+
+  std::sort(q.m_Paths.begin(), q.m_Paths.end());
+
+  std::sort(q.m_Extensions.begin(), q.m_Extensions.end());
+
+  return q;
+}
+
+void FileQuery::add(const DirectoryEntry& dir, std::size_t pathHash, bool top)
+{
+  dir.forEachFile([&](FileEntry& file) {
+    const std::wstring_view name = file.getName();
+
+    m_Paths.push_back({childHash(name, pathHash, top), file.getIndex()});
+
+    const auto ext = extension(name);
+    if (!ext.empty()) {
+      m_Extensions.push_back({&dir, hashCaseFolded(ext), file.getIndex()});
+    }
+
+    return true;
+  });
+
+  for (const DirectoryEntry* sub : dir.getSubDirectories()) {
+    add(*sub, childHash(sub->getName(), pathHash, top), false);
+  }
+}
+
+FileQuery FileQuery::unindexed(DirectoryEntry& root)
+{
+  FileQuery q;
+  q.m_Root = &root;
+  return q;
+}
+
+bool FileQuery::current(DirectoryEntry& root) const
+{
+  if (!m_Register || root.getFileRegister() != m_Register) {
+    return false;
+  }
+
+  return (m_Register->highestCount() == m_FileCount &&
+          m_Register->removedCount() == m_RemovedCount);
+}
+
+FileEntry* FileQuery::find(std::wstring_view path) const
+{
+  if (!m_Register) {
+    return (m_Root ? m_Root->searchFile(std::wstring(path)).get() : nullptr);
+  }
+
+  // searchFile() doesn't accept empty components either, so leading, trailing
+  // or doubled separators never match
+  boost::container::small_vector<std::wstring_view, 8> parts;
+  std::size_t hash = 0;
+
+  for (std::size_t begin = 0;;) {
+    const auto end  = path.find_first_of(L"\\/", begin);
+    const auto part = path.substr(begin, end == std::wstring_view::npos
+                                             ? std::wstring_view::npos
+                                             : end - begin);
+
+    if (part.empty()) {
+      return nullptr;
+    }
+
+    hash = childHash(part, hash, parts.empty());
+    parts.push_back(part);
+
+    if (end == std::wstring_view::npos) {
+      break;
+    }
+
+    begin = end + 1;
+  }
+
+  const auto range =
+      std::equal_range(m_Paths.begin(), m_Paths.end(), PathEntry{hash, 0});
+
+  for (auto itor = range.first; itor != range.second; ++itor) {
+    FileEntry* file = m_Register->fileAt(itor->index);
+    if (file && isAt(*file, {parts.data(), parts.size()})) {
+      return file;
+    }
+  }
+
+  return nullptr;
+}
+
+std::vector<FileEntry*> FileQuery::match(const DirectoryEntry& dir,
+                                         const QStringList& globs) const
+{
+  std::vector<FileEntry*> files;
+
+  if (globs.contains("*")) {
+    dir.forEachFile([&](FileEntry& file) {
+      files.push_back(&file);
+      return true;
+    });
+  } else {
+    std::vector<GlobPattern<QChar>> others;
+
+    for (auto&& glob : globs) {
+      if (m_Register && isExtensionGlob(glob)) {
+        auto v = withExtension(dir, glob.mid(2).toStdWString());
+        files.insert(files.end(), v.begin(), v.end());
+      } else {
+        others.emplace_back(glob);
+      }
+    }
+
+    if (!others.empty()) {
+      dir.forEachFile([&](FileEntry& file) {
+        const QString name = QString::fromStdWString(file.getName());
+
+        for (auto& p : others) {
+          if (p.match(name)) {
+            files.push_back(&file);
+            break;
+          }
+        }
+
+        return true;
+      });
+    }
+  }
+
+  // same order as the files of the directory; names are unique in a directory,
+  // so a file matched by several patterns ends up next to itself
+  std::sort(files.begin(), files.end(), [](auto* a, auto* b) {
+    return _wcsicmp(a->getName().c_str(), b->getName().c_str()) < 0;
+  });
+
+  files.erase(std::unique(files.begin(), files.end()), files.end());
+
+  return files;
+}
+
+std::vector<FileEntry*> FileQuery::withExtension(const DirectoryEntry& dir,
+                                                 std::wstring_view ext) const
+{
+  std::vector<FileEntry*> files;
+
+  const auto range = std::equal_range(m_Extensions.begin(), m_Extensions.end(),
+                                      ExtensionEntry{&dir, hashCaseFolded(ext), 0});
+
+  for (auto itor = range.first; itor != range.second; ++itor) {
+    FileEntry* file = m_Register->fileAt(itor->index);
+
+    if (file && file->getParent() == &dir &&
+        equalsCaseFolded(extension(file->getName()), ext)) {
+      files.push_back(file);
+    }
+  }
+
+  return files;
+}
@@ -0,0 +1,104 @@
+#ifndef FILEQUERY_H
+#define FILEQUERY_H
+
+#include "shared/fileregisterfwd.h"
+
+#include <QStringList>
+
+#include <boost/shared_ptr.hpp>
+#include <cstdint>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// indices over the files of a directory structure, used by the file queries of
+// the plugin api (resolvePath(), findFiles(), ...) so they don't have to walk
+// the tree one path component at a time
+//
+// files are indexed by the case-folded hash of their path relative to the data
+// directory, and by the directory they're in and the hash of their extension;
+// only file indices are stored, every hit is checked against the structure
+// before being returned, so hash collisions are harmless
+//
+// the index is built by the refresher thread along with the structure, which
+// can still change afterwards, when a mod is added without a full refresh for
+// example; current() tells whether that happened, unindexed() can answer the
+// same queries by walking the structure until the next refresh
+//
+class FileQuery
+{
+public:
+  // empty index, never current
+  //
+  FileQuery() = default;
+
+  // walks all the directories of the structure
+  //
+  static FileQuery build(MOShared::DirectoryEntry& root);
+
+  // no index, queries walk the structure instead; never current
+  //
+  static FileQuery unindexed(MOShared::DirectoryEntry& root);
+
+  // whether files have been added to or removed from the structure since the
+  // index was built
+  //
+  bool current(MOShared::DirectoryEntry& root) const;
+
+  // file at the given path relative to the data directory, with slashes or
+  // backslashes; same result as DirectoryEntry::searchFile()
+  //
+  MOShared::FileEntry* find(std::wstring_view path) const;
+
+  // files directly in `dir` with a name that matches any of the given glob
+  // patterns, ordered by name like the files of a directory
+  //
+  // "*" and "*.ext" are answered from the index, other patterns are matched
+  // against the name of every file in the directory
+  //
+  std::vector<MOShared::FileEntry*> match(const MOShared::DirectoryEntry& dir,
+                                          const QStringList& globs) const;
+
+private:
+  struct PathEntry
+  {
+    std::size_t hash;
+    MOShared::FileIndex index;
+
+    bool operator<(const PathEntry& o) const { return hash < o.hash; }
+  };
+
+  struct ExtensionEntry
+  {
+    const MOShared::DirectoryEntry* dir;
+    std::size_t hash;
+    MOShared::FileIndex index;
+
+    auto key() const { return std::make_pair(dir, hash); }
+    bool operator<(const ExtensionEntry& o) const { return key() < o.key(); }
+  };
+
+  // keeps the register alive so indices and the addresses used for comparisons
+  // stay valid until the index is dropped; null when unindexed
+  boost::shared_ptr<MOShared::FileRegister> m_Register;
+
+  // only set when unindexed
+  MOShared::DirectoryEntry* m_Root = nullptr;
+
+  // counts of the register when the index was built, see current()
+  std::size_t m_FileCount    = 0;
+  std::size_t m_RemovedCount = 0;
+
+  // sorted by hash
+  std::vector<PathEntry> m_Paths;
+
+  // sorted by directory and hash of the extension
+  std::vector<ExtensionEntry> m_Extensions;
+
+  void add(const MOShared::DirectoryEntry& dir, std::size_t pathHash, bool top);
+
+  std::vector<MOShared::FileEntry*> withExtension(const MOShared::DirectoryEntry& dir,
+                                                  std::wstring_view ext) const;
+};
+
+#endif  // FILEQUERY_H
@@ -0,0 +1,141 @@
+#include "filesearchindex.h"
+#include "shared/directoryentry.h"
+#include "shared/fileentry.h"
+#include "shared/fileregister.h"
+#include "shared/util.h"
+#include <utility.h>
+
+using namespace MOBase;
+using namespace MOShared;
+
+static constexpr std::uint32_t NoParent = UINT32_MAX;
+
+// whether the name contains all the words of any group
+//
+static bool matches(std::wstring_view name, const FileSearchIndex::Groups& groups)
+{
+  for (auto&& words : groups) {
+    bool all = true;
+
+    for (auto&& w : words) {
+      if (name.find(w) == std::wstring_view::npos) {
+        all = false;
+        break;
+      }
+    }
+
+    if (all) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+FileSearchIndex FileSearchIndex::build(DirectoryEntry& root)
+{
+  TimeThis tt("FileSearchIndex::build()");
+
+  FileSearchIndex index;
+
+  index.m_Register     = root.getFileRegister();
+  index.m_FileCount    = index.m_Register->highestCount();
+  index.m_RemovedCount = index.m_Register->removedCount();
+
+  index.m_Entries.reserve(index.m_FileCount);
+  index.m_Directories.push_back({0, 0, NoParent});
+
+  std::wstring buffer;
+  index.add(root, 0, buffer);
+
+  return index;
+}
+
+void FileSearchIndex::add(const DirectoryEntry& dir, std::uint32_t dirIndex,
+                          std::wstring& buffer)
+{
+  dir.forEachFile([&](FileEntry& file) {
+    m_Entries.push_back(addName(file.getName(), dirIndex, buffer));
+    return true;
+  });
+
+  for (const DirectoryEntry* sub : dir.getSubDirectories()) {
+    const auto e = addName(sub->getName(), dirIndex, buffer);
+
+    m_Entries.push_back(e);
+    m_Directories.push_back(e);
+
+    add(*sub, static_cast<std::uint32_t>(m_Directories.size() - 1), buffer);
+  }
+}
+
+FileSearchIndex::Entry FileSearchIndex::addName(std::wstring_view name,
+                                                std::uint32_t parent,
+                                                std::wstring& buffer)
+{
+  // the buffer is reused so folding doesn't allocate for every name
+  buffer.assign(name);
+  MOShared::ToLowerInPlace(buffer);
+
+  const Entry e = {static_cast<std::uint32_t>(m_Names.size()),
+                   static_cast<std::uint32_t>(buffer.size()), parent};
+
+  m_Names.append(buffer);
+
+  return e;
+}
+
+bool FileSearchIndex::current(DirectoryEntry& root) const
+{
+  if (!m_Register || root.getFileRegister() != m_Register) {
+    return false;
+  }
+
+  return (m_Register->highestCount() == m_FileCount &&
+          m_Register->removedCount() == m_RemovedCount);
+}
+
+std::vector<std::wstring>
+FileSearchIndex::directoriesMatching(const Groups& groups) const
+{
+  std::vector<bool> found(m_Directories.size(), false);
+
+  for (auto&& e : m_Entries) {
+    if (!found[e.parent] && matches(name(e), groups)) {
+      found[e.parent] = true;
+    }
+  }
+
+  std::vector<std::wstring> paths;
+
+  for (std::uint32_t i = 0; i < found.size(); ++i) {
+    if (found[i]) {
+      paths.push_back(path(i));
+    }
+  }
+
+  return paths;
+}
+
+std::wstring_view FileSearchIndex::name(const Entry& e) const
+{
+  return std::wstring_view(m_Names).substr(e.offset, e.size);
+}
+
+std::wstring FileSearchIndex::path(std::uint32_t dirIndex) const
+{
+  std::wstring s;
+
+  for (auto i = dirIndex; i != 0 && i != NoParent; i = m_Directories[i].parent) {
+    const auto n = name(m_Directories[i]);
+
+    if (s.empty()) {
+      s.assign(n);
+    } else {
+      s.insert(0, 1, L'\\');
+      s.insert(0, n);
+    }
+  }
+
+  return s;
+}
@@ -0,0 +1,86 @@
+#ifndef FILESEARCHINDEX_H
+#define FILESEARCHINDEX_H
+
+#include "shared/fileregisterfwd.h"
+
+#include <boost/shared_ptr.hpp>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// lowercase names of every file and directory in a structure, used by the
+// filter of the data tab to find which directories have to be loaded in the
+// tree instead of loading all of them
+//
+// names are stored back to back in a single string in the order the structure
+// is walked, depth-first and not sorted; words can be anywhere in a name, so
+// every name is scanned linearly, which is fast enough for a few hundred
+// thousand files and doesn't need anything more than the names themselves
+//
+// the index is built by the refresher thread along with the structure; like
+// FileQuery, current() tells whether files were added or removed since then
+//
+class FileSearchIndex
+{
+public:
+  // words that must all be in a name, a name matches a filter if it matches
+  // any of its groups
+  //
+  using Groups = std::vector<std::vector<std::wstring>>;
+
+  // empty index, never current
+  //
+  FileSearchIndex() = default;
+
+  // walks all the directories of the structure
+  //
+  static FileSearchIndex build(MOShared::DirectoryEntry& root);
+
+  // whether files have been added to or removed from the structure since the
+  // index was built
+  //
+  bool current(MOShared::DirectoryEntry& root) const;
+
+  // paths relative to the data directory of the directories that directly
+  // contain a file or a directory matching the given groups, parents before
+  // children; the root is an empty string
+  //
+  // words must be lowercase and are matched anywhere in the names
+  //
+  std::vector<std::wstring> directoriesMatching(const Groups& groups) const;
+
+private:
+  // a file or directory, `parent` is an index in m_Directories
+  struct Entry
+  {
+    std::uint32_t offset;
+    std::uint32_t size;
+    std::uint32_t parent;
+  };
+
+  // see FileQuery
+  boost::shared_ptr<MOShared::FileRegister> m_Register;
+  std::size_t m_FileCount    = 0;
+  std::size_t m_RemovedCount = 0;
+
+  // lowercase names, back to back in the same order as m_Entries
+  std::wstring m_Names;
+
+  // every file and directory except the root, in depth-first order
+  std::vector<Entry> m_Entries;
+
+  // directories in depth-first order, so parents come before their children;
+  // the first one is the root
+  std::vector<Entry> m_Directories;
+
+  void add(const MOShared::DirectoryEntry& dir, std::uint32_t dirIndex,
+           std::wstring& buffer);
+
+  Entry addName(std::wstring_view name, std::uint32_t parent, std::wstring& buffer);
+
+  std::wstring_view name(const Entry& e) const;
+  std::wstring path(std::uint32_t dirIndex) const;
+};
+
+#endif  // FILESEARCHINDEX_H
@@ -167,6 +167,11 @@ void FileTree::ensureFullyLoaded()
   m_model->ensureFullyLoaded();
 }
 
+void FileTree::ensureLoaded(const std::vector<std::wstring>& paths)
+{
+  m_model->ensureLoaded(paths);
+}
+
 FileTreeItem* FileTree::singleSelection()
 {
   const auto sel = m_tree->selectionModel()->selectedRows();
@@ -27,6 +27,7 @@ public:
 
   bool fullyLoaded() const;
   void ensureFullyLoaded();
+  void ensureLoaded(const std::vector<std::wstring>& paths);
 
   void expandAll();
   void collapseAll();
@@ -238,6 +238,55 @@ void FileTreeModel::ensureFullyLoaded()
   }
 }
 
+void FileTreeModel::ensureLoaded(const std::vector<std::wstring>& paths)
+{
+  if (m_fullyLoaded || paths.empty()) {
+    return;
+  }
+
+  TimeThis tt("FileTreeModel::ensureLoaded()");
+
+  auto load = [&](FileTreeItem& item) {
+    if (!item.isLoaded()) {
+      doFetchMore(indexFromItem(item), false, false);
+    }
+  };
+
+  for (auto&& path : paths) {
+    FileTreeItem* item = m_root.get();
+    load(*item);
+
+    // walks down from the root, loading every directory on the way
+    for (std::size_t begin = 0; item && begin < path.size();) {
+      auto end = path.find(L'\\', begin);
+      if (end == std::wstring::npos) {
+        end = path.size();
+      }
+
+      const std::wstring_view name(path.data() + begin, end - begin);
+      FileTreeItem* child = nullptr;
+
+      for (auto&& c : item->children()) {
+        if (c->isDirectory() && c->filenameWsLowerCase() == name) {
+          child = c.get();
+          break;
+        }
+      }
+
+      // directories can be missing from the tree, such as when only conflicts
+      // are shown
+      item = child;
+      if (item) {
+        load(*item);
+      }
+
+      begin = end + 1;
+    }
+  }
+
+  sortItem(*m_root, false);
+}
+
 bool FileTreeModel::enabled() const
 {
   return m_enabled;
@@ -51,6 +51,11 @@ public:
 
   void ensureFullyLoaded();
 
+  // loads the given directories and their parents, paths are relative to the
+  // data directory and lowercase, see FileSearchIndex
+  //
+  void ensureLoaded(const std::vector<std::wstring>& paths);
+
   bool enabled() const;
   void setEnabled(bool b);
 
@@ -7,8 +7,13 @@
 #define GLOB_MATCHING_H
 
 #include <QString>
+#include <algorithm>
+#include <bitset>
 #include <cctype>
+#include <cstdint>
 #include <string_view>
+#include <type_traits>
+#include <vector>
 
 namespace MOShared
 {
@@ -30,6 +35,15 @@ namespace details
     static auto tolower(CharT c) { return std::tolower(c); }
 
     static auto empty(string_view const& view) { return view.empty(); }
+
+    // code unit of a character, used to index tables of ascii characters
+    static unsigned int code(CharT c)
+    {
+      return static_cast<std::make_unsigned_t<CharT>>(c);
+    }
+
+    static const CharT* data(string_view const& view) { return view.data(); }
+    static auto size(string_view const& view) { return view.size(); }
   };
 
   template <>
@@ -40,6 +54,10 @@ namespace details
 
     static auto tolower(QChar const& c) { return c.toLower(); }
     static auto empty(string_view const& view) { return view.isEmpty(); }
+
+    static unsigned int code(QChar c) { return c.unicode(); }
+    static const QChar* data(string_view const& view) { return view.constData(); }
+    static auto size(string_view const& view) { return view.size(); }
   };
 
 }  // namespace details
@@ -68,6 +86,15 @@ namespace details
  * Advantage of this over the above methods:
  *  - It is fast. Quick testing show that this is faster than PatchMatchSpecW.
  *  - It can be used on most string types (QString, std::string, std::wstring, etc.).
+ *
+ * The pattern is compiled once when constructed: consecutive '*' are merged,
+ * the pattern is lowercased ahead of time and sets are turned into tables for
+ * ascii characters. Patterns that are only a literal with '*' on either side
+ * ("*.ext", "prefix*", "*part*") are matched by comparing the literal directly,
+ * everything else goes through a small program with one instruction per
+ * character of the pattern.
+ *
+ * A '[' without a matching ']' is a literal character.
  */
 template <class CharT, class Traits = std::char_traits<CharT>,
           class Allocator = std::allocator<CharT>>
@@ -89,86 +116,332 @@ public:
   };
 
 public:
-  GlobPattern(string_view_type const& s) : v{s} {}
+  GlobPattern(string_view_type const& s) : v{s} { compile(); }
 
   const string_type& native() const { return v; }
 
-  constexpr bool match(string_view_type const& str, bool case_sensitive = false)
+  bool match(string_view_type const& str, bool case_sensitive = false) const
+  {
+    const CharT* s      = traits::data(str);
+    const std::size_t n = static_cast<std::size_t>(traits::size(str));
+    const std::size_t m = m_literal.size();
+
+    switch (m_shape) {
+    case Shape::All:
+      return true;
+
+    case Shape::Exact:
+      return n == m && equalRun(s, 0, m, case_sensitive);
+
+    case Shape::Prefix:
+      return n >= m && equalRun(s, 0, m, case_sensitive);
+
+    case Shape::Suffix:
+      return n >= m && equalRun(s + (n - m), 0, m, case_sensitive);
+
+    case Shape::Contains:
+      return contains(s, n, case_sensitive);
+
+    case Shape::Program:
+    default:
+      return run(s, n, case_sensitive);
+    }
+  }
+
+private:
+  enum class Shape
   {
-    // Empty pattern can only match with empty sting
-    if (traits::empty(v))
-      return traits::empty(str);
+    // "*"
+    All,
+
+    // no wildcards at all
+    Exact,
+
+    // "literal*"
+    Prefix,
+
+    // "*literal"
+    Suffix,
+
+    // "*literal*"
+    Contains,
+
+    // anything else
+    Program
+  };
 
-    auto pat_it  = v.begin();
-    auto pat_end = v.end();
+  enum class Op : std::uint8_t
+  {
+    Char,
+    Any,
+    Set,
+    Star
+  };
+
+  struct Instruction
+  {
+    Op op;
+
+    // for Char
+    CharT c;
+    CharT folded;
+
+    // for Set, index in m_sets
+    std::size_t set;
+  };
 
-    auto str_it  = str.begin();
-    auto str_end = str.end();
+  struct Set
+  {
+    // by code unit for ascii characters, as given and lowercased
+    std::bitset<128> ascii;
+    std::bitset<128> asciiFolded;
 
-    auto anyrep_pos_pat = pat_end;
-    auto anyrep_pos_str = str_end;
+    // everything else
+    std::vector<CharT> others;
+    std::vector<CharT> othersFolded;
 
-    auto set_pos_pat = pat_end;
+    bool contains(CharT c, bool case_sensitive) const
+    {
+      if (!case_sensitive) {
+        c = fold(c);
+      }
 
-    while (str_it != str_end) {
-      CharT current_pat = QChar(0);
-      CharT current_str = QChar(-1);
-      if (pat_it != pat_end) {
-        current_pat = case_sensitive ? *pat_it : traits::tolower(*pat_it);
-        current_str = case_sensitive ? *str_it : traits::tolower(*str_it);
+      const auto code = traits::code(c);
+      if (code < 128) {
+        return (case_sensitive ? ascii : asciiFolded)[code];
       }
-      if (pat_it != pat_end && current_pat == card::set_begin) {
-        set_pos_pat = pat_it;
-        pat_it++;
-      } else if (pat_it != pat_end && current_pat == card::set_end) {
-        if (anyrep_pos_pat != pat_end) {
-          set_pos_pat = pat_end;
-          pat_it++;
-        } else {
-          return false;
+
+      const auto& v = (case_sensitive ? others : othersFolded);
+      return std::find(v.begin(), v.end(), c) != v.end();
+    }
+  };
+
+  string_type v;
+
+  Shape m_shape = Shape::Program;
+  std::vector<Instruction> m_program;
+  std::vector<Set> m_sets;
+
+  // the pattern without the '*' for the shapes that are a literal
+  std::vector<CharT> m_literal;
+  std::vector<CharT> m_literalFolded;
+
+  // lowercases ascii characters without going through the traits
+  //
+  static CharT fold(CharT c)
+  {
+    const auto code = traits::code(c);
+
+    if (code < 128) {
+      return (code >= 'A' && code <= 'Z') ? CharT(code + ('a' - 'A')) : c;
+    }
+
+    return static_cast<CharT>(traits::tolower(c));
+  }
+
+  void compile()
+  {
+    const CharT* p      = traits::data(v);
+    const std::size_t n = static_cast<std::size_t>(traits::size(v));
+
+    for (std::size_t i = 0; i < n; ++i) {
+      const CharT c = p[i];
+
+      if (c == card::any_repeat) {
+        // consecutive stars match the same thing as a single one
+        if (m_program.empty() || m_program.back().op != Op::Star) {
+          m_program.push_back({Op::Star, c, c, 0});
         }
+      } else if (c == card::any) {
+        m_program.push_back({Op::Any, c, c, 0});
+      } else if (c == card::set_begin && closes(p, i + 1, n)) {
+        Set set;
 
-      } else if (set_pos_pat != pat_end) {
-        if (current_pat == current_str) {
-          set_pos_pat = pat_end;
-          pat_it      = std::find(pat_it, pat_end, card::set_end) + 1;
-          str_it++;
-        } else {
-          if (pat_it == pat_end) {
-            return false;
-          }
-          pat_it++;
+        for (++i; p[i] != card::set_end; ++i) {
+          addToSet(set, p[i]);
         }
-      } else if (pat_it != pat_end && current_pat == current_str) {
-        pat_it++;
-        str_it++;
-      } else if (pat_it != pat_end && current_pat == card::any) {
-        pat_it++;
-        str_it++;
-      } else if (pat_it != pat_end && current_pat == card::any_repeat) {
-        anyrep_pos_pat = pat_it;
-        anyrep_pos_str = str_it;
-        pat_it++;
-      } else if (anyrep_pos_pat != pat_end) {
-        pat_it = anyrep_pos_pat + 1;
-        str_it = anyrep_pos_str + 1;
-        anyrep_pos_str++;
+
+        m_program.push_back({Op::Set, c, c, m_sets.size()});
+        m_sets.push_back(std::move(set));
       } else {
+        m_program.push_back({Op::Char, c, fold(c), 0});
+      }
+    }
+
+    classify();
+  }
+
+  // whether there's a ']' after `i`
+  //
+  static bool closes(const CharT* p, std::size_t i, std::size_t n)
+  {
+    for (; i < n; ++i) {
+      if (p[i] == card::set_end) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  static void addToSet(Set& set, CharT c)
+  {
+    const CharT folded = fold(c);
+
+    if (traits::code(c) < 128) {
+      set.ascii.set(traits::code(c));
+    } else {
+      set.others.push_back(c);
+    }
+
+    if (traits::code(folded) < 128) {
+      set.asciiFolded.set(traits::code(folded));
+    } else {
+      set.othersFolded.push_back(folded);
+    }
+  }
+
+  // looks for the shapes that don't need the program
+  //
+  void classify()
+  {
+    if (m_program.size() == 1 && m_program[0].op == Op::Star) {
+      m_shape = Shape::All;
+      return;
+    }
+
+    const bool leading = !m_program.empty() && m_program.front().op == Op::Star;
+    const bool trailing =
+        m_program.size() > 1 && m_program.back().op == Op::Star;
+
+    const std::size_t begin = leading ? 1 : 0;
+    const std::size_t end   = m_program.size() - (trailing ? 1 : 0);
+
+    for (std::size_t i = begin; i < end; ++i) {
+      if (m_program[i].op != Op::Char) {
+        return;
+      }
+    }
+
+    for (std::size_t i = begin; i < end; ++i) {
+      m_literal.push_back(m_program[i].c);
+      m_literalFolded.push_back(m_program[i].folded);
+    }
+
+    if (leading && trailing) {
+      m_shape = Shape::Contains;
+    } else if (leading) {
+      m_shape = Shape::Suffix;
+    } else if (trailing) {
+      m_shape = Shape::Prefix;
+    } else {
+      m_shape = Shape::Exact;
+    }
+  }
+
+  // compares `n` characters of `s` with the literal starting at `offset`
+  //
+  bool equalRun(const CharT* s, std::size_t offset, std::size_t n,
+                bool case_sensitive) const
+  {
+    if (case_sensitive) {
+      return std::equal(s, s + n, m_literal.data() + offset);
+    }
+
+    const CharT* folded = m_literalFolded.data() + offset;
+
+    for (std::size_t i = 0; i < n; ++i) {
+      // most names are already lowercase
+      if (s[i] != folded[i] && fold(s[i]) != folded[i]) {
         return false;
       }
     }
-    while (pat_it != pat_end) {
-      CharT cur = case_sensitive ? *pat_it : traits::tolower(*pat_it);
-      if (cur == card::any_repeat)
-        pat_it++;
-      else
-        break;
+
+    return true;
+  }
+
+  bool contains(const CharT* s, std::size_t n, bool case_sensitive) const
+  {
+    const std::size_t m = m_literal.size();
+    if (m > n) {
+      return false;
+    }
+
+    if (m == 0) {
+      return true;
+    }
+
+    const CharT first = case_sensitive ? m_literal[0] : m_literalFolded[0];
+
+    for (std::size_t i = 0; i + m <= n; ++i) {
+      const CharT c = case_sensitive ? s[i] : fold(s[i]);
+
+      if (c == first && equalRun(s + i + 1, 1, m - 1, case_sensitive)) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  bool step(const Instruction& ins, CharT c, bool case_sensitive) const
+  {
+    switch (ins.op) {
+    case Op::Char:
+      if (case_sensitive) {
+        return c == ins.c;
+      }
+
+      return c == ins.folded || fold(c) == ins.folded;
+
+    case Op::Any:
+      return true;
+
+    case Op::Set:
+      return m_sets[ins.set].contains(c, case_sensitive);
+
+    case Op::Star:
+    default:
+      return false;
     }
-    return pat_it == pat_end;
   }
 
-private:
-  string_type v;
+  // matches one character at a time, going back to the last '*' when
+  // something doesn't match
+  //
+  bool run(const CharT* s, std::size_t n, bool case_sensitive) const
+  {
+    constexpr std::size_t none = static_cast<std::size_t>(-1);
+
+    const std::size_t size = m_program.size();
+
+    std::size_t p     = 0;
+    std::size_t i     = 0;
+    std::size_t starP = none;
+    std::size_t starI = 0;
+
+    while (i < n) {
+      if (p < size && m_program[p].op == Op::Star) {
+        starP = p++;
+        starI = i;
+      } else if (p < size && step(m_program[p], s[i], case_sensitive)) {
+        ++p;
+        ++i;
+      } else if (starP != none) {
+        // the star takes one more character
+        p = starP + 1;
+        i = ++starI;
+      } else {
+        return false;
+      }
+    }
+
+    while (p < size && m_program[p].op == Op::Star) {
+      ++p;
+    }
+
+    return p == size;
+  }
 };
 
 template <class CharT, class Traits, class Allocator>
@@ -0,0 +1,250 @@
+#include "metaini.h"
+#include <log.h>
+#include <utility.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QSaveFile>
+#include <QSettings>
+
+#include <Windows.h>
+
+using namespace MOBase;
+
+// "MOMI", changes to the format must bump the version
+static constexpr quint32 CacheMagic   = 0x4D4F4D49;
+static constexpr quint32 CacheVersion = 1;
+
+MetaIni MetaIni::read(const QString& path)
+{
+  MetaIni ini;
+
+  QSettings settings(path, QSettings::IniFormat);
+
+  for (auto&& key : settings.allKeys()) {
+    ini.m_Values.insert(key.toLower(), {key, settings.value(key)});
+  }
+
+  return ini;
+}
+
+QVariant MetaIni::value(const QString& key, const QVariant& def) const
+{
+  auto itor = m_Values.find(key.toLower());
+  if (itor == m_Values.end()) {
+    return def;
+  }
+
+  return itor->value;
+}
+
+bool MetaIni::contains(const QString& key) const
+{
+  return m_Values.contains(key.toLower());
+}
+
+int MetaIni::arraySize(const QString& name) const
+{
+  return value(name + "/size", 0).toInt();
+}
+
+template <class F>
+void MetaIni::forEachInGroup(const QString& group, F&& f) const
+{
+  const QString prefix = group.toLower() + "/";
+
+  for (auto itor = m_Values.lowerBound(prefix);
+       itor != m_Values.end() && itor.key().startsWith(prefix); ++itor) {
+    f(itor->key.mid(prefix.size()));
+  }
+}
+
+QStringList MetaIni::childGroups(const QString& group) const
+{
+  QStringList v;
+
+  forEachInGroup(group, [&](const QString& rest) {
+    const auto slash = rest.indexOf('/');
+
+    // keys are sorted, so all the keys of a child group are together
+    if (slash >= 0 && (v.isEmpty() || v.back().compare(rest.left(slash),
+                                                       Qt::CaseInsensitive) != 0)) {
+      v.push_back(rest.left(slash));
+    }
+  });
+
+  return v;
+}
+
+QStringList MetaIni::childKeys(const QString& group) const
+{
+  QStringList v;
+
+  forEachInGroup(group, [&](const QString& rest) {
+    if (!rest.contains('/')) {
+      v.push_back(rest);
+    }
+  });
+
+  return v;
+}
+
+void MetaIniCache::setPath(const QString& path)
+{
+  std::scoped_lock lock(m_Mutex);
+
+  if (path != m_Path) {
+    m_Path    = path;
+    m_Loaded  = false;
+    m_Changed = false;
+    m_Entries.clear();
+  }
+}
+
+MetaIni MetaIniCache::get(const QString& path)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data = {};
+  if (!::GetFileAttributesExW(ToWString(path).c_str(), GetFileExInfoStandard,
+                              &data)) {
+    // most likely a mod without a meta.ini, there's nothing to read
+    return {};
+  }
+
+  const quint64 size =
+      (static_cast<quint64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+  const quint64 time =
+      (static_cast<quint64>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+      data.ftLastWriteTime.dwLowDateTime;
+
+  return get(path, size, time);
+}
+
+MetaIni MetaIniCache::get(const QString& path, quint64 size, quint64 time)
+{
+  const QString key = path.toLower();
+
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    if (!m_Loaded) {
+      load();
+    }
+
+    auto itor = m_Entries.find(key);
+    if (itor != m_Entries.end() && itor->size == size && itor->time == time) {
+      itor->used = true;
+      return itor->ini;
+    }
+  }
+
+  // reading is done without the lock so other threads can keep going
+  MetaIni ini = MetaIni::read(path);
+
+  {
+    std::scoped_lock lock(m_Mutex);
+    m_Entries.insert(key, Entry{path, size, time, ini, true});
+    m_Changed = true;
+  }
+
+  return ini;
+}
+
+void MetaIniCache::save()
+{
+  std::scoped_lock lock(m_Mutex);
+
+  if (!m_Loaded || m_Path.isEmpty()) {
+    return;
+  }
+
+  for (auto itor = m_Entries.begin(); itor != m_Entries.end();) {
+    if (!itor->used) {
+      itor      = m_Entries.erase(itor);
+      m_Changed = true;
+    } else {
+      itor->used = false;
+      ++itor;
+    }
+  }
+
+  if (!m_Changed) {
+    return;
+  }
+
+  QSaveFile file(m_Path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    log::error("failed to save meta.ini cache to {}: {}", m_Path,
+               file.errorString());
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_15);
+
+  out << CacheMagic << CacheVersion << static_cast<quint32>(m_Entries.size());
+
+  for (auto&& e : m_Entries) {
+    out << e.path << e.size << e.time
+        << static_cast<quint32>(e.ini.m_Values.size());
+
+    for (auto&& v : e.ini.m_Values) {
+      out << v.key << v.value;
+    }
+  }
+
+  if (!file.commit()) {
+    log::error("failed to save meta.ini cache to {}: {}", m_Path,
+               file.errorString());
+    return;
+  }
+
+  m_Changed = false;
+}
+
+void MetaIniCache::load()
+{
+  m_Loaded = true;
+  m_Entries.clear();
+
+  if (m_Path.isEmpty()) {
+    return;
+  }
+
+  QFile file(m_Path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    // not necessarily a problem, the file may just not exist (yet)
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_15);
+
+  quint32 magic = 0, version = 0, count = 0;
+  in >> magic >> version >> count;
+
+  if (magic != CacheMagic || version != CacheVersion) {
+    log::debug("ignoring meta.ini cache {}, unknown format", m_Path);
+    return;
+  }
+
+  for (quint32 i = 0; i < count; ++i) {
+    Entry e;
+    quint32 values = 0;
+
+    in >> e.path >> e.size >> e.time >> values;
+
+    for (quint32 j = 0; j < values && in.status() == QDataStream::Ok; ++j) {
+      MetaIni::Value v;
+      in >> v.key >> v.value;
+      e.ini.m_Values.insert(v.key.toLower(), std::move(v));
+    }
+
+    if (in.status() != QDataStream::Ok) {
+      log::warn("meta.ini cache {} is corrupted, ignoring it", m_Path);
+      m_Entries.clear();
+      return;
+    }
+
+    m_Entries.insert(e.path.toLower(), std::move(e));
+  }
+}
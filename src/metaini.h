@@ -0,0 +1,113 @@
+#ifndef METAINI_H
+#define METAINI_H
+
+#include <QHash>
+#include <QMap>
+#include <QString>
+#include <QStringList>
+#include <QVariant>
+
+#include <mutex>
+
+// the values of a mod's meta.ini, read once with QSettings and then looked up
+// without it; keys are the same as QSettings::allKeys(), such as "modid",
+// "installedFiles/1/fileid" or "Plugins/name/key", and are case-insensitive
+//
+class MetaIni
+{
+public:
+  // reads all the values from the given file, empty if it doesn't exist
+  //
+  static MetaIni read(const QString& path);
+
+  // same as QSettings::value()
+  //
+  QVariant value(const QString& key, const QVariant& def = {}) const;
+
+  // same as QSettings::contains()
+  //
+  bool contains(const QString& key) const;
+
+  // same as QSettings::beginReadArray(), values are in "name/i/key" with i
+  // starting at 1
+  //
+  int arraySize(const QString& name) const;
+
+  // same as QSettings::childGroups() and childKeys() inside the given group
+  //
+  QStringList childGroups(const QString& group) const;
+  QStringList childKeys(const QString& group) const;
+
+private:
+  friend class MetaIniCache;
+
+  struct Value
+  {
+    QString key;
+    QVariant value;
+  };
+
+  // by lowercase key
+  QMap<QString, Value> m_Values;
+
+  // calls f(rest) for every key in the given group, rest being the part of
+  // the original key after the group
+  //
+  template <class F>
+  void forEachInGroup(const QString& group, F&& f) const;
+};
+
+// meta.ini files that have been read before, saved to a file so only the ones
+// that have changed are read with QSettings on startup
+//
+// entries are keyed by the path of the meta.ini and are only used if its size
+// and modification time haven't changed
+//
+class MetaIniCache
+{
+public:
+  // sets the file the cache is saved to, the cache is reloaded from it the next
+  // time it's used if it's different from the current one
+  //
+  void setPath(const QString& path);
+
+  // returns the values of the given meta.ini, reading it if it's not in the
+  // cache or if it has changed
+  //
+  // can be called from multiple threads
+  //
+  MetaIni get(const QString& path);
+
+  // same as above, but with the size and modification time of the file
+  // already known, such as when they come from a directory listing
+  //
+  MetaIni get(const QString& path, quint64 size, quint64 time);
+
+  // writes the cache if anything has changed since it was loaded; since all
+  // the mods are read at once, entries that haven't been requested since the
+  // last save are for mods that don't exist anymore and are dropped
+  //
+  void save();
+
+private:
+  struct Entry
+  {
+    QString path;
+    quint64 size = 0;
+    quint64 time = 0;
+    MetaIni ini;
+    bool used = false;
+  };
+
+  std::mutex m_Mutex;
+  QString m_Path;
+  bool m_Loaded  = false;
+  bool m_Changed = false;
+
+  // by lowercase path
+  QHash<QString, Entry> m_Entries;
+
+  void load();
+};
+
+#endif  // METAINI_H
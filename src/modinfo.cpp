@@ -26,10 +26,12 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "modinfoseparator.h"
 
 #include "categories.h"
+#include "metaini.h"
 #include "modinfodialog.h"
 #include "modlist.h"
 #include "organizercore.h"
 #include "overwriteinfodialog.h"
+#include "settings.h"
 #include "thread_utils.h"
 #include "versioninfo.h"
 
@@ -56,6 +58,9 @@ std::map<std::pair<QString, int>, std::vector<unsigned int>> ModInfo::s_ModsByMo
 int ModInfo::s_NextID;
 QRecursiveMutex ModInfo::s_Mutex;
 
+// meta.ini files read by updateFromDisc(), kept between calls
+static MetaIniCache s_MetaCache;
+
 QString ModInfo::s_HiddenExt(".mohidden");
 
 bool ModInfo::ByName(const ModInfo::Ptr& LHS, const ModInfo::Ptr& RHS)
@@ -82,17 +87,18 @@ bool ModInfo::isRegularName(const QString& name)
   return !isSeparatorName(name) && !isBackupName(name);
 }
 
-ModInfo::Ptr ModInfo::createFrom(const QDir& dir, OrganizerCore& core)
+ModInfo::Ptr ModInfo::createFrom(const QDir& dir, OrganizerCore& core,
+                                 const MetaIni* meta)
 {
   QMutexLocker locker(&s_Mutex);
   ModInfo::Ptr result;
 
   if (isBackupName(dir.dirName())) {
-    result = ModInfo::Ptr(new ModInfoBackup(dir, core));
+    result = ModInfo::Ptr(new ModInfoBackup(dir, core, meta));
   } else if (isSeparatorName(dir.dirName())) {
-    result = Ptr(new ModInfoSeparator(dir, core));
+    result = Ptr(new ModInfoSeparator(dir, core, meta));
   } else {
-    result = ModInfo::Ptr(new ModInfoRegular(dir, core));
+    result = ModInfo::Ptr(new ModInfoRegular(dir, core, meta));
   }
   result->m_Index = s_Collection.size();
   s_Collection.push_back(result);
@@ -241,11 +247,36 @@ void ModInfo::updateFromDisc(const QString& modsDirectory, OrganizerCore& core,
   s_Overwrite = nullptr;
 
   {  // list all directories in the mod directory and make a mod out of each
+    struct FoundMod
+    {
+      QString path;
+      MetaIni meta;
+    };
+
+    std::vector<FoundMod> found;
+
     QDir mods(QDir::fromNativeSeparators(modsDirectory));
     mods.setFilter(QDir::Dirs | QDir::NoDotAndDotDot);
     QDirIterator modIter(mods);
     while (modIter.hasNext()) {
-      createFrom(QDir(modIter.next()), core);
+      found.push_back({modIter.next()});
+    }
+
+    // meta.ini files are read in parallel before creating the mods, most of
+    // them come from the cache
+    s_MetaCache.setPath(Settings::instance().paths().cache() + "/meta.cache");
+
+    parallelMap(
+        found.begin(), found.end(),
+        [](FoundMod& m) {
+          m.meta = s_MetaCache.get(m.path + "/meta.ini");
+        },
+        std::min(refreshThreadCount, found.size()));
+
+    s_MetaCache.save();
+
+    for (const auto& m : found) {
+      createFrom(QDir(m.path), core, &m.meta);
     }
   }
 
@@ -293,7 +324,11 @@ void ModInfo::updateIndices()
   }
 }
 
-ModInfo::ModInfo(OrganizerCore& core) : m_PrimaryCategory(-1), m_Core(core) {}
+ModInfo::ModInfo(OrganizerCore& core)
+    : m_PrimaryCategory(-1), m_Core(core), m_FilterKey([this]() {
+        return makeFilterKey();
+      })
+{}
 
 bool ModInfo::checkAllForUpdate(PluginContainer* pluginContainer, QObject* receiver)
 {
@@ -558,6 +593,99 @@ bool ModInfo::categorySet(int categoryID) const
   return false;
 }
 
+const ModInfo::FilterKey& ModInfo::filterKey() const
+{
+  return m_FilterKey.value();
+}
+
+void ModInfo::invalidateFilterKey()
+{
+  m_FilterKey.invalidate();
+}
+
+void ModInfo::invalidateFilterKeys()
+{
+  QMutexLocker locker(&s_Mutex);
+
+  for (auto& mod : s_Collection) {
+    mod->invalidateFilterKey();
+  }
+}
+
+ModInfo::FilterKey ModInfo::makeFilterKey() const
+{
+  FilterKey key;
+
+  const CategoryFactory& catFac = CategoryFactory::instance();
+
+  key.name  = name().toCaseFolded();
+  key.notes = comments().toCaseFolded();
+
+  // categories can be removed from the factory before they're removed from the
+  // mods, see MainWindow::categoriesSaved()
+  QStringList names;
+  for (int id : m_Categories) {
+    if (catFac.categoryExists(id)) {
+      names.append(catFac.getCategoryName(catFac.getCategoryIndex(id)));
+    }
+  }
+
+  // keywords can't contain newlines, so they never match across two names
+  key.categories = names.join("\n").toCaseFolded();
+
+  auto setBit = [](std::vector<bool>& bits, int id) {
+    if (id < 0) {
+      return false;
+    }
+
+    if (static_cast<std::size_t>(id) >= bits.size()) {
+      bits.resize(id + 1, false);
+    }
+
+    // already set means the ancestors are too, or that there's a cycle
+    if (bits[id]) {
+      return false;
+    }
+
+    bits[id] = true;
+    return true;
+  };
+
+  for (int id : m_Categories) {
+    for (int current = id; setBit(key.categoryIDs, current);) {
+      if (!catFac.categoryExists(current)) {
+        break;
+      }
+
+      current = catFac.getParentID(catFac.getCategoryIndex(current));
+      if (current == 0) {
+        break;
+      }
+    }
+  }
+
+  for (int content : getContents()) {
+    setBit(key.contents, content);
+  }
+
+  for (EFlag flag : getFlags()) {
+    key.flags.set(flag);
+  }
+
+  for (EConflictFlag flag : getConflictFlags()) {
+    key.conflictFlags.set(flag);
+  }
+
+  key.nexusID         = nexusId();
+  key.hasCategories   = !m_Categories.empty();
+  key.alwaysEnabled   = alwaysEnabled();
+  key.updateAvailable = updateAvailable() || downgradeAvailable();
+  key.endorsed        = (endorsedState() == EndorsedState::ENDORSED_TRUE);
+  key.tracked         = (trackedState() == TrackedState::TRACKED_TRUE);
+
+  return key;
+}
+
 QUrl ModInfo::parseCustomURL() const
 {
   if (!hasCustomURL() || url().isEmpty()) {
@@ -22,8 +22,10 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include "ifiletree.h"
 #include "imodinterface.h"
+#include "memoizedlock.h"
 #include "versioninfo.h"
 
+class MetaIni;
 class OrganizerCore;
 class PluginContainer;
 class QDir;
@@ -37,6 +39,7 @@ class QDateTime;
 
 #include <boost/function.hpp>
 
+#include <bitset>
 #include <map>
 #include <set>
 #include <vector>
@@ -203,6 +206,11 @@ public:  // Static functions:
    */
   static unsigned int findMod(const boost::function<bool(ModInfo::Ptr)>& filter);
 
+  /**
+   * @brief Invalidate the filter keys of all mods, see filterKey().
+   */
+  static void invalidateFilterKeys();
+
   /**
    * @brief Run a limited batch of mod update checks for "newest version" information.
    *
@@ -760,12 +768,59 @@ public:  // Methods after this do not come from IModInterface:
    */
   const std::set<int>& getCategories() const { return m_Categories; }
 
+  /**
+   * @brief What the filters of the mod list look at, computed once instead of
+   * every time the filter changes.
+   *
+   * Text is case-folded, categories, contents and flags are indexed by their ID.
+   */
+  struct FilterKey
+  {
+    QString name;
+    QString notes;
+
+    // names of the categories, separated by newlines
+    QString categories;
+
+    // set categories and all their ancestors, like categorySet()
+    std::vector<bool> categoryIDs;
+    std::vector<bool> contents;
+
+    std::bitset<64> flags;
+    std::bitset<64> conflictFlags;
+
+    int nexusID          = 0;
+    bool hasCategories   = false;
+    bool alwaysEnabled   = false;
+    bool updateAvailable = false;
+    bool endorsed        = false;
+    bool tracked         = false;
+  };
+
+  /**
+   * @return the filter key of this mod, computed on first use.
+   *
+   * @note The setters of the mod invalidate the key themselves; other changes, like
+   * contents, conflicts or renamed categories, must call invalidateFilterKey(), the
+   * mod list does it when it's notified of a change.
+   */
+  const FilterKey& filterKey() const;
+
+  /**
+   * @brief Recompute the filter key on the next call to filterKey().
+   */
+  void invalidateFilterKey();
+
   /**
    * @brief Sets the new primary category of the mod.
    *
    * @param categoryID ID of the primary category to set.
    */
-  virtual void setPrimaryCategory(int categoryID) { m_PrimaryCategory = categoryID; }
+  virtual void setPrimaryCategory(int categoryID)
+  {
+    m_PrimaryCategory = categoryID;
+    invalidateFilterKey();
+  }
 
   /**
    * @return true if this mod is considered "valid", that is it contains data used by
@@ -973,6 +1028,8 @@ protected:
   virtual void prefetch() = 0;
   static bool ByName(const ModInfo::Ptr& LHS, const ModInfo::Ptr& RHS);
 
+  FilterKey makeFilterKey() const;
+
 protected:
   // the mod list
   OrganizerCore& m_Core;
@@ -985,6 +1042,8 @@ protected:
   MOBase::VersionInfo m_Version;
   bool m_PluginSelected = false;
 
+  MOBase::MemoizedLocked<FilterKey> m_FilterKey;
+
   // empty set that can be returned in overwrite functions by
   // default
   static const std::set<unsigned int> s_EmptySet;
@@ -996,10 +1055,13 @@ protected:
    * @brief Create a new mod from the specified directory and add it to the collection.
    *
    * @param dir Directory to create from.
+   * @param meta Content of the mod's meta.ini if it has been read already,
+   *     otherwise it's read from disk.
    *
    * @return pointer to the info-structure of the newly created/added mod.
    */
-  static ModInfo::Ptr createFrom(const QDir& dir, OrganizerCore& core);
+  static ModInfo::Ptr createFrom(const QDir& dir, OrganizerCore& core,
+                                 const MetaIni* meta = nullptr);
 
   /**
    * @brief Create a new "foreign-managed" mod from a tuple of plugin and archives.
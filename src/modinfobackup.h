@@ -45,7 +45,7 @@ public:
   virtual void addInstalledFile(int, int) override {}
 
 private:
-  ModInfoBackup(const QDir& path, OrganizerCore& core);
+  ModInfoBackup(const QDir& path, OrganizerCore& core, const MetaIni* meta = nullptr);
 };
 
 #endif  // MODINFOBACKUP_H
@@ -2,6 +2,7 @@
 
 #include "categories.h"
 #include "messagedialog.h"
+#include "metaini.h"
 #include "moddatacontent.h"
 #include "organizercore.h"
 #include "plugincontainer.h"
@@ -28,7 +29,8 @@ static bool ByName(const ModInfo::Ptr& LHS, const ModInfo::Ptr& RHS)
 }
 }  // namespace
 
-ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core)
+ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core,
+                               const MetaIni* meta)
     : ModInfoWithConflictInfo(core), m_Name(path.dirName()),
       m_Path(path.absolutePath()), m_Repository(),
       m_GameName(core.managedGame()->gameShortName()), m_IsAlternate(false),
@@ -38,8 +40,12 @@ ModInfoRegular::ModInfoRegular(const QDir& path, OrganizerCore& core)
       m_NexusBridge(&core.pluginContainer())
 {
   m_CreationTime = QFileInfo(path.absolutePath()).birthTime();
-  // read out the meta-file for information
-  readMeta();
+  // read out the meta-file for information, unless it has been read already
+  if (meta) {
+    readMeta(*meta);
+  } else {
+    readMeta();
+  }
   if (m_GameName.compare(core.managedGame()->gameShortName(), Qt::CaseInsensitive) != 0)
     if (!core.managedGame()->primarySources().contains(m_GameName, Qt::CaseInsensitive))
       m_IsAlternate = true;
@@ -84,7 +90,11 @@ bool ModInfoRegular::isEmpty() const
 
 void ModInfoRegular::readMeta()
 {
-  QSettings metaFile(m_Path + "/meta.ini", QSettings::IniFormat);
+  readMeta(MetaIni::read(m_Path + "/meta.ini"));
+}
+
+void ModInfoRegular::readMeta(const MetaIni& metaFile)
+{
   m_Comments           = metaFile.value("comments", "").toString();
   m_Notes              = metaFile.value("notes", "").toString();
   QString tempGameName = metaFile.value("gameName", m_GameName).toString();
@@ -221,24 +231,22 @@ void ModInfoRegular::readMeta()
     }
   }
 
-  int numFiles = metaFile.beginReadArray("installedFiles");
-  for (int i = 0; i < numFiles; ++i) {
-    metaFile.setArrayIndex(i);
-    m_InstalledFileIDs.insert(std::make_pair(metaFile.value("modid").toInt(),
-                                             metaFile.value("fileid").toInt()));
+  int numFiles = metaFile.arraySize("installedFiles");
+  for (int i = 1; i <= numFiles; ++i) {
+    const QString prefix = QString("installedFiles/%1/").arg(i);
+    m_InstalledFileIDs.insert(
+        std::make_pair(metaFile.value(prefix + "modid").toInt(),
+                       metaFile.value(prefix + "fileid").toInt()));
   }
-  metaFile.endArray();
 
   // Plugin settings:
-  metaFile.beginGroup("Plugins");
-  for (auto pluginName : metaFile.childGroups()) {
-    metaFile.beginGroup(pluginName);
-    for (auto settingKey : metaFile.childKeys()) {
-      m_PluginSettings[pluginName][settingKey] = metaFile.value(settingKey);
+  for (auto pluginName : metaFile.childGroups("Plugins")) {
+    const QString group = "Plugins/" + pluginName;
+    for (auto settingKey : metaFile.childKeys(group)) {
+      m_PluginSettings[pluginName][settingKey] =
+          metaFile.value(group + "/" + settingKey);
     }
-    metaFile.endGroup();
   }
-  metaFile.endGroup();
 
   m_MetaInfoChanged = false;
 }
@@ -452,6 +460,8 @@ void ModInfoRegular::setCategory(int categoryID, bool active)
       }
     }
   }
+
+  invalidateFilterKey();
 }
 
 bool ModInfoRegular::setName(const QString& name)
@@ -505,6 +515,8 @@ bool ModInfoRegular::setName(const QString& name)
     m_Path = newPath;
   }
 
+  invalidateFilterKey();
+
   return true;
 }
 
@@ -512,12 +524,14 @@ void ModInfoRegular::setComments(const QString& comments)
 {
   m_Comments        = comments;
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
 }
 
 void ModInfoRegular::setNotes(const QString& notes)
 {
   m_Notes           = notes;
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
 }
 
 void ModInfoRegular::setGameName(const QString& gameName)
@@ -530,12 +544,14 @@ void ModInfoRegular::setNexusID(int modID)
 {
   m_NexusID         = modID;
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
 }
 
 void ModInfoRegular::setVersion(const VersionInfo& version)
 {
   m_Version         = version;
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
 }
 
 void ModInfoRegular::setNewestVersion(const VersionInfo& version)
@@ -543,6 +559,7 @@ void ModInfoRegular::setNewestVersion(const VersionInfo& version)
   if (version != m_NewestVersion) {
     m_NewestVersion   = version;
     m_MetaInfoChanged = true;
+    invalidateFilterKey();
   }
 }
 
@@ -559,6 +576,7 @@ void ModInfoRegular::setEndorsedState(EndorsedState endorsedState)
   if (endorsedState != m_EndorsedState) {
     m_EndorsedState   = endorsedState;
     m_MetaInfoChanged = true;
+    invalidateFilterKey();
   }
 }
 
@@ -567,6 +585,7 @@ void ModInfoRegular::setTrackedState(TrackedState trackedState)
   if (trackedState != m_TrackedState) {
     m_TrackedState    = trackedState;
     m_MetaInfoChanged = true;
+    invalidateFilterKey();
   }
 }
 
@@ -579,6 +598,7 @@ void ModInfoRegular::setInstallationFile(const QString& fileName)
 void ModInfoRegular::addNexusCategory(int categoryID)
 {
   m_Categories.insert(CategoryFactory::instance().resolveNexusID(categoryID));
+  invalidateFilterKey();
 }
 
 void ModInfoRegular::setIsEndorsed(bool endorsed)
@@ -587,6 +607,7 @@ void ModInfoRegular::setIsEndorsed(bool endorsed)
     m_EndorsedState =
         endorsed ? EndorsedState::ENDORSED_TRUE : EndorsedState::ENDORSED_FALSE;
     m_MetaInfoChanged = true;
+    invalidateFilterKey();
   }
 }
 
@@ -594,6 +615,7 @@ void ModInfoRegular::setNeverEndorse()
 {
   m_EndorsedState   = EndorsedState::ENDORSED_NEVER;
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
 }
 
 void ModInfoRegular::setIsTracked(bool tracked)
@@ -601,6 +623,7 @@ void ModInfoRegular::setIsTracked(bool tracked)
   if (tracked != (m_TrackedState == TrackedState::TRACKED_TRUE)) {
     m_TrackedState = tracked ? TrackedState::TRACKED_TRUE : TrackedState::TRACKED_FALSE;
     m_MetaInfoChanged = true;
+    invalidateFilterKey();
   }
 }
 
@@ -634,6 +657,7 @@ void ModInfoRegular::markConverted(bool converted)
 {
   m_Converted       = converted;
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
   saveMeta();
   emit modDetailsUpdated(true);
 }
@@ -642,6 +666,7 @@ void ModInfoRegular::markValidated(bool validated)
 {
   m_Validated       = validated;
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
   saveMeta();
   emit modDetailsUpdated(true);
 }
@@ -659,6 +684,7 @@ void ModInfoRegular::ignoreUpdate(bool ignore)
     m_IgnoredVersion.clear();
   }
   m_MetaInfoChanged = true;
+  invalidateFilterKey();
 }
 
 bool ModInfoRegular::canBeUpdated() const
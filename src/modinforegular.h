@@ -6,6 +6,8 @@
 #include "modinfowithconflictinfo.h"
 #include "nexusinterface.h"
 
+class MetaIni;
+
 /**
  * @brief Represents meta information about a single mod.
  *
@@ -403,6 +405,7 @@ public:
   virtual void saveMeta() override;
 
   void readMeta() override;
+  void readMeta(const MetaIni& metaFile);
 
   virtual void setHasCustomURL(bool b) override;
   virtual bool hasCustomURL() const override;
@@ -444,7 +447,7 @@ private slots:
 protected:
   virtual std::set<int> doGetContents() const override;
 
-  ModInfoRegular(const QDir& path, OrganizerCore& core);
+  ModInfoRegular(const QDir& path, OrganizerCore& core, const MetaIni* meta = nullptr);
 
 private:
   QString m_Name;
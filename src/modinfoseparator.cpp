@@ -29,6 +29,7 @@ QString ModInfoSeparator::name() const
   return ModInfoRegular::name();
 }
 
-ModInfoSeparator::ModInfoSeparator(const QDir& path, OrganizerCore& core)
-    : ModInfoRegular(path, core)
+ModInfoSeparator::ModInfoSeparator(const QDir& path, OrganizerCore& core,
+                                   const MetaIni* meta)
+    : ModInfoRegular(path, core, meta)
 {}
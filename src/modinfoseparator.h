@@ -56,7 +56,8 @@ protected:
   virtual bool doIsValid() const override { return true; }
 
 private:
-  ModInfoSeparator(const QDir& path, OrganizerCore& core);
+  ModInfoSeparator(const QDir& path, OrganizerCore& core,
+                   const MetaIni* meta = nullptr);
 };
 
 #endif
@@ -1,9 +1,9 @@
 #include "modinfowithconflictinfo.h"
+#include "conflictgraph.h"
 #include "shared/directoryentry.h"
 #include "shared/fileentry.h"
 #include "shared/filesorigin.h"
 #include "utility.h"
-#include <filesystem>
 
 #include "iplugingame.h"
 #include "moddatachecker.h"
@@ -12,7 +12,6 @@
 
 using namespace MOBase;
 using namespace MOShared;
-namespace fs = std::filesystem;
 
 ModInfoWithConflictInfo::ModInfoWithConflictInfo(OrganizerCore& core)
     : ModInfo(core), m_FileTree([this]() {
@@ -32,6 +31,7 @@ ModInfoWithConflictInfo::ModInfoWithConflictInfo(OrganizerCore& core)
 void ModInfoWithConflictInfo::clearCaches()
 {
   m_Conflicts.invalidate();
+  invalidateFilterKey();
 }
 
 std::vector<ModInfo::EFlag> ModInfoWithConflictInfo::getFlags() const
@@ -96,154 +96,62 @@ ModInfoWithConflictInfo::Conflicts ModInfoWithConflictInfo::doConflictCheck() co
 {
   Conflicts conflicts;
 
-  bool providesAnything = false;
-  bool hasHiddenFiles   = false;
+  const std::wstring name = ToWString(this->name());
 
-  int dataID = 0;
-  if (m_Core.directoryStructure()->originExists(L"data")) {
-    dataID = m_Core.directoryStructure()->getOriginByName(L"data").getID();
+  if (!m_Core.directoryStructure()->originExists(name)) {
+    return conflicts;
   }
 
-  std::wstring name          = ToWString(this->name());
-  const std::wstring hideExt = ToWString(ModInfo::s_HiddenExt);
+  // the graph is shared by all mods and only rebuilt when the structure changes
+  const OriginID id = m_Core.directoryStructure()->getOriginByName(name).getID();
+  const auto graph  = m_Core.conflictGraph();
+  const auto flags  = graph->flags(id);
 
-  if (m_Core.directoryStructure()->originExists(name)) {
-    FilesOrigin& origin = m_Core.directoryStructure()->getOriginByName(name);
-    std::vector<FileEntryPtr> files = origin.getFiles();
-    std::set<const DirectoryEntry*> checkedDirs;
-
-    // for all files in this origin
-    for (FileEntryPtr file : files) {
-
-      // skip hiidden file check if already found one
-      if (!hasHiddenFiles) {
-        const fs::path nameAsPath(file->getName());
-
-        if (nameAsPath.extension().wstring().compare(hideExt) == 0) {
-          hasHiddenFiles = true;
-        } else {
-          const DirectoryEntry* parent = file->getParent();
-
-          // iterate on all parent direEntries to check for .mohiddden
-          while (parent != nullptr) {
-            auto insertResult = checkedDirs.insert(parent);
-
-            if (insertResult.second == false) {
-              // if already present break as we can assume to have checked the parents
-              // as well
-              break;
-            } else {
-              const fs::path dirPath(parent->getName());
-              if (dirPath.extension().wstring().compare(hideExt) == 0) {
-                hasHiddenFiles = true;
-                break;
-              }
-              parent = parent->getParent();
-            }
-          }
-        }
-      }
-
-      auto alternatives = file->getAlternatives();
-      if ((alternatives.size() == 0) || (alternatives.back().originID() == dataID)) {
-        // no alternatives -> no conflict
-        providesAnything = true;
-      } else {
-        // Get the archive data for the current mod
-        DataArchiveOrigin archiveData;
-        if (file->getOrigin() == origin.getID())
-          archiveData = file->getArchive();
-        else {
-          for (const auto& alt : alternatives) {
-            if (alt.originID() == origin.getID()) {
-              archiveData = alt.archive();
-              break;
-            }
-          }
-        }
-
-        // If this is not the origin then determine the correct overwrite
-        if (file->getOrigin() != origin.getID()) {
-          FilesOrigin& altOrigin =
-              m_Core.directoryStructure()->getOriginByID(file->getOrigin());
-          unsigned int altIndex = ModInfo::getIndex(ToQString(altOrigin.getName()));
-          if (!file->isFromArchive()) {
-            if (!archiveData.isValid())
-              conflicts.m_OverwrittenList.insert(altIndex);
-            else
-              conflicts.m_ArchiveLooseOverwrittenList.insert(altIndex);
-          } else {
-            conflicts.m_ArchiveOverwrittenList.insert(altIndex);
-          }
-        } else {
-          providesAnything = true;
-        }
-
-        // Sort out the alternatives
-        for (const auto& altInfo : alternatives) {
-          if ((altInfo.originID() != dataID) &&
-              (altInfo.originID() != origin.getID())) {
-            FilesOrigin& altOrigin =
-                m_Core.directoryStructure()->getOriginByID(altInfo.originID());
-            QString altOriginName = ToQString(altOrigin.getName());
-            unsigned int altIndex = ModInfo::getIndex(altOriginName);
-            if (!altInfo.isFromArchive()) {
-              if (!archiveData.isValid()) {
-                if (origin.getPriority() > altOrigin.getPriority()) {
-                  conflicts.m_OverwriteList.insert(altIndex);
-                } else {
-                  conflicts.m_OverwrittenList.insert(altIndex);
-                }
-              } else {
-                conflicts.m_ArchiveLooseOverwrittenList.insert(altIndex);
-              }
-            } else {
-              if (!archiveData.isValid()) {
-                conflicts.m_ArchiveLooseOverwriteList.insert(altIndex);
-              } else {
-                if (archiveData.order() > altInfo.archive().order()) {
-                  conflicts.m_ArchiveOverwriteList.insert(altIndex);
-                } else if (archiveData.order() < altInfo.archive().order()) {
-                  conflicts.m_ArchiveOverwrittenList.insert(altIndex);
-                }
-              }
-            }
-          }
-        }
-      }
-    }
-
-    if (files.size() != 0) {
-      if (!providesAnything)
-        conflicts.m_CurrentConflictState = CONFLICT_REDUNDANT;
-      else if (!conflicts.m_OverwriteList.empty() &&
-               !conflicts.m_OverwrittenList.empty())
-        conflicts.m_CurrentConflictState = CONFLICT_MIXED;
-      else if (!conflicts.m_OverwriteList.empty())
-        conflicts.m_CurrentConflictState = CONFLICT_OVERWRITE;
-      else if (!conflicts.m_OverwrittenList.empty())
-        conflicts.m_CurrentConflictState = CONFLICT_OVERWRITTEN;
-
-      if (!conflicts.m_ArchiveOverwriteList.empty() &&
-          !conflicts.m_ArchiveOverwrittenList.empty())
-        conflicts.m_ArchiveConflictState = CONFLICT_MIXED;
-      else if (!conflicts.m_ArchiveOverwriteList.empty())
-        conflicts.m_ArchiveConflictState = CONFLICT_OVERWRITE;
-      else if (!conflicts.m_ArchiveOverwrittenList.empty())
-        conflicts.m_ArchiveConflictState = CONFLICT_OVERWRITTEN;
-
-      if (!conflicts.m_ArchiveLooseOverwrittenList.empty() &&
-          !conflicts.m_ArchiveLooseOverwriteList.empty())
-        conflicts.m_ArchiveConflictLooseState = CONFLICT_MIXED;
-      else if (!conflicts.m_ArchiveLooseOverwrittenList.empty())
-        conflicts.m_ArchiveConflictLooseState = CONFLICT_OVERWRITTEN;
-      else if (!conflicts.m_ArchiveLooseOverwriteList.empty())
-        conflicts.m_ArchiveConflictLooseState = CONFLICT_OVERWRITE;
-
-      conflicts.m_HasHiddenFiles = hasHiddenFiles;
-    }
+  if (!flags.hasFiles) {
+    return conflicts;
   }
 
+  auto edges = [&](ConflictGraph::Edge e) {
+    const auto targets = graph->edges(id, e);
+    return std::set<unsigned int>(targets.begin(), targets.end());
+  };
+
+  conflicts.m_OverwriteList          = edges(ConflictGraph::Edge::Overwrite);
+  conflicts.m_OverwrittenList        = edges(ConflictGraph::Edge::Overwritten);
+  conflicts.m_ArchiveOverwriteList   = edges(ConflictGraph::Edge::ArchiveOverwrite);
+  conflicts.m_ArchiveOverwrittenList = edges(ConflictGraph::Edge::ArchiveOverwritten);
+  conflicts.m_ArchiveLooseOverwriteList =
+      edges(ConflictGraph::Edge::ArchiveLooseOverwrite);
+  conflicts.m_ArchiveLooseOverwrittenList =
+      edges(ConflictGraph::Edge::ArchiveLooseOverwritten);
+
+  if (!flags.providesAnything)
+    conflicts.m_CurrentConflictState = CONFLICT_REDUNDANT;
+  else if (!conflicts.m_OverwriteList.empty() && !conflicts.m_OverwrittenList.empty())
+    conflicts.m_CurrentConflictState = CONFLICT_MIXED;
+  else if (!conflicts.m_OverwriteList.empty())
+    conflicts.m_CurrentConflictState = CONFLICT_OVERWRITE;
+  else if (!conflicts.m_OverwrittenList.empty())
+    conflicts.m_CurrentConflictState = CONFLICT_OVERWRITTEN;
+
+  if (!conflicts.m_ArchiveOverwriteList.empty() &&
+      !conflicts.m_ArchiveOverwrittenList.empty())
+    conflicts.m_ArchiveConflictState = CONFLICT_MIXED;
+  else if (!conflicts.m_ArchiveOverwriteList.empty())
+    conflicts.m_ArchiveConflictState = CONFLICT_OVERWRITE;
+  else if (!conflicts.m_ArchiveOverwrittenList.empty())
+    conflicts.m_ArchiveConflictState = CONFLICT_OVERWRITTEN;
+
+  if (!conflicts.m_ArchiveLooseOverwrittenList.empty() &&
+      !conflicts.m_ArchiveLooseOverwriteList.empty())
+    conflicts.m_ArchiveConflictLooseState = CONFLICT_MIXED;
+  else if (!conflicts.m_ArchiveLooseOverwrittenList.empty())
+    conflicts.m_ArchiveConflictLooseState = CONFLICT_OVERWRITTEN;
+  else if (!conflicts.m_ArchiveLooseOverwriteList.empty())
+    conflicts.m_ArchiveConflictLooseState = CONFLICT_OVERWRITE;
+
+  conflicts.m_HasHiddenFiles = flags.hasHiddenFiles;
+
   return conflicts;
 }
 
@@ -292,6 +200,7 @@ void ModInfoWithConflictInfo::diskContentModified()
   m_FileTree.invalidate();
   m_Valid.invalidate();
   m_Contents.invalidate();
+  invalidateFilterKey();
 }
 
 void ModInfoWithConflictInfo::prefetch()
@@ -583,6 +583,7 @@ bool ModList::setData(const QModelIndex& index, const QVariant& value, int role)
     } break;
     }
     if (result) {
+      info->invalidateFilterKey();
       emit dataChanged(index, index);
     }
   }
@@ -662,46 +663,15 @@ void ModList::changeModPriority(std::vector<int> sourceIndices, int newPriority)
 
   emit layoutAboutToBeChanged();
 
-  // sort the moving mods by ascending priorities
-  std::sort(sourceIndices.begin(), sourceIndices.end(),
-            [=](const int& LHS, const int& RHS) {
-              return m_Profile->getModPriority(LHS) > m_Profile->getModPriority(RHS);
-            });
-
-  // move mods that are decreasing in priority
-  for (const auto& index : sourceIndices) {
-    int oldPriority = m_Profile->getModPriority(index);
-    if (oldPriority > newPriority) {
-      if (m_Profile->setModPriority(index, newPriority)) {
-        m_ModMoved(ModInfo::getByIndex(index)->name(), oldPriority, newPriority);
-      }
-    }
-  }
-
-  // sort the moving mods by descending priorities
-  std::sort(sourceIndices.begin(), sourceIndices.end(),
-            [=](const int& LHS, const int& RHS) {
-              return m_Profile->getModPriority(LHS) < m_Profile->getModPriority(RHS);
-            });
+  // the mods are moved as a block in front of the mod currently at the new
+  // priority, see Profile::setModsPriority()
+  const std::vector<unsigned int> modIndices(sourceIndices.begin(),
+                                             sourceIndices.end());
 
-  // if at least one mod is increasing in priority, the target index is
-  // that of the row BELOW the dropped location, otherwise it's the one above
-  for (const auto& index : sourceIndices) {
-    int oldPriority = m_Profile->getModPriority(index);
-    if (oldPriority < newPriority) {
-      --newPriority;
-      break;
-    }
-  }
-
-  // move mods that are increasing in priority
-  for (const auto& index : sourceIndices) {
-    int oldPriority = m_Profile->getModPriority(index);
-    if (oldPriority < newPriority) {
-      if (m_Profile->setModPriority(index, newPriority)) {
-        m_ModMoved(ModInfo::getByIndex(index)->name(), oldPriority, newPriority);
-      }
-    }
+  for (const auto& [modIndex, oldPriority] :
+       m_Profile->setModsPriority(modIndices, newPriority)) {
+    m_ModMoved(ModInfo::getByIndex(modIndex)->name(), oldPriority,
+               m_Profile->getModPriority(modIndex));
   }
 
   emit layoutChanged();
@@ -752,6 +722,7 @@ void ModList::modInfoChanged(ModInfo::Ptr info)
 
     int row = ModInfo::getIndex(info->name());
     info->diskContentModified();
+    info->invalidateFilterKey();
     emit aboutToChangeData();
     emit dataChanged(index(row, 0), index(row, columnCount()));
     emit postDataChanged();
@@ -1231,12 +1202,21 @@ void ModList::notifyChange(int rowStart, int rowEnd)
   });
 
   if (rowStart < 0) {
+    ModInfo::invalidateFilterKeys();
     beginResetModel();
     endResetModel();
   } else {
     if (rowEnd == -1) {
       rowEnd = rowStart;
     }
+
+    // rows are mod indices
+    for (int i = rowStart; i <= rowEnd; ++i) {
+      if (i < static_cast<int>(ModInfo::getNumMods())) {
+        ModInfo::getByIndex(i)->invalidateFilterKey();
+      }
+    }
+
     emit dataChanged(this->index(rowStart, 0),
                      this->index(rowEnd, this->columnCount() - 1));
   }
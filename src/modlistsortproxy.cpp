@@ -37,6 +37,46 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 using namespace MOBase;
 
+// conflict flags that make a mod show up in the "conflicted" filter
+//
+static const std::bitset<64> ConflictFlags = [] {
+  std::bitset<64> flags;
+
+  for (auto flag :
+       {ModInfo::FLAG_CONFLICT_MIXED, ModInfo::FLAG_CONFLICT_OVERWRITE,
+        ModInfo::FLAG_CONFLICT_OVERWRITTEN, ModInfo::FLAG_CONFLICT_REDUNDANT,
+        ModInfo::FLAG_ARCHIVE_CONFLICT_OVERWRITE,
+        ModInfo::FLAG_ARCHIVE_CONFLICT_OVERWRITTEN,
+        ModInfo::FLAG_ARCHIVE_CONFLICT_MIXED,
+        ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITE,
+        ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITTEN}) {
+    flags.set(flag);
+  }
+
+  return flags;
+}();
+
+// mods that never have a nexus id, excluded from the "has nexus id" filter even
+// when it's inverted
+//
+static const std::bitset<64> NoNexusIDFlags = [] {
+  std::bitset<64> flags;
+
+  for (auto flag :
+       {ModInfo::FLAG_FOREIGN, ModInfo::FLAG_BACKUP, ModInfo::FLAG_OVERWRITE}) {
+    flags.set(flag);
+  }
+
+  return flags;
+}();
+
+// whether the vector has the bit for the given id
+//
+static bool testBit(const std::vector<bool>& bits, int id)
+{
+  return (id >= 0 && static_cast<std::size_t>(id) < bits.size() && bits[id]);
+}
+
 ModListSortProxy::ModListSortProxy(Profile* profile, OrganizerCore* organizer)
     : QSortFilterProxyModel(organizer), m_Organizer(organizer), m_Profile(profile),
       m_FilterActive(false), m_FilterMode(FilterAnd),
@@ -44,6 +84,13 @@ ModListSortProxy::ModListSortProxy(Profile* profile, OrganizerCore* organizer)
 {
   setDynamicSortFilter(true);  // this seems to work without dynamicsortfilter
                                // but I don't know why. This should be necessary
+
+  // names and parents of categories are in the filter keys of the mods
+  connect(&CategoryFactory::instance(), &CategoryFactory::categoriesSaved, this,
+          [this] {
+            ModInfo::invalidateFilterKeys();
+            invalidateFilter();
+          });
 }
 
 void ModListSortProxy::setProfile(Profile* profile)
@@ -65,6 +112,11 @@ void ModListSortProxy::setCriteria(const std::vector<Criteria>& criteria)
       (!criteria.empty() && criteria[0].id == CategoryFactory::UpdateAvailable);
 
   if (changed || isForUpdates) {
+    if (isForUpdates) {
+      // update checks change the mods without notifying the mod list
+      ModInfo::invalidateFilterKeys();
+    }
+
     m_Criteria = criteria;
     updateFilterActive();
     invalidateFilter();
@@ -237,35 +289,42 @@ bool ModListSortProxy::lessThan(const QModelIndex& left, const QModelIndex& righ
 void ModListSortProxy::updateFilter(const QString& filter)
 {
   m_Filter = filter;
-  updateFilterActive();
-  invalidateFilter();
-  emit filterInvalidated();
-}
+  m_FilterGroups.clear();
 
-bool ModListSortProxy::hasConflictFlag(
-    const std::vector<ModInfo::EConflictFlag>& flags) const
-{
-  for (ModInfo::EConflictFlag flag : flags) {
-    if ((flag == ModInfo::FLAG_CONFLICT_MIXED) ||
-        (flag == ModInfo::FLAG_CONFLICT_OVERWRITE) ||
-        (flag == ModInfo::FLAG_CONFLICT_OVERWRITTEN) ||
-        (flag == ModInfo::FLAG_CONFLICT_REDUNDANT) ||
-        (flag == ModInfo::FLAG_ARCHIVE_CONFLICT_OVERWRITE) ||
-        (flag == ModInfo::FLAG_ARCHIVE_CONFLICT_OVERWRITTEN) ||
-        (flag == ModInfo::FLAG_ARCHIVE_CONFLICT_MIXED) ||
-        (flag == ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITE) ||
-        (flag == ModInfo::FLAG_ARCHIVE_LOOSE_CONFLICT_OVERWRITTEN)) {
-      return true;
+  QString filterCopy = QString(m_Filter);
+  filterCopy.replace("||", ";").replace("OR", ";").replace("|", ";");
+
+  // split in OR segments that internally use AND logic; segments without words
+  // are kept, they match everything
+  for (auto& ORSegment : filterCopy.split(";", Qt::SkipEmptyParts)) {
+    std::vector<Keyword> group;
+
+    for (auto& word : ORSegment.split(" ", Qt::SkipEmptyParts)) {
+      Keyword k;
+      k.text = word.toCaseFolded();
+
+      bool ok      = false;
+      const int id = word.toInt(&ok);
+      if (ok && id > 0) {
+        k.id = id;
+      }
+
+      group.push_back(std::move(k));
     }
+
+    m_FilterGroups.push_back(std::move(group));
   }
 
-  return false;
+  updateFilterActive();
+  invalidateFilter();
+  emit filterInvalidated();
 }
 
-bool ModListSortProxy::filterMatchesModAnd(ModInfo::Ptr info, bool enabled) const
+bool ModListSortProxy::filterMatchesModAnd(const ModInfo::FilterKey& key,
+                                           bool enabled) const
 {
   for (auto&& c : m_Criteria) {
-    if (!criteriaMatchMod(info, enabled, c)) {
+    if (!criteriaMatchMod(key, enabled, c)) {
       return false;
     }
   }
@@ -273,10 +332,11 @@ bool ModListSortProxy::filterMatchesModAnd(ModInfo::Ptr info, bool enabled) cons
   return true;
 }
 
-bool ModListSortProxy::filterMatchesModOr(ModInfo::Ptr info, bool enabled) const
+bool ModListSortProxy::filterMatchesModOr(const ModInfo::FilterKey& key,
+                                          bool enabled) const
 {
   for (auto&& c : m_Criteria) {
-    if (criteriaMatchMod(info, enabled, c)) {
+    if (criteriaMatchMod(key, enabled, c)) {
       return true;
     }
   }
@@ -294,7 +354,7 @@ bool ModListSortProxy::optionsMatchMod(ModInfo::Ptr info, bool) const
   return true;
 }
 
-bool ModListSortProxy::criteriaMatchMod(ModInfo::Ptr info, bool enabled,
+bool ModListSortProxy::criteriaMatchMod(const ModInfo::FilterKey& key, bool enabled,
                                         const Criteria& c) const
 {
   bool b = false;
@@ -302,12 +362,12 @@ bool ModListSortProxy::criteriaMatchMod(ModInfo::Ptr info, bool enabled,
   switch (c.type) {
   case TypeSpecial:  // fall-through
   case TypeCategory: {
-    b = categoryMatchesMod(info, enabled, c.id);
+    b = categoryMatchesMod(key, enabled, c.id);
     break;
   }
 
   case TypeContent: {
-    b = contentMatchesMod(info, enabled, c.id);
+    b = contentMatchesMod(key, enabled, c.id);
     break;
   }
 
@@ -324,75 +384,74 @@ bool ModListSortProxy::criteriaMatchMod(ModInfo::Ptr info, bool enabled,
   return b;
 }
 
-bool ModListSortProxy::categoryMatchesMod(ModInfo::Ptr info, bool enabled,
-                                          int category) const
+bool ModListSortProxy::categoryMatchesMod(const ModInfo::FilterKey& key,
+                                          bool enabled, int category) const
 {
   bool b = false;
 
   switch (category) {
   case CategoryFactory::Checked: {
-    b = (enabled || info->alwaysEnabled());
+    b = (enabled || key.alwaysEnabled);
     break;
   }
 
   case CategoryFactory::UpdateAvailable: {
-    b = (info->updateAvailable() || info->downgradeAvailable());
+    b = key.updateAvailable;
     break;
   }
 
   case CategoryFactory::HasCategory: {
-    b = !info->getCategories().empty();
+    b = key.hasCategories;
     break;
   }
 
   case CategoryFactory::Conflict: {
-    b = (hasConflictFlag(info->getConflictFlags()));
+    b = (key.conflictFlags & ConflictFlags).any();
     break;
   }
 
   case CategoryFactory::HasHiddenFiles: {
-    b = (info->hasFlag(ModInfo::FLAG_HIDDEN_FILES));
+    b = key.flags[ModInfo::FLAG_HIDDEN_FILES];
     break;
   }
 
   case CategoryFactory::Endorsed: {
-    b = (info->endorsedState() == EndorsedState::ENDORSED_TRUE);
+    b = key.endorsed;
     break;
   }
 
   case CategoryFactory::Backup: {
-    b = (info->hasFlag(ModInfo::FLAG_BACKUP));
+    b = key.flags[ModInfo::FLAG_BACKUP];
     break;
   }
 
   case CategoryFactory::Managed: {
-    b = (!info->hasFlag(ModInfo::FLAG_FOREIGN));
+    b = !key.flags[ModInfo::FLAG_FOREIGN];
     break;
   }
 
   case CategoryFactory::HasGameData: {
-    b = !info->hasFlag(ModInfo::FLAG_INVALID);
+    b = !key.flags[ModInfo::FLAG_INVALID];
     break;
   }
 
   case CategoryFactory::HasNexusID: {
     // never show these
-    if (info->hasFlag(ModInfo::FLAG_FOREIGN) || info->hasFlag(ModInfo::FLAG_BACKUP) ||
-        info->hasFlag(ModInfo::FLAG_OVERWRITE)) {
+    if ((key.flags & NoNexusIDFlags).any()) {
       return false;
     }
 
-    b = (info->nexusId() > 0);
+    b = (key.nexusID > 0);
     break;
   }
 
   case CategoryFactory::Tracked: {
-    b = (info->trackedState() == TrackedState::TRACKED_TRUE);
+    b = key.tracked;
     break;
   }
 
   default: {
-    b = (info->categorySet(category));
+    b = testBit(key.categoryIDs, category);
     break;
   }
   }
@@ -400,10 +459,56 @@ bool ModListSortProxy::categoryMatchesMod(ModInfo::Ptr info, bool enabled,
   return b;
 }
 
-bool ModListSortProxy::contentMatchesMod(ModInfo::Ptr info, bool enabled,
+bool ModListSortProxy::contentMatchesMod(const ModInfo::FilterKey& key, bool enabled,
                                          int content) const
 {
-  return info->hasContent(content);
+  return testBit(key.contents, content);
+}
+
+bool ModListSortProxy::keywordMatchesMod(const ModInfo::FilterKey& key,
+                                         const Keyword& k) const
+{
+  // search keyword in name
+  if (m_EnabledColumns[ModList::COL_NAME] && key.name.contains(k.text)) {
+    return true;
+  }
+
+  // Search by notes
+  if (m_EnabledColumns[ModList::COL_NOTES] && key.notes.contains(k.text)) {
+    return true;
+  }
+
+  // Search by categories
+  if (m_EnabledColumns[ModList::COL_CATEGORY] && key.categories.contains(k.text)) {
+    return true;
+  }
+
+  // Search by Nexus ID, matches any prefix of the id
+  if (k.id > 0 && m_EnabledColumns[ModList::COL_MODID]) {
+    for (int modID = key.nexusID; modID > 0; modID /= 10) {
+      if (modID == k.id) {
+        return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+bool ModListSortProxy::textMatchesMod(const ModInfo::FilterKey& key) const
+{
+  for (auto&& group : m_FilterGroups) {
+    // each word in the group needs to be matched but it doesn't matter where
+    const bool all = std::all_of(group.begin(), group.end(), [&](auto&& k) {
+      return keywordMatchesMod(key, k);
+    });
+
+    if (all) {
+      return true;
+    }
+  }
+
+  return false;
 }
 
 bool ModListSortProxy::filterMatchesMod(ModInfo::Ptr info, bool enabled) const
@@ -413,8 +518,10 @@ bool ModListSortProxy::filterMatchesMod(ModInfo::Ptr info, bool enabled) const
     return true;
   }
 
+  const ModInfo::FilterKey& key = info->filterKey();
+
   // special case for separators
-  if (info->hasFlag(ModInfo::FLAG_SEPARATOR)) {
+  if (key.flags[ModInfo::FLAG_SEPARATOR]) {
     switch (m_FilterSeparators) {
     case SeparatorFilter: {
       // filter normally
@@ -433,90 +540,14 @@ bool ModListSortProxy::filterMatchesMod(ModInfo::Ptr info, bool enabled) const
     }
   }
 
-  if (!m_Filter.isEmpty()) {
-    bool display       = false;
-    QString filterCopy = QString(m_Filter);
-    filterCopy.replace("||", ";").replace("OR", ";").replace("|", ";");
-    QStringList ORList = filterCopy.split(";", Qt::SkipEmptyParts);
-
-    bool segmentGood = true;
-
-    // split in ORSegments that internally use AND logic
-    for (auto& ORSegment : ORList) {
-      QStringList ANDKeywords = ORSegment.split(" ", Qt::SkipEmptyParts);
-      segmentGood             = true;
-      bool foundKeyword       = false;
-
-      // check each word in the segment for match, each word needs to be matched but it
-      // doesn't matter where.
-      for (auto& currentKeyword : ANDKeywords) {
-        foundKeyword = false;
-
-        // search keyword in name
-        if (m_EnabledColumns[ModList::COL_NAME] &&
-            info->name().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by notes
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_NOTES] &&
-            info->comments().contains(currentKeyword, Qt::CaseInsensitive)) {
-          foundKeyword = true;
-        }
-
-        // Search by categories
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_CATEGORY]) {
-          for (auto category : info->categories()) {
-            if (category.contains(currentKeyword, Qt::CaseInsensitive)) {
-              foundKeyword = true;
-              break;
-            }
-          }
-        }
-
-        // Search by Nexus ID
-        if (!foundKeyword && m_EnabledColumns[ModList::COL_MODID]) {
-          bool ok;
-          int filterID = currentKeyword.toInt(&ok);
-          if (ok) {
-            int modID = info->nexusId();
-            while (modID > 0) {
-              if (modID == filterID) {
-                foundKeyword = true;
-                break;
-              }
-              modID = (int)(modID / 10);
-            }
-          }
-        }
-
-        if (!foundKeyword) {
-          // currentKeword is missing from everything, AND fails and we need to check
-          // next ORsegment
-          segmentGood = false;
-          break;
-        }
-
-      }  // for ANDKeywords loop
-
-      if (segmentGood) {
-        // the last AND loop didn't break so the ORSegments is true so mod matches
-        // filter
-        display = true;
-        break;
-      }
-
-    }  // for ORList loop
-
-    if (!display) {
-      return false;
-    }
-  }  // if (!m_CurrentFilter.isEmpty())
+  if (!m_Filter.isEmpty() && !textMatchesMod(key)) {
+    return false;
+  }
 
   if (m_FilterMode == FilterAnd) {
-    return filterMatchesModAnd(info, enabled);
+    return filterMatchesModAnd(key, enabled);
   } else {
-    return filterMatchesModOr(info, enabled);
+    return filterMatchesModOr(key, enabled);
   }
 }
 
@@ -130,10 +130,9 @@ protected:
 private:
   unsigned long flagsId(const std::vector<ModInfo::EFlag>& flags) const;
   unsigned long conflictFlagsId(const std::vector<ModInfo::EConflictFlag>& flags) const;
-  bool hasConflictFlag(const std::vector<ModInfo::EConflictFlag>& flags) const;
   void updateFilterActive();
-  bool filterMatchesModAnd(ModInfo::Ptr info, bool enabled) const;
-  bool filterMatchesModOr(ModInfo::Ptr info, bool enabled) const;
+  bool filterMatchesModAnd(const ModInfo::FilterKey& key, bool enabled) const;
+  bool filterMatchesModOr(const ModInfo::FilterKey& key, bool enabled) const;
 
   // check if the source model is the by-priority proxy
   //
@@ -152,6 +151,18 @@ private:
   QString m_Filter;
   std::bitset<ModList::COL_LASTCOLUMN + 1> m_EnabledColumns;
 
+  // a word of the filter text, case-folded; `id` is set when the word is a
+  // number that can match a nexus id
+  struct Keyword
+  {
+    QString text;
+    int id = 0;
+  };
+
+  // m_Filter split once in groups of words, a mod matches if it has all the
+  // words of any group
+  std::vector<std::vector<Keyword>> m_FilterGroups;
+
   bool m_FilterActive;
   FilterMode m_FilterMode;
   SeparatorsMode m_FilterSeparators;
@@ -159,9 +170,14 @@ private:
   std::vector<Criteria> m_PreChangeCriteria;
 
   bool optionsMatchMod(ModInfo::Ptr info, bool enabled) const;
-  bool criteriaMatchMod(ModInfo::Ptr info, bool enabled, const Criteria& c) const;
-  bool categoryMatchesMod(ModInfo::Ptr info, bool enabled, int category) const;
-  bool contentMatchesMod(ModInfo::Ptr info, bool enabled, int content) const;
+  bool criteriaMatchMod(const ModInfo::FilterKey& key, bool enabled,
+                        const Criteria& c) const;
+  bool textMatchesMod(const ModInfo::FilterKey& key) const;
+  bool keywordMatchesMod(const ModInfo::FilterKey& key, const Keyword& k) const;
+  bool categoryMatchesMod(const ModInfo::FilterKey& key, bool enabled,
+                          int category) const;
+  bool contentMatchesMod(const ModInfo::FilterKey& key, bool enabled,
+                         int content) const;
 };
 
 #endif  // MODLISTSORTPROXY_H
@@ -303,6 +303,9 @@ std::optional<unsigned int> ModListView::prevMod(unsigned int modIndex) const
 
 void ModListView::invalidateFilter()
 {
+  // called when mods changed without the mod list being notified, such as after
+  // an update check
+  ModInfo::invalidateFilterKeys();
   m_sortProxy->invalidate();
 }
 
@@ -39,6 +39,22 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 using namespace MOBase;
 using namespace MOShared;
 
+// bulk requests are sent at most this often, so an update check for thousands
+// of mods doesn't run into the limit on requests per second
+static const int BulkInterval = 250;
+
+// times a request is sent again after being told to slow down, waiting twice
+// as long every time
+static const int MaxRetries   = 3;
+static const int RetryBackoff = 2000;
+
+// cached responses younger than this are used without asking the server, older
+// ones are revalidated with a conditional request
+static const int CacheFreshness = 15 * 60;
+
+// size of the cache for api responses, least recently used ones are removed
+static const qint64 MaxCacheSize = 32 * 1024 * 1024;
+
 void throttledWarning(const APIUserAccount& user)
 {
   log::error("You have fewer than {} requests remaining ({}). Only downloads and "
@@ -46,6 +62,22 @@ void throttledWarning(const APIUserAccount& user)
              APIUserAccount::ThrottleThreshold, user.remainingRequests());
 }
 
+// milliseconds until a few minutes after the start of the next hour, when the
+// hourly allowance has been replenished
+//
+static int msecsUntilReset()
+{
+  const QTime time = QTime::currentTime();
+  const QTime target((time.hour() + 1) % 24, 5, 0);
+
+  int secs = time.secsTo(target);
+  if (secs <= 0) {
+    secs += 24 * 60 * 60;
+  }
+
+  return secs * 1000;
+}
+
 NexusBridge::NexusBridge(PluginContainer* pluginContainer, const QString& subModule)
     : m_Interface(&NexusInterface::instance()), m_SubModule(subModule)
 {}
@@ -280,8 +312,16 @@ NexusInterface::NexusInterface(Settings* s) : m_PluginContainer(nullptr)
 
   m_DiskCache = new QNetworkDiskCache(this);
 
+  m_ApiCache = new QNetworkDiskCache(this);
+  m_ApiCache->setMaximumCacheSize(MaxCacheSize);
+
   connect(m_AccessManager, SIGNAL(requestNXMDownload(QString)), this,
           SLOT(downloadRequestedNXM(QString)));
+
+  m_WakeTimer.setSingleShot(true);
+  connect(&m_WakeTimer, &QTimer::timeout, this, [this] {
+    nextRequest();
+  });
 }
 
 NexusInterface::~NexusInterface()
@@ -307,6 +347,10 @@ void NexusInterface::setCacheDirectory(const QString& directory)
 {
   m_DiskCache->setCacheDirectory(directory);
   m_AccessManager->setCache(m_DiskCache);
+
+  // api responses are cached separately, they're never used by the access
+  // manager itself
+  m_ApiCache->setCacheDirectory(QDir(directory).filePath("nexus"));
 }
 
 void NexusInterface::loginCompleted()
@@ -533,7 +577,7 @@ int NexusInterface::requestDescription(QString gameName, int modID, QObject* rec
 {
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_DESCRIPTION, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmDescriptionAvailable(QString, int, QVariant, QVariant, int)),
           receiver,
@@ -560,7 +604,7 @@ int NexusInterface::requestModInfo(QString gameName, int modID, QObject* receive
 
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_MODINFO, userData, subModule,
                              game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmModInfoAvailable(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmModInfoAvailable(QString, int, QVariant, QVariant, int)),
@@ -581,14 +625,9 @@ int NexusInterface::requestUpdateInfo(QString gameName,
                                       const QString& subModule,
                                       const MOBase::IPluginGame* game)
 {
-  if (m_User.shouldThrottle()) {
-    throttledWarning(m_User);
-    return -1;
-  }
-
   NXMRequestInfo requestInfo(period, NXMRequestInfo::TYPE_CHECKUPDATES, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmUpdateInfoAvailable(QString, QVariant, QVariant, int)),
           receiver, SLOT(nxmUpdateInfoAvailable(QString, QVariant, QVariant, int)),
@@ -607,11 +646,6 @@ int NexusInterface::requestUpdates(const int& modID, QObject* receiver,
                                    QVariant userData, QString gameName,
                                    const QString& subModule)
 {
-  if (m_User.shouldThrottle()) {
-    throttledWarning(m_User);
-    return -1;
-  }
-
   IPluginGame* game = getGame(gameName);
   if (game == nullptr) {
     log::error("requestUpdates can't find plugin for {}", gameName);
@@ -620,7 +654,7 @@ int NexusInterface::requestUpdates(const int& modID, QObject* receiver,
 
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_GETUPDATES, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmUpdatesAvailable(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmUpdatesAvailable(QString, int, QVariant, QVariant, int)),
@@ -659,7 +693,7 @@ int NexusInterface::requestFiles(QString gameName, int modID, QObject* receiver,
 {
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_FILES, userData, subModule,
                              game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
   connect(this, SIGNAL(nxmFilesAvailable(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmFilesAvailable(QString, int, QVariant, QVariant, int)),
           Qt::UniqueConnection);
@@ -685,7 +719,7 @@ int NexusInterface::requestFileInfo(QString gameName, int modID, int fileID,
 
   NXMRequestInfo requestInfo(modID, fileID, NXMRequestInfo::TYPE_FILEINFO, userData,
                              subModule, gamePlugin);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(
       this, SIGNAL(nxmFileInfoAvailable(QString, int, int, QVariant, QVariant, int)),
@@ -708,7 +742,7 @@ int NexusInterface::requestDownloadURL(QString gameName, int modID, int fileID,
 {
   NXMRequestInfo requestInfo(modID, fileID, NXMRequestInfo::TYPE_DOWNLOADURL, userData,
                              subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this,
           SIGNAL(nxmDownloadURLsAvailable(QString, int, int, QVariant, QVariant, int)),
@@ -729,7 +763,7 @@ int NexusInterface::requestEndorsementInfo(QObject* receiver, QVariant userData,
                                            const QString& subModule)
 {
   NXMRequestInfo requestInfo(NXMRequestInfo::TYPE_ENDORSEMENTS, userData, subModule);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmEndorsementsAvailable(QVariant, QVariant, int)), receiver,
           SLOT(nxmEndorsementsAvailable(QVariant, QVariant, int)),
@@ -758,7 +792,7 @@ int NexusInterface::requestToggleEndorsement(QString gameName, int modID,
   NXMRequestInfo requestInfo(modID, modVersion, NXMRequestInfo::TYPE_TOGGLEENDORSEMENT,
                              userData, subModule, game);
   requestInfo.m_Endorse = endorse;
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmEndorsementToggled(QString, int, QVariant, QVariant, int)),
           receiver, SLOT(nxmEndorsementToggled(QString, int, QVariant, QVariant, int)),
@@ -777,7 +811,7 @@ int NexusInterface::requestTrackingInfo(QObject* receiver, QVariant userData,
                                         const QString& subModule)
 {
   NXMRequestInfo requestInfo(NXMRequestInfo::TYPE_TRACKEDMODS, userData, subModule);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmTrackedModsAvailable(QVariant, QVariant, int)), receiver,
           SLOT(nxmTrackedModsAvailable(QVariant, QVariant, int)), Qt::UniqueConnection);
@@ -804,7 +838,7 @@ int NexusInterface::requestToggleTracking(QString gameName, int modID, bool trac
   NXMRequestInfo requestInfo(modID, NXMRequestInfo::TYPE_TOGGLETRACKING, userData,
                              subModule, game);
   requestInfo.m_Track = track;
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmTrackingToggled(QString, int, QVariant, bool, int)), receiver,
           SLOT(nxmTrackingToggled(QString, int, QVariant, bool, int)),
@@ -829,7 +863,7 @@ int NexusInterface::requestGameInfo(QString gameName, QObject* receiver,
   }
 
   NXMRequestInfo requestInfo(NXMRequestInfo::TYPE_GAMEINFO, userData, subModule, game);
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmGameInfoAvailable(QString, QVariant, QVariant, int)),
           receiver, SLOT(nxmGameInfoAvailable(QString, QVariant, QVariant, int)),
@@ -855,7 +889,7 @@ int NexusInterface::requestInfoFromMd5(QString gameName, QByteArray& hash,
   requestInfo.m_AllowedErrors[QNetworkReply::NetworkError::ContentNotFoundError].append(
       404);
   requestInfo.m_IgnoreGenericErrorHandler = true;
-  m_RequestQueue.enqueue(requestInfo);
+  enqueue(requestInfo);
 
   connect(this, SIGNAL(nxmFileInfoFromMd5Available(QString, QVariant, QVariant, int)),
           receiver, SLOT(nxmFileInfoFromMd5Available(QString, QVariant, QVariant, int)),
@@ -888,17 +922,88 @@ void NexusInterface::cleanup()
 {
   m_AccessManager = nullptr;
   m_DiskCache     = nullptr;
+  m_ApiCache      = nullptr;
 }
 
 void NexusInterface::clearCache()
 {
   m_DiskCache->clear();
+  m_ApiCache->clear();
   m_AccessManager->clearCookies();
 }
 
+void NexusInterface::enqueue(NXMRequestInfo info, bool useCache)
+{
+  info.m_Key = info.key();
+
+  if (info.m_Revalidate) {
+    // never coalesced with a request that expects a result
+    info.m_Key += "/revalidate";
+  } else if (useCache) {
+    const auto cached  = cachedMetaData(info);
+    const bool offline = Settings::instance().network().offlineMode();
+    const bool fresh =
+        cached.isValid() && cached.expirationDate() > QDateTime::currentDateTimeUtc();
+
+    // bulk requests wait for the server unless the response is fresh, they're
+    // looking for changes
+    if (cached.isValid() && (fresh || offline || !info.isBulk())) {
+      // the caller connects its slots and gets the id of the request before
+      // the result is emitted
+      QTimer::singleShot(0, this, [this, info] {
+        // answers this request only, the receivers coalesced with an identical
+        // request that is queued or running are answered by that one
+        NXMRequestInfo own = info;
+        own.m_Key.clear();
+
+        if (!emitCached(own)) {
+          enqueue(info, false);
+          nextRequest();
+        }
+      });
+
+      if (!fresh && !offline) {
+        NXMRequestInfo revalidate = info;
+        revalidate.m_Revalidate   = true;
+        enqueue(revalidate, false);
+      }
+
+      return;
+    }
+  }
+
+  if (!info.m_Key.isEmpty()) {
+    auto itor = m_Coalesced.find(info.m_Key);
+
+    if (itor != m_Coalesced.end()) {
+      // the same request is already queued or running
+      itor->push_back({info.m_ID, info.m_UserData});
+      return;
+    }
+
+    m_Coalesced.insert(info.m_Key, {});
+  }
+
+  if (info.isBulk()) {
+    m_BulkQueue.enqueue(info);
+  } else {
+    m_RequestQueue.enqueue(info);
+  }
+}
+
+void NexusInterface::wakeIn(int msecs)
+{
+  msecs = std::max(msecs, 0);
+
+  if (!m_WakeTimer.isActive() || m_WakeTimer.remainingTime() > msecs) {
+    m_WakeTimer.start(msecs);
+  }
+}
+
 void NexusInterface::nextRequest()
 {
-  if ((m_ActiveRequest.size() >= MAX_ACTIVE_DOWNLOADS) || m_RequestQueue.isEmpty()) {
+  if ((m_ActiveRequest.size() >= MAX_ACTIVE_DOWNLOADS) ||
+      (m_RequestQueue.isEmpty() && m_BulkQueue.isEmpty())) {
     return;
   }
 
@@ -915,23 +1020,84 @@ void NexusInterface::nextRequest()
     }
   }
 
-  if (m_User.exhausted()) {
-    m_RequestQueue.clear();
-    QTime time = QTime::currentTime();
-    QTime targetTime;
-    targetTime.setHMS((time.hour() + 1) % 23, 5, 0);
-    QString warning = tr("You've exceeded the Nexus API rate limit and requests are "
-                         "now being throttled. "
-                         "Your next batch of requests will be available in "
-                         "approximately %1 minutes and %2 seconds.")
-                          .arg(time.secsTo(targetTime) / 60)
-                          .arg(time.secsTo(targetTime) % 60);
-
-    log::warn("{}", warning);
+  if (!m_Backoff.hasExpired()) {
+    // the timer calls this again once the wait is over
     return;
   }
 
-  NXMRequestInfo info = m_RequestQueue.dequeue();
+  if (m_User.exhausted()) {
+    if (m_WaitingForReset) {
+      // the hourly allowance should be back, the response to this request will
+      // have the actual limits
+      APILimits limits               = m_User.limits();
+      limits.remainingHourlyRequests = limits.maxHourlyRequests;
+      m_User.limits(limits);
+      m_WaitingForReset = false;
+    } else {
+      // other requests are dropped, bulk requests wait for the reset
+      for (auto&& info : m_RequestQueue) {
+        m_Coalesced.remove(info.m_Key);
+      }
+      m_RequestQueue.clear();
+
+      const int wait  = msecsUntilReset();
+      QString warning = tr("You've exceeded the Nexus API rate limit and requests are "
+                           "now being throttled. "
+                           "Your next batch of requests will be available in "
+                           "approximately %1 minutes and %2 seconds.")
+                            .arg(wait / 60000)
+                            .arg((wait / 1000) % 60);
+
+      log::warn("{}", warning);
+
+      m_WaitingForReset = true;
+      m_Backoff.setRemainingTime(wait);
+      wakeIn(wait);
+
+      emit requestsChanged(getAPIStats(), m_User);
+      return;
+    }
+  }
+
+  QQueue<NXMRequestInfo>* queue = &m_RequestQueue;
+
+  if (queue->isEmpty()) {
+    // the limits come from the last response, requests that are still running
+    // will use some of them
+    const int remaining =
+        m_User.remainingRequests() - static_cast<int>(m_ActiveRequest.size());
+
+    if (remaining <= APIUserAccount::ThrottleThreshold) {
+      // the last requests of the budget are kept for what the user does
+      if (!m_BulkHeld) {
+        log::warn("{} update check requests are waiting until more API requests "
+                  "are available",
+                  m_BulkQueue.size());
+
+        m_BulkHeld = true;
+        m_BulkProbe.setRemainingTime(msecsUntilReset());
+      }
+
+      if (!m_BulkProbe.hasExpired()) {
+        wakeIn(m_BulkProbe.remainingTime());
+        return;
+      }
+
+      m_BulkProbe.setRemainingTime(msecsUntilReset());
+    } else {
+      m_BulkHeld = false;
+    }
+
+    if (m_LastBulk.isValid() && m_LastBulk.elapsed() < BulkInterval) {
+      wakeIn(BulkInterval - static_cast<int>(m_LastBulk.elapsed()));
+      return;
+    }
+
+    m_LastBulk.start();
+    queue = &m_BulkQueue;
+  }
+
+  NXMRequestInfo info = queue->dequeue();
   info.m_Timeout      = new QTimer(this);
   info.m_Timeout->setInterval(60000);
 
@@ -1059,6 +1225,18 @@ void NexusInterface::nextRequest()
   request.setRawHeader("Application-Version",
                        QApplication::applicationVersion().toUtf8());
 
+  // the server only sends the response again if it changed, a 304 uses the one
+  // in the cache, see requestFinished()
+  for (auto&& header : cachedMetaData(info).rawHeaders()) {
+    const auto name = header.first.toLower();
+
+    if (name == "etag") {
+      request.setRawHeader("If-None-Match", header.second);
+    } else if (name == "last-modified") {
+      request.setRawHeader("If-Modified-Since", header.second);
+    }
+  }
+
   if (postData.object().isEmpty()) {
     if (!requestIsDelete) {
       info.m_Reply = m_AccessManager->get(request);
@@ -1081,6 +1259,13 @@ void NexusInterface::nextRequest()
   connect(info.m_Timeout, SIGNAL(timeout()), this, SLOT(requestTimeout()));
   info.m_Timeout->start();
   m_ActiveRequest.push_back(info);
+
+  // more requests may be sent right away, bulk requests are paced
+  if (!m_RequestQueue.isEmpty()) {
+    wakeIn(0);
+  } else if (!m_BulkQueue.isEmpty()) {
+    wakeIn(BulkInterval);
+  }
 }
 
 void NexusInterface::downloadRequestedNXM(const QString& url)
@@ -1104,11 +1289,38 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
     } else if (statusCode == 429) {
       m_User.limits(parseLimits(reply));
 
+      bool retry = false;
+
       if (!m_User.exhausted()) {
         log::warn("You appear to be making requests to the Nexus API too quickly and "
                   "are being throttled. Please inform the MO2 team.");
+
+        if (iter->m_Retries < MaxRetries) {
+          const int wait = RetryBackoff << iter->m_Retries;
+          ++iter->m_Retries;
+
+          m_Backoff.setRemainingTime(wait);
+          wakeIn(wait);
+          retry = true;
+        }
       } else {
         log::warn("All API requests have been consumed and are now being denied.");
+
+        // sent again after the reset, see nextRequest()
+        retry = iter->isBulk();
+      }
+
+      if (retry) {
+        // goes back to the front of its queue, it keeps its entry in
+        // m_Coalesced
+        if (iter->isBulk()) {
+          m_BulkQueue.prepend(*iter);
+        } else {
+          m_RequestQueue.prepend(*iter);
+        }
+
+        emit requestsChanged(getAPIStats(), m_User);
+        return;
       }
 
       emit requestsChanged(getAPIStats(), m_User);
@@ -1125,8 +1337,7 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
         }
       }
     }
-    emit nxmRequestFailed(iter->m_GameName, iter->m_ModID, iter->m_FileID,
-                          iter->m_UserData, iter->m_ID, statusCode, errorMsg);
+    emitFailed(*iter, statusCode, errorMsg);
   } else {
     int statusCode = reply->attribute(QNetworkRequest::HttpStatusCodeAttribute).toInt();
     if (statusCode == 301) {
@@ -1134,10 +1345,27 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
       iter->m_URL =
           reply->attribute(QNetworkRequest::RedirectionTargetAttribute).toString();
       iter->m_Reroute = true;
-      m_RequestQueue.enqueue(*iter);
+      if (iter->isBulk()) {
+        m_BulkQueue.enqueue(*iter);
+      } else {
+        m_RequestQueue.enqueue(*iter);
+      }
       // nextRequest();
       return;
     }
+
+    if (statusCode == 304) {
+      // not modified since it was cached
+      refreshCached(*iter);
+
+      if (!emitCached(*iter)) {
+        emitFailed(*iter, statusCode, tr("invalid response"));
+      }
+
+      m_User.limits(parseLimits(reply));
+      emit requestsChanged(getAPIStats(), m_User);
+      return;
+    }
     QByteArray data = reply->readAll();
     if (data.isNull() || data.isEmpty() || (strcmp(data.constData(), "null") == 0)) {
       QString nexusError(reply->rawHeader("NexusErrorInfo"));
@@ -1145,89 +1373,196 @@ void NexusInterface::requestFinished(std::list<NXMRequestInfo>::iterator iter)
         nexusError = tr("empty response");
       }
       log::debug("nexus error: {}", nexusError);
-      emit nxmRequestFailed(iter->m_GameName, iter->m_ModID, iter->m_FileID,
-                            iter->m_UserData, iter->m_ID, reply->error(), nexusError);
+      emitFailed(*iter, reply->error(), nexusError);
     } else {
       QJsonDocument responseDoc = QJsonDocument::fromJson(data);
       if (!responseDoc.isNull()) {
-        QVariant result = responseDoc.toVariant();
-        switch (iter->m_Type) {
-        case NXMRequestInfo::TYPE_DESCRIPTION: {
-          emit nxmDescriptionAvailable(iter->m_GameName, iter->m_ModID,
-                                       iter->m_UserData, result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_MODINFO: {
-          emit nxmModInfoAvailable(iter->m_GameName, iter->m_ModID, iter->m_UserData,
-                                   result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_CHECKUPDATES: {
-          emit nxmUpdateInfoAvailable(iter->m_GameName, iter->m_UserData, result,
-                                      iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_FILES: {
-          emit nxmFilesAvailable(iter->m_GameName, iter->m_ModID, iter->m_UserData,
-                                 result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_GETUPDATES: {
-          emit nxmUpdatesAvailable(iter->m_GameName, iter->m_ModID, iter->m_UserData,
-                                   result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_FILEINFO: {
-          emit nxmFileInfoAvailable(iter->m_GameName, iter->m_ModID, iter->m_FileID,
-                                    iter->m_UserData, result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_DOWNLOADURL: {
-          emit nxmDownloadURLsAvailable(iter->m_GameName, iter->m_ModID, iter->m_FileID,
-                                        iter->m_UserData, result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_ENDORSEMENTS: {
-          emit nxmEndorsementsAvailable(iter->m_UserData, result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_TOGGLEENDORSEMENT: {
-          emit nxmEndorsementToggled(iter->m_GameName, iter->m_ModID, iter->m_UserData,
-                                     result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_TOGGLETRACKING: {
-          auto results = result.toMap();
-          auto message = results["message"].toString();
-          if (message.contains(
-                  QRegularExpression("User [0-9]+ is already Tracking Mod: [0-9]+")) ||
-              message.contains(
-                  QRegularExpression("User [0-9]+ is now Tracking Mod: [0-9]+"))) {
-            emit nxmTrackingToggled(iter->m_GameName, iter->m_ModID, iter->m_UserData,
-                                    true, iter->m_ID);
-          } else if (message.contains(QRegularExpression(
-                         "User [0-9]+ is no longer tracking [0-9]+")) ||
-                     message.contains(QRegularExpression(
-                         "Users is not tracking mod. Unable to untrack."))) {
-            emit nxmTrackingToggled(iter->m_GameName, iter->m_ModID, iter->m_UserData,
-                                    false, iter->m_ID);
-          }
-        } break;
-        case NXMRequestInfo::TYPE_TRACKEDMODS: {
-          emit nxmTrackedModsAvailable(iter->m_UserData, result, iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_FILEINFO_MD5: {
-          emit nxmFileInfoFromMd5Available(iter->m_GameName, iter->m_UserData, result,
-                                           iter->m_ID);
-        } break;
-        case NXMRequestInfo::TYPE_GAMEINFO: {
-          emit nxmGameInfoAvailable(iter->m_GameName, iter->m_UserData, result,
-                                    iter->m_ID);
-        } break;
-        }
+        emitResult(*iter, responseDoc.toVariant());
+        storeCached(*iter, reply, data);
 
         m_User.limits(parseLimits(reply));
         emit requestsChanged(getAPIStats(), m_User);
       } else {
-        emit nxmRequestFailed(iter->m_GameName, iter->m_ModID, iter->m_FileID,
-                              iter->m_UserData, iter->m_ID, reply->error(),
-                              tr("invalid response"));
+        emitFailed(*iter, reply->error(), tr("invalid response"));
       }
     }
   }
 }
 
+std::vector<NexusInterface::Coalesced>
+NexusInterface::takeCoalesced(const NXMRequestInfo& info)
+{
+  std::vector<Coalesced> v = {{info.m_ID, info.m_UserData}};
+
+  if (!info.m_Key.isEmpty()) {
+    const auto more = m_Coalesced.take(info.m_Key);
+    v.insert(v.end(), more.begin(), more.end());
+  }
+
+  return v;
+}
+
+void NexusInterface::emitResult(const NXMRequestInfo& info, const QVariant& result)
+{
+  if (info.m_Revalidate) {
+    // only refreshes the cache
+    m_Coalesced.remove(info.m_Key);
+    return;
+  }
+
+  for (auto&& [id, userData] : takeCoalesced(info)) {
+    switch (info.m_Type) {
+    case NXMRequestInfo::TYPE_DESCRIPTION: {
+      emit nxmDescriptionAvailable(info.m_GameName, info.m_ModID, userData, result,
+                                   id);
+    } break;
+    case NXMRequestInfo::TYPE_MODINFO: {
+      emit nxmModInfoAvailable(info.m_GameName, info.m_ModID, userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_CHECKUPDATES: {
+      emit nxmUpdateInfoAvailable(info.m_GameName, userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_FILES: {
+      emit nxmFilesAvailable(info.m_GameName, info.m_ModID, userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_GETUPDATES: {
+      emit nxmUpdatesAvailable(info.m_GameName, info.m_ModID, userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_FILEINFO: {
+      emit nxmFileInfoAvailable(info.m_GameName, info.m_ModID, info.m_FileID,
+                                userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_DOWNLOADURL: {
+      emit nxmDownloadURLsAvailable(info.m_GameName, info.m_ModID, info.m_FileID,
+                                    userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_ENDORSEMENTS: {
+      emit nxmEndorsementsAvailable(userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_TOGGLEENDORSEMENT: {
+      emit nxmEndorsementToggled(info.m_GameName, info.m_ModID, userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_TOGGLETRACKING: {
+      auto results = result.toMap();
+      auto message = results["message"].toString();
+      if (message.contains(
+              QRegularExpression("User [0-9]+ is already Tracking Mod: [0-9]+")) ||
+          message.contains(
+              QRegularExpression("User [0-9]+ is now Tracking Mod: [0-9]+"))) {
+        emit nxmTrackingToggled(info.m_GameName, info.m_ModID, userData, true, id);
+      } else if (message.contains(QRegularExpression(
+                     "User [0-9]+ is no longer tracking [0-9]+")) ||
+                 message.contains(QRegularExpression(
+                     "Users is not tracking mod. Unable to untrack."))) {
+        emit nxmTrackingToggled(info.m_GameName, info.m_ModID, userData, false, id);
+      }
+    } break;
+    case NXMRequestInfo::TYPE_TRACKEDMODS: {
+      emit nxmTrackedModsAvailable(userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_FILEINFO_MD5: {
+      emit nxmFileInfoFromMd5Available(info.m_GameName, userData, result, id);
+    } break;
+    case NXMRequestInfo::TYPE_GAMEINFO: {
+      emit nxmGameInfoAvailable(info.m_GameName, userData, result, id);
+    } break;
+    }
+  }
+}
+
+void NexusInterface::emitFailed(const NXMRequestInfo& info, int errorCode,
+                                const QString& errorMessage)
+{
+  if (info.m_Revalidate) {
+    m_Coalesced.remove(info.m_Key);
+    return;
+  }
+
+  for (auto&& [id, userData] : takeCoalesced(info)) {
+    emit nxmRequestFailed(info.m_GameName, info.m_ModID, info.m_FileID, userData, id,
+                          errorCode, errorMessage);
+  }
+}
+
+QUrl NexusInterface::cacheUrl(const NXMRequestInfo& info) const
+{
+  // some responses depend on the user, like endorsements in mod info
+  return QUrl(QString("nexus:%1/%2").arg(m_User.id()).arg(info.key()));
+}
+
+QNetworkCacheMetaData NexusInterface::cachedMetaData(const NXMRequestInfo& info) const
+{
+  if (m_ApiCache == nullptr || m_ApiCache->cacheDirectory().isEmpty() ||
+      !info.isCacheable()) {
+    return {};
+  }
+
+  return m_ApiCache->metaData(cacheUrl(info));
+}
+
+bool NexusInterface::emitCached(const NXMRequestInfo& info)
+{
+  if (!cachedMetaData(info).isValid()) {
+    return false;
+  }
+
+  std::unique_ptr<QIODevice> data(m_ApiCache->data(cacheUrl(info)));
+  if (!data) {
+    return false;
+  }
+
+  const QJsonDocument doc = QJsonDocument::fromJson(data->readAll());
+  if (doc.isNull()) {
+    log::warn("cached nexus response for {} is invalid", info.key());
+    m_ApiCache->remove(cacheUrl(info));
+    return false;
+  }
+
+  emitResult(info, doc.toVariant());
+  return true;
+}
+
+void NexusInterface::storeCached(const NXMRequestInfo& info, const QNetworkReply* reply,
+                                 const QByteArray& data)
+{
+  if (m_ApiCache == nullptr || m_ApiCache->cacheDirectory().isEmpty() ||
+      !info.isCacheable()) {
+    return;
+  }
+
+  QNetworkCacheMetaData::RawHeaderList validators;
+  for (const char* name : {"ETag", "Last-Modified"}) {
+    if (reply->hasRawHeader(name)) {
+      validators.append(qMakePair(QByteArray(name), reply->rawHeader(name)));
+    }
+  }
+
+  QNetworkCacheMetaData md;
+  md.setUrl(cacheUrl(info));
+  md.setSaveToDisk(true);
+  md.setRawHeaders(validators);
+  md.setExpirationDate(QDateTime::currentDateTimeUtc().addSecs(CacheFreshness));
+
+  QIODevice* device = m_ApiCache->prepare(md);
+  if (device == nullptr) {
+    return;
+  }
+
+  device->write(data);
+  m_ApiCache->insert(device);
+}
+
+void NexusInterface::refreshCached(const NXMRequestInfo& info)
+{
+  auto md = cachedMetaData(info);
+  if (!md.isValid()) {
+    return;
+  }
+
+  md.setExpirationDate(QDateTime::currentDateTimeUtc().addSecs(CacheFreshness));
+  m_ApiCache->updateMetaData(md);
+}
+
 void NexusInterface::requestFinished()
 {
   QNetworkReply* reply = static_cast<QNetworkReply*>(sender());
@@ -1282,7 +1617,7 @@ APIUserAccount NexusInterface::getAPIUserAccount() const
 APIStats NexusInterface::getAPIStats() const
 {
   APIStats stats;
-  stats.requestsQueued = m_RequestQueue.size();
+  stats.requestsQueued = m_RequestQueue.size() + m_BulkQueue.size();
 
   return stats;
 }
@@ -1369,3 +1704,52 @@ NexusInterface::NXMRequestInfo::NXMRequestInfo(
       m_NexusGameID(game->nexusGameID()), m_GameName(game->gameNexusName()),
       m_Endorse(false), m_Track(false), m_Hash(hash)
 {}
+
+bool NexusInterface::NXMRequestInfo::isBulk() const
+{
+  return m_Type == TYPE_CHECKUPDATES || m_Type == TYPE_GETUPDATES || m_Revalidate;
+}
+
+bool NexusInterface::NXMRequestInfo::isCacheable() const
+{
+  switch (m_Type) {
+  case TYPE_DESCRIPTION:
+  case TYPE_MODINFO:
+  case TYPE_FILES:
+  case TYPE_FILEINFO:
+  case TYPE_GETUPDATES:
+  case TYPE_CHECKUPDATES:
+  case TYPE_GAMEINFO:
+    return !m_Reroute;
+
+  default:
+    return false;
+  }
+}
+
+QString NexusInterface::NXMRequestInfo::key() const
+{
+  switch (m_Type) {
+  case TYPE_DESCRIPTION:
+  case TYPE_MODINFO:
+  case TYPE_FILES:
+  case TYPE_FILEINFO:
+  case TYPE_ENDORSEMENTS:
+  case TYPE_GETUPDATES:
+  case TYPE_CHECKUPDATES:
+  case TYPE_TRACKEDMODS:
+  case TYPE_FILEINFO_MD5:
+  case TYPE_GAMEINFO:
+    return QString("%1/%2/%3/%4/%5/%6")
+        .arg(m_Type)
+        .arg(m_GameName)
+        .arg(m_ModID)
+        .arg(m_FileID)
+        .arg(m_UpdatePeriod)
+        .arg(QString(m_Hash.toHex()));
+
+  default:
+    // download links depend on the user data, the others change something
+    return {};
+  }
+}
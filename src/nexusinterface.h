@@ -27,6 +27,9 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <utility.h>
 #include <versioninfo.h>
 
+#include <QDeadlineTimer>
+#include <QElapsedTimer>
+#include <QHash>
 #include <QNetworkDiskCache>
 #include <QNetworkReply>
 #include <QQueue>
@@ -35,6 +38,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <list>
 #include <set>
+#include <vector>
 
 namespace MOBase
 {
@@ -660,6 +664,16 @@ private:
     QMap<QNetworkReply::NetworkError, QList<int>> m_AllowedErrors;
     bool m_IgnoreGenericErrorHandler;
 
+    // see key(), set when the request is queued
+    QString m_Key;
+
+    // number of times this request was sent again after being throttled
+    int m_Retries = 0;
+
+    // sent in the background to refresh a cached response that was already
+    // used, nothing is emitted for it
+    bool m_Revalidate = false;
+
     NXMRequestInfo(int modID, Type type, QVariant userData, const QString& subModule,
                    MOBase::IPluginGame const* game);
     NXMRequestInfo(int modID, QString modVersion, Type type, QVariant userData,
@@ -674,23 +688,80 @@ private:
     NXMRequestInfo(QByteArray& hash, Type type, QVariant userData,
                    const QString& subModule, MOBase::IPluginGame const* game);
 
+    // bulk requests are the ones made by update checks, they only run when no
+    // other request is waiting and never use the last requests of the budget
+    //
+    bool isBulk() const;
+
+    // identifies requests that would get the same response, empty for requests
+    // that change something on the server or can't be shared
+    //
+    QString key() const;
+
+    // whether the response can be saved in the api cache, only for requests that
+    // just read data
+    //
+    bool isCacheable() const;
+
   private:
     static QAtomicInt s_NextID;
   };
 
+  // a request that was made while an identical one was queued or running, it
+  // gets the same result under its own id and user data
+  struct Coalesced
+  {
+    int m_ID;
+    QVariant m_UserData;
+  };
+
   static const int MAX_ACTIVE_DOWNLOADS = 6;
 
 private:
+  void enqueue(NXMRequestInfo info, bool useCache = true);
   void nextRequest();
+  void wakeIn(int msecs);
   void requestFinished(std::list<NXMRequestInfo>::iterator iter);
+  std::vector<Coalesced> takeCoalesced(const NXMRequestInfo& info);
+  QUrl cacheUrl(const NXMRequestInfo& info) const;
+  QNetworkCacheMetaData cachedMetaData(const NXMRequestInfo& info) const;
+  bool emitCached(const NXMRequestInfo& info);
+  void storeCached(const NXMRequestInfo& info, const QNetworkReply* reply,
+                   const QByteArray& data);
+  void refreshCached(const NXMRequestInfo& info);
+  void emitResult(const NXMRequestInfo& info, const QVariant& result);
+  void emitFailed(const NXMRequestInfo& info, int errorCode,
+                  const QString& errorMessage);
   MOBase::IPluginGame* getGame(QString gameName) const;
   QString getOldModsURL(QString gameName) const;
 
 private:
   QNetworkDiskCache* m_DiskCache;
+
+  // responses to api requests with their validators, see
+  // NXMRequestInfo::isCacheable()
+  QNetworkDiskCache* m_ApiCache;
   NXMAccessManager* m_AccessManager;
   std::list<NXMRequestInfo> m_ActiveRequest;
   QQueue<NXMRequestInfo> m_RequestQueue;
+  QQueue<NXMRequestInfo> m_BulkQueue;
+
+  // requests waiting for the result of a queued or running one, by key; every
+  // queued or running request that has a key has an entry, even if it's empty
+  QHash<QString, std::vector<Coalesced>> m_Coalesced;
+
+  // calls nextRequest() for requests that had to wait: bulk requests being
+  // paced or held back, or everything while waiting after being throttled
+  QTimer m_WakeTimer;
+  QDeadlineTimer m_Backoff;
+  bool m_WaitingForReset = false;
+
+  // bulk requests that are held back to keep the last requests of the budget
+  // are still tried once after every reset, the limits only change with
+  // responses
+  QElapsedTimer m_LastBulk;
+  QDeadlineTimer m_BulkProbe;
+  bool m_BulkHeld = false;
   MOBase::VersionInfo m_MOVersion;
   PluginContainer* m_PluginContainer;
   APIUserAccount m_User;
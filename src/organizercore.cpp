@@ -1,5 +1,6 @@
 #include "organizercore.h"
 #include "categoriesdialog.h"
+#include "conflictgraph.h"
 #include "credentialsdialog.h"
 #include "delayedfilewriter.h"
 #include "directoryrefresher.h"
@@ -7,6 +8,8 @@
 #include "envfs.h"
 #include "envmodule.h"
 #include "filedialogmemory.h"
+#include "filequery.h"
+#include "filesearchindex.h"
 #include "guessedvalue.h"
 #include "imodinterface.h"
 #include "imoinfo.h"
@@ -28,6 +31,7 @@
 #include "shared/util.h"
 #include "spawn.h"
 #include "syncoverwritedialog.h"
+#include "thread_utils.h"
 #include "virtualfiletree.h"
 #include <dataarchives.h>
 #include <ipluginmodpage.h>
@@ -97,6 +101,10 @@ OrganizerCore::OrganizerCore(Settings& settings)
       m_VirtualFileTree([this]() {
         return VirtualFileTree::makeTree(m_DirectoryStructure);
       }),
+      m_ConflictGraph([this]() {
+        return std::make_shared<const ConflictGraph>(
+            ConflictGraph::build(*m_DirectoryStructure));
+      }),
       m_DownloadManager(&NexusInterface::instance(), this), m_DirectoryUpdate(false),
       m_ArchivesInit(false),
       m_PluginListsWriter(std::bind(&OrganizerCore::savePluginList, this))
@@ -117,6 +125,7 @@ OrganizerCore::OrganizerCore(Settings& settings)
   connect(&m_ModList, SIGNAL(removeOrigin(QString)), this, SLOT(removeOrigin(QString)));
   connect(&m_ModList, &ModList::modStatesChanged, [=] {
     currentProfile()->writeModlist();
+    invalidateFileMapping();
   });
   connect(&m_ModList, &ModList::modPrioritiesChanged, [this](auto&& indexes) {
     modPrioritiesChanged(indexes);
@@ -570,6 +579,7 @@ void OrganizerCore::setCurrentProfile(const QString& profileName)
   auto oldProfile = std::move(m_CurrentProfile);
 
   m_CurrentProfile = std::make_unique<Profile>(QDir(profileDir), managedGame());
+  invalidateFileMapping();
 
   m_ModList.setProfile(m_CurrentProfile.get());
 
@@ -905,15 +915,38 @@ QString OrganizerCore::resolvePath(const QString& fileName) const
   if (m_DirectoryStructure == nullptr) {
     return QString();
   }
-  const FileEntryPtr file =
-      m_DirectoryStructure->searchFile(ToWString(fileName), nullptr);
-  if (file.get() != nullptr) {
+
+  const FileEntry* file = fileQuery()->find(fileName.toStdWString());
+  if (file != nullptr) {
     return ToQString(file->getFullPath());
   } else {
     return QString();
   }
 }
 
+QStringList OrganizerCore::resolvePaths(const QStringList& fileNames) const
+{
+  QStringList result;
+
+  if (m_DirectoryStructure == nullptr) {
+    for (int i = 0; i < fileNames.size(); ++i) {
+      result.append(QString());
+    }
+
+    return result;
+  }
+
+  const auto query = fileQuery();
+  result.reserve(fileNames.size());
+
+  for (auto&& fileName : fileNames) {
+    const FileEntry* file = query->find(fileName.toStdWString());
+    result.append(file != nullptr ? ToQString(file->getFullPath()) : QString());
+  }
+
+  return result;
+}
+
 QStringList OrganizerCore::listDirectories(const QString& directoryName) const
 {
   QStringList result;
@@ -937,12 +970,27 @@ OrganizerCore::findFiles(const QString& path,
   if (!path.isEmpty() && path != ".")
     dir = dir->findSubDirectoryRecursive(ToWString(path));
   if (dir != nullptr) {
-    std::vector<FileEntryPtr> files = dir->getFiles();
-    for (FileEntryPtr& file : files) {
-      QString fullPath = ToQString(file->getFullPath());
-      if (filter(ToQString(file->getName()))) {
-        result.append(fullPath);
+    // the full path is only built for files that pass the filter
+    dir->forEachFile([&](FileEntry& file) {
+      if (filter(ToQString(file.getName()))) {
+        result.append(ToQString(file.getFullPath()));
       }
+      return true;
+    });
+  }
+  return result;
+}
+
+QStringList OrganizerCore::findFiles(const QString& path,
+                                     const QStringList& globFilters) const
+{
+  QStringList result;
+  DirectoryEntry* dir = m_DirectoryStructure;
+  if (!path.isEmpty() && path != ".")
+    dir = dir->findSubDirectoryRecursive(ToWString(path));
+  if (dir != nullptr) {
+    for (const FileEntry* file : fileQuery()->match(*dir, globFilters)) {
+      result.append(ToQString(file->getFullPath()));
     }
   }
   return result;
@@ -951,10 +999,9 @@ OrganizerCore::findFiles(const QString& path,
 QStringList OrganizerCore::getFileOrigins(const QString& fileName) const
 {
   QStringList result;
-  const FileEntryPtr file =
-      m_DirectoryStructure->searchFile(ToWString(fileName), nullptr);
+  const FileEntry* file = fileQuery()->find(fileName.toStdWString());
 
-  if (file.get() != nullptr) {
+  if (file != nullptr) {
     result.append(
         ToQString(m_DirectoryStructure->getOriginByID(file->getOrigin()).getName()));
     foreach (const auto& i, file->getAlternatives()) {
@@ -974,15 +1021,14 @@ QList<MOBase::IOrganizer::FileInfo> OrganizerCore::findFileInfos(
   if (!path.isEmpty() && path != ".")
     dir = dir->findSubDirectoryRecursive(ToWString(path));
   if (dir != nullptr) {
-    std::vector<FileEntryPtr> files = dir->getFiles();
-    for (FileEntryPtr file : files) {
+    dir->forEachFile([&](FileEntry& file) {
       IOrganizer::FileInfo info;
-      info.filePath    = ToQString(file->getFullPath());
+      info.filePath    = ToQString(file.getFullPath());
       bool fromArchive = false;
       info.origins.append(ToQString(
-          m_DirectoryStructure->getOriginByID(file->getOrigin(fromArchive)).getName()));
-      info.archive = fromArchive ? ToQString(file->getArchive().name()) : "";
-      for (const auto& idx : file->getAlternatives()) {
+          m_DirectoryStructure->getOriginByID(file.getOrigin(fromArchive)).getName()));
+      info.archive = fromArchive ? ToQString(file.getArchive().name()) : "";
+      for (const auto& idx : file.getAlternatives()) {
         info.origins.append(
             ToQString(m_DirectoryStructure->getOriginByID(idx.originID()).getName()));
       }
@@ -990,7 +1036,8 @@ QList<MOBase::IOrganizer::FileInfo> OrganizerCore::findFileInfos(
       if (filter(info)) {
         result.append(info);
       }
-    }
+      return true;
+    });
   }
   return result;
 }
@@ -1379,6 +1426,7 @@ void OrganizerCore::updateModsInDirectoryStructure(
   }
 
   m_DirectoryRefresher->addMultipleModsFilesToStructure(m_DirectoryStructure, entries);
+  invalidateFileMapping();
 
   DirectoryRefresher::cleanStructure(m_DirectoryStructure);
   // need to refresh plugin list now so we can activate esps
@@ -1406,6 +1454,8 @@ void OrganizerCore::updateModsInDirectoryStructure(
         m_CurrentProfile->getModPriority(idx), modInfo[idx]->absolutePath(),
         modInfo[idx]->archives());
   }
+
+  m_DirectoryStructure->freeze();
 }
 
 void OrganizerCore::loggedInAction(QWidget* parent, std::function<void()> f)
@@ -1544,16 +1594,35 @@ void OrganizerCore::onDirectoryRefreshed()
 
   std::swap(m_DirectoryStructure, newStructure);
   m_VirtualFileTree.invalidate();
+  m_ConflictGraph.invalidate();
+  m_SearchIndex = m_DirectoryRefresher->stealSearchIndex();
 
-  if (m_StructureDeleter.joinable()) {
-    m_StructureDeleter.join();
+  {
+    std::scoped_lock lock(m_FileQueryMutex);
+    m_FileQuery = m_DirectoryRefresher->stealFileQuery();
   }
 
-  m_StructureDeleter = MOShared::startSafeThread([=] {
-    log::debug("structure deleter thread start");
-    delete newStructure;
-    log::debug("structure deleter thread done");
-  });
+  invalidateFileMapping();
+
+  if (m_Settings.incrementalRefresh()) {
+    // the next refresh will update the old structure instead of building a new
+    // one, it will also delete it if that's not possible, like when it was built
+    // with other archives or load order; a structure that was recycled before
+    // and never picked up is given back
+    newStructure = m_DirectoryRefresher->recycleDirectoryStructure(newStructure);
+  }
+
+  if (newStructure != nullptr) {
+    if (m_StructureDeleter.joinable()) {
+      m_StructureDeleter.join();
+    }
+
+    m_StructureDeleter = MOShared::startSafeThread([=] {
+      log::debug("structure deleter thread start");
+      delete newStructure;
+      log::debug("structure deleter thread done");
+    });
+  }
 
   log::debug("clearing caches");
   for (int i = 0; i < m_ModList.rowCount(); ++i) {
@@ -1578,36 +1647,73 @@ void OrganizerCore::onDirectoryRefreshed()
   log::debug("refresh done");
 }
 
+std::shared_ptr<const ConflictGraph> OrganizerCore::conflictGraph() const
+{
+  return m_ConflictGraph.value();
+}
+
+std::shared_ptr<const FileQuery> OrganizerCore::fileQuery() const
+{
+  {
+    std::scoped_lock lock(m_FileQueryMutex);
+
+    // mods can be added to the structure without a refresh
+    if (m_FileQuery && m_FileQuery->current(*m_DirectoryStructure)) {
+      return m_FileQuery;
+    }
+  }
+
+  return std::make_shared<const FileQuery>(FileQuery::unindexed(*m_DirectoryStructure));
+}
+
+std::shared_ptr<const FileSearchIndex> OrganizerCore::searchIndex()
+{
+  if (!m_SearchIndex || !m_SearchIndex->current(*m_DirectoryStructure)) {
+    m_SearchIndex = std::make_shared<const FileSearchIndex>(
+        FileSearchIndex::build(*m_DirectoryStructure));
+  }
+
+  return m_SearchIndex;
+}
+
 void OrganizerCore::clearCaches(std::vector<unsigned int> const& indices) const
 {
   const auto insert = [](auto& dest, const auto& from) {
     dest.insert(from.begin(), from.end());
   };
+  const auto insertConflicts = [&](auto& dest, const ModInfo::Ptr& modInfo) {
+    insert(dest, modInfo->getModOverwrite());
+    insert(dest, modInfo->getModOverwritten());
+    insert(dest, modInfo->getModArchiveOverwrite());
+    insert(dest, modInfo->getModArchiveOverwritten());
+    insert(dest, modInfo->getModArchiveLooseOverwrite());
+    insert(dest, modInfo->getModArchiveLooseOverwritten());
+  };
+
   std::set<unsigned int> allIndices;
+
+  // if the mod is disabled, we need to first fetch the conflicting mods, and
+  // then clear the cache
   for (const auto index : indices) {
-    ModInfo::Ptr modInfo = ModInfo::getByIndex(index);
+    if (!m_CurrentProfile->modEnabled(index)) {
+      insertConflicts(allIndices, ModInfo::getByIndex(index));
+    }
+  }
+
+  // the conflict graph is rebuilt once for all the mods instead of once per
+  // enabled mod
+  m_ConflictGraph.invalidate();
+
+  for (const auto index : indices) {
+    ModInfo::getByIndex(index)->clearCaches();
+  }
 
+  // if the mod is enabled, its cache had to be cleared first so that
+  // getModOverwrite(), ..., returns the newly conflicting mods (in case the mod
+  // just got enabled)
+  for (const auto index : indices) {
     if (m_CurrentProfile->modEnabled(index)) {
-      // if the mod is enabled, we need to first clear its cache so that
-      // getModOverwrite(), ..., returns the newly conflicting mods (in case
-      // the mod just got enabled)
-      modInfo->clearCaches();
-      insert(allIndices, modInfo->getModOverwrite());
-      insert(allIndices, modInfo->getModOverwritten());
-      insert(allIndices, modInfo->getModArchiveOverwrite());
-      insert(allIndices, modInfo->getModArchiveOverwritten());
-      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
-      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
-    } else {
-      // if the mod is disabled, we need to first fetch the conflicting
-      // mods, and then clear the cache
-      insert(allIndices, modInfo->getModOverwrite());
-      insert(allIndices, modInfo->getModOverwritten());
-      insert(allIndices, modInfo->getModArchiveOverwrite());
-      insert(allIndices, modInfo->getModArchiveOverwritten());
-      insert(allIndices, modInfo->getModArchiveLooseOverwrite());
-      insert(allIndices, modInfo->getModArchiveLooseOverwritten());
-      modInfo->clearCaches();
+      insertConflicts(allIndices, ModInfo::getByIndex(index));
     }
   }
 
@@ -1631,6 +1737,7 @@ void OrganizerCore::modPrioritiesChanged(const QModelIndexList& indices)
   refreshBSAList();
   currentProfile()->writeModlist();
   directoryStructure()->getFileRegister()->sortOrigins();
+  invalidateFileMapping();
 
   std::vector<unsigned int> vindices;
 
@@ -1670,6 +1777,7 @@ void OrganizerCore::modStatusChanged(unsigned int index)
       }
     }
     m_DirectoryStructure->getFileRegister()->sortOrigins();
+    invalidateFileMapping();
 
     refreshLists();
     clearCaches({index});
@@ -1722,6 +1830,7 @@ void OrganizerCore::modStatusChanged(QList<unsigned int> index)
       }
     }
     m_DirectoryStructure->getFileRegister()->sortOrigins();
+    invalidateFileMapping();
 
     refreshLists();
     clearCaches(vindices);
@@ -1998,8 +2107,58 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
     loop.exec();
   }
 
+  MappingType result;
+
+  if (m_CurrentProfile != nullptr && profileName == m_CurrentProfile->name()) {
+    // only the mappings from plugins are built for every launch, they can
+    // change at any time; other profiles are loaded from disk and never cached
+    const QString key = QString("%1|%2|%3")
+                            .arg(profileName)
+                            .arg(customOverwrite)
+                            .arg(m_CurrentProfile->localSavesEnabled());
+
+    if (m_CachedMapping.m_Key != key ||
+        m_CachedMapping.m_Generation != m_MappingGeneration) {
+      m_CachedMapping.m_Mapping    = modMapping(profileName, customOverwrite);
+      m_CachedMapping.m_Key        = key;
+      m_CachedMapping.m_Generation = m_MappingGeneration;
+    }
+
+    result = m_CachedMapping.m_Mapping;
+  } else {
+    result = modMapping(profileName, customOverwrite);
+  }
+
+  for (MOBase::IPluginFileMapper* mapper :
+       m_PluginContainer->plugins<MOBase::IPluginFileMapper>()) {
+    IPlugin* plugin = dynamic_cast<IPlugin*>(mapper);
+    if (m_PluginContainer->isEnabled(plugin)) {
+      MappingType pluginMap = mapper->mappings();
+      result.reserve(result.size() + pluginMap.size());
+      result.insert(result.end(), pluginMap.begin(), pluginMap.end());
+    }
+  }
+
+
+  checkLinkedDirectories(result);
+  return result;
+}
+
+MappingType OrganizerCore::modMapping(const QString& profileName,
+                                      const QString& customOverwrite)
+{
   IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
-  Profile profile(QDir(m_Settings.paths().profiles() + "/" + profileName), game);
+
+  // the current profile has already been saved, it's only loaded from disk for
+  // other profiles
+  std::unique_ptr<Profile> otherProfile;
+  Profile* profile = m_CurrentProfile.get();
+
+  if (profile == nullptr || profile->name() != profileName) {
+    otherProfile = std::make_unique<Profile>(
+        QDir(m_Settings.paths().profiles() + "/" + profileName), game);
+    profile = otherProfile.get();
+  }
 
   MappingType result;
 
@@ -2012,7 +2171,7 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
 
   bool overwriteActive = false;
 
-  for (const auto& mod : profile.getActiveMods()) {
+  for (const auto& mod : profile->getActiveMods()) {
     if (std::get<0>(mod).compare("overwrite", Qt::CaseInsensitive) == 0) {
       continue;
     }
@@ -2025,9 +2184,9 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
     overwriteActive |= createTarget;
 
     if (modPtr->isRegular()) {
-      for (auto dataPath : dataPaths) {
-        result.insert(result.end(), {QDir::toNativeSeparators(std::get<1>(mod)),
-                                     dataPath, true, createTarget});
+      const QString source = QDir::toNativeSeparators(std::get<1>(mod));
+      for (const auto& dataPath : dataPaths) {
+        result.push_back({source, dataPath, true, createTarget});
       }
     }
   }
@@ -2049,23 +2208,57 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& profileName,
     }
   }
 
-  for (auto dataPath : dataPaths) {
-    result.insert(result.end(),
-                  {QDir::toNativeSeparators(m_Settings.paths().overwrite()), dataPath,
-                   true, customOverwrite.isEmpty()});
+  const QString overwrite = QDir::toNativeSeparators(m_Settings.paths().overwrite());
+  for (const auto& dataPath : dataPaths) {
+    result.push_back({overwrite, dataPath, true, customOverwrite.isEmpty()});
   }
 
-  for (MOBase::IPluginFileMapper* mapper :
-       m_PluginContainer->plugins<MOBase::IPluginFileMapper>()) {
-    IPlugin* plugin = dynamic_cast<IPlugin*>(mapper);
-    if (m_PluginContainer->isEnabled(plugin)) {
-      MappingType pluginMap = mapper->mappings();
-      result.reserve(result.size() + pluginMap.size());
-      result.insert(result.end(), pluginMap.begin(), pluginMap.end());
+  return result;
+}
+
+void OrganizerCore::invalidateFileMapping()
+{
+  ++m_MappingGeneration;
+}
+
+void OrganizerCore::checkLinkedDirectories(const MappingType& mapping)
+{
+  // mods are usually mapped once for every data directory
+  std::map<QString, OriginFingerprint> fingerprints;
+  for (const auto& map : mapping) {
+    if (map.isDirectory) {
+      fingerprints.emplace(map.source, OriginFingerprint());
     }
   }
 
-  return result;
+  std::vector<std::pair<const QString, OriginFingerprint>*> dirs;
+  for (auto& p : fingerprints) {
+    dirs.push_back(&p);
+  }
+
+  parallelMap(
+      dirs.begin(), dirs.end(),
+      [](auto* p) {
+        const auto path = QDir::toNativeSeparators(p->first).toStdWString();
+        p->second       = DirectoryRefresher::fingerprintOf(path);
+      },
+      m_Settings.refreshThreadCount());
+
+  // directories are linked recursively with everything they contain at that
+  // time, they have to be linked again if anything changed since, including
+  // what programs wrote through the vfs
+  for (const auto& [source, fp] : fingerprints) {
+    auto itor = m_LinkedFingerprints.find(source);
+
+    if (itor != m_LinkedFingerprints.end() && itor->second != fp) {
+      log::debug("'{}' has changed since it was linked", source);
+      m_USVFS.invalidateMapping();
+      break;
+    }
+  }
+
+  // directories that aren't mapped anymore are forgotten
+  m_LinkedFingerprints = std::move(fingerprints);
 }
 
 std::vector<Mapping> OrganizerCore::fileMapping(const QString& dataPath,
@@ -2075,7 +2268,15 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& dataPath,
                                                 int createDestination)
 {
   std::vector<Mapping> result;
+  fileMapping(dataPath, relPath, base, directoryEntry, createDestination, result);
+  return result;
+}
 
+void OrganizerCore::fileMapping(const QString& dataPath, const QString& relPath,
+                                const DirectoryEntry* base,
+                                const DirectoryEntry* directoryEntry,
+                                int createDestination, std::vector<Mapping>& result)
+{
   for (FileEntryPtr current : directoryEntry->getFiles()) {
     bool isArchive = false;
     int origin     = current->getOrigin(isArchive);
@@ -2105,9 +2306,7 @@ std::vector<Mapping> OrganizerCore::fileMapping(const QString& dataPath,
     bool writeDestination = (base == directoryEntry) && (origin == createDestination);
 
     result.push_back({source, target, true, writeDestination});
-    std::vector<Mapping> subRes =
-        fileMapping(dataPath, relPath + dirName + "\\", base, d, createDestination);
-    result.insert(result.end(), subRes.begin(), subRes.end());
+    fileMapping(dataPath, relPath + dirName + "\\", base, d, createDestination,
+                result);
   }
-  return result;
 }
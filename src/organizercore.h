@@ -16,6 +16,7 @@
 #include "processrunner.h"
 #include "selfupdater.h"
 #include "settings.h"
+#include "shared/fileregisterfwd.h"
 #include "uilocker.h"
 #include "usvfsconnector.h"
 #include <boost/signals2.hpp>
@@ -35,12 +36,18 @@
 #include <QThread>
 #include <QVariant>
 
+#include <map>
+#include <mutex>
+
 class ModListSortProxy;
 class PluginListSortProxy;
 class Profile;
 class IUserInterface;
 class PluginContainer;
 class DirectoryRefresher;
+class ConflictGraph;
+class FileQuery;
+class FileSearchIndex;
 
 namespace MOBase
 {
@@ -258,6 +265,23 @@ public:
   InstallationManager* installationManager();
   MOShared::DirectoryEntry* directoryStructure() { return m_DirectoryStructure; }
   DirectoryRefresher* directoryRefresher() { return m_DirectoryRefresher.get(); }
+
+  // conflicts between all the mods in the current structure, built on the first
+  // call after the structure has changed
+  //
+  std::shared_ptr<const ConflictGraph> conflictGraph() const;
+
+  // index of the files in the current structure, built by the refresher; if
+  // files have been added or removed since, queries walk the structure until
+  // the next refresh instead of rebuilding the index here
+  //
+  std::shared_ptr<const FileQuery> fileQuery() const;
+
+  // names of all the files in the current structure, built by the refresher;
+  // rebuilt here if files have been added or removed since
+  //
+  std::shared_ptr<const FileSearchIndex> searchIndex();
+
   ExecutablesList* executablesList() { return &m_ExecutablesList; }
   void setExecutablesList(const ExecutablesList& executablesList)
   {
@@ -370,9 +394,15 @@ public:
                                             ModInfo::Ptr currentMod,
                                             const QString& initModName);
   QString resolvePath(const QString& fileName) const;
+
+  // same as resolvePath() for every path, with one lookup of the index
+  //
+  QStringList resolvePaths(const QStringList& fileNames) const;
+
   QStringList listDirectories(const QString& directoryName) const;
   QStringList findFiles(const QString& path,
                         const std::function<bool(const QString&)>& filter) const;
+  QStringList findFiles(const QString& path, const QStringList& globFilters) const;
   QStringList getFileOrigins(const QString& fileName) const;
   QList<MOBase::IOrganizer::FileInfo> findFileInfos(
       const QString& path,
@@ -506,6 +536,26 @@ private:
                                    const MOShared::DirectoryEntry* directoryEntry,
                                    int createDestination);
 
+  void fileMapping(const QString& dataPath, const QString& relPath,
+                   const MOShared::DirectoryEntry* base,
+                   const MOShared::DirectoryEntry* directoryEntry,
+                   int createDestination, std::vector<Mapping>& result);
+
+  // mappings of the active mods, the local saves and overwrite, without the
+  // ones from plugins
+  //
+  MappingType modMapping(const QString& profileName, const QString& customOverwrite);
+
+  // the mod list, the profile or the directory structure have changed, the
+  // next launch builds the mappings again
+  //
+  void invalidateFileMapping();
+
+  // walks all the directories in the given mappings and links everything again
+  // if one of them has changed since the last time it was linked
+  //
+  void checkLinkedDirectories(const MappingType& mapping);
+
 private slots:
 
   void onDirectoryRefreshed();
@@ -558,6 +608,13 @@ private:
   std::unique_ptr<DirectoryRefresher> m_DirectoryRefresher;
   MOShared::DirectoryEntry* m_DirectoryStructure;
   MOBase::MemoizedLocked<std::shared_ptr<const MOBase::IFileTree>> m_VirtualFileTree;
+  mutable MOBase::MemoizedLocked<std::shared_ptr<const ConflictGraph>> m_ConflictGraph;
+
+  // plugins can query files from other threads
+  std::shared_ptr<const FileQuery> m_FileQuery;
+  mutable std::mutex m_FileQueryMutex;
+
+  std::shared_ptr<const FileSearchIndex> m_SearchIndex;
 
   DownloadManager m_DownloadManager;
   InstallationManager m_InstallationManager;
@@ -567,6 +624,22 @@ private:
   std::thread m_StructureDeleter;
 
   std::atomic<bool> m_DirectoryUpdate;
+
+  // result of modMapping() for the last launch, reused as long as the key and
+  // the generation are the same, see invalidateFileMapping()
+  struct CachedMapping
+  {
+    QString m_Key;
+    unsigned int m_Generation = 0;
+    MappingType m_Mapping;
+  };
+
+  CachedMapping m_CachedMapping;
+  unsigned int m_MappingGeneration = 1;
+
+  // fingerprints of the directories linked by the last launch, see
+  // checkLinkedDirectories()
+  std::map<QString, MOShared::OriginFingerprint> m_LinkedFingerprints;
   bool m_ArchivesInit;
 
   MOBase::DelayedFileWriter m_PluginListsWriter;
@@ -1,7 +1,6 @@
 #include "organizerproxy.h"
 
 #include "downloadmanagerproxy.h"
-#include "glob_matching.h"
 #include "modlistproxy.h"
 #include "organizercore.h"
 #include "plugincontainer.h"
@@ -249,6 +248,11 @@ QString OrganizerProxy::resolvePath(const QString& fileName) const
   return m_Proxied->resolvePath(fileName);
 }
 
+QStringList OrganizerProxy::resolvePaths(const QStringList& fileNames) const
+{
+  return m_Proxied->resolvePaths(fileNames);
+}
+
 QStringList OrganizerProxy::listDirectories(const QString& directoryName) const
 {
   return m_Proxied->listDirectories(directoryName);
@@ -264,18 +268,7 @@ OrganizerProxy::findFiles(const QString& path,
 QStringList OrganizerProxy::findFiles(const QString& path,
                                       const QStringList& globFilters) const
 {
-  QList<GlobPattern<QChar>> patterns;
-  for (auto& gfilter : globFilters) {
-    patterns.append(GlobPattern(gfilter));
-  }
-  return findFiles(path, [&patterns](const QString& filename) {
-    for (auto& p : patterns) {
-      if (p.match(filename)) {
-        return true;
-      }
-    }
-    return false;
-  });
+  return m_Proxied->findFiles(path, globFilters);
 }
 
 QStringList OrganizerProxy::getFileOrigins(const QString& fileName) const
@@ -47,6 +47,7 @@ public:  // IOrganizer interface
   virtual MOBase::IModInterface* installMod(const QString& fileName,
                                             const QString& nameSuggestion = QString());
   virtual QString resolvePath(const QString& fileName) const;
+  QStringList resolvePaths(const QStringList& fileNames) const;
   virtual QStringList listDirectories(const QString& directoryName) const;
   virtual QStringList
   findFiles(const QString& path,
@@ -0,0 +1,55 @@
+#include "pluginarchives.h"
+#include "shared/fileentry.h"
+#include <utility.h>
+
+#include <algorithm>
+
+using namespace MOBase;
+using namespace MOShared;
+
+// whether the file is a .bsa or .ba2, checked before converting the name so
+// most files in the data directory are skipped cheaply
+//
+static bool isArchive(const std::wstring& name)
+{
+  if (name.size() < 4) {
+    return false;
+  }
+
+  const wchar_t* ext = name.c_str() + name.size() - 4;
+  return (_wcsicmp(ext, L".bsa") == 0 || _wcsicmp(ext, L".ba2") == 0);
+}
+
+PluginArchives::PluginArchives(const std::vector<FileEntryPtr>& files)
+{
+  for (auto&& file : files) {
+    if (!file || !isArchive(file->getName())) {
+      continue;
+    }
+
+    QString name = ToQString(file->getName());
+    m_Archives.push_back({name.toCaseFolded(), std::move(name)});
+  }
+
+  std::sort(m_Archives.begin(), m_Archives.end(), [](auto&& a, auto&& b) {
+    return a.key < b.key;
+  });
+}
+
+std::set<QString> PluginArchives::forPlugin(const QString& baseName) const
+{
+  const QString key = baseName.toCaseFolded();
+
+  auto itor = std::lower_bound(m_Archives.begin(), m_Archives.end(), key,
+                               [](auto&& a, auto&& k) {
+                                 return a.key < k;
+                               });
+
+  std::set<QString> v;
+
+  for (; itor != m_Archives.end() && itor->key.startsWith(key); ++itor) {
+    v.insert(itor->name);
+  }
+
+  return v;
+}
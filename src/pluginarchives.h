@@ -0,0 +1,42 @@
+#ifndef PLUGINARCHIVES_H
+#define PLUGINARCHIVES_H
+
+#include "shared/fileregisterfwd.h"
+#include <QString>
+
+#include <set>
+#include <vector>
+
+// the .bsa and .ba2 files of a data directory, used to find which archives are
+// loaded by a plugin: those with a name that starts with the plugin's name
+// without its extension, such as "Plugin - Textures.bsa" for "Plugin.esp"
+//
+// archives are sorted by case-folded name so the archives of a plugin are a
+// contiguous range that's found with a binary search instead of going through
+// every file for every plugin
+//
+class PluginArchives
+{
+public:
+  // picks the archives from the given files, other files are ignored
+  //
+  explicit PluginArchives(const std::vector<MOShared::FileEntryPtr>& files);
+
+  // names of the archives starting with the given name, case-insensitive
+  //
+  std::set<QString> forPlugin(const QString& baseName) const;
+
+  std::size_t size() const { return m_Archives.size(); }
+
+private:
+  struct Archive
+  {
+    QString key;
+    QString name;
+  };
+
+  // sorted by key
+  std::vector<Archive> m_Archives;
+};
+
+#endif  // PLUGINARCHIVES_H
@@ -0,0 +1,201 @@
+#include "pluginheadercache.h"
+#include <espfile.h>
+#include <log.h>
+#include <utility.h>
+
+#include <QDataStream>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+
+#include <Windows.h>
+
+using namespace MOBase;
+
+// "MOPH", changes to the format must bump the version
+static constexpr quint32 CacheMagic   = 0x4D4F5048;
+static constexpr quint32 CacheVersion = 1;
+
+static QDataStream& operator<<(QDataStream& s, const PluginHeader& h)
+{
+  return s << h.isMaster << h.isOverlay << h.isLight << h.isLightWithOverlays
+           << h.isDummy << h.author << h.description << h.masters;
+}
+
+static QDataStream& operator>>(QDataStream& s, PluginHeader& h)
+{
+  return s >> h.isMaster >> h.isOverlay >> h.isLight >> h.isLightWithOverlays >>
+         h.isDummy >> h.author >> h.description >> h.masters;
+}
+
+PluginHeader PluginHeader::read(const QString& fullPath)
+{
+  ESP::File file(ToWString(fullPath));
+
+  PluginHeader h;
+
+  h.isMaster            = file.isMaster();
+  h.isOverlay           = file.isOverlay();
+  h.isLight             = file.isLight(false);
+  h.isLightWithOverlays = file.isLight(true);
+  h.isDummy             = file.isDummy();
+
+  h.author      = QString::fromLatin1(file.author().c_str());
+  h.description = QString::fromLatin1(file.description().c_str());
+
+  for (auto&& m : file.masters()) {
+    h.masters.append(QString::fromStdString(m));
+  }
+
+  return h;
+}
+
+void PluginHeaderCache::setPath(const QString& path)
+{
+  std::scoped_lock lock(m_Mutex);
+
+  if (path != m_Path) {
+    m_Path    = path;
+    m_Loaded  = false;
+    m_Changed = false;
+    m_Entries.clear();
+  }
+}
+
+std::optional<PluginHeader> PluginHeaderCache::get(const QString& fullPath)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data = {};
+  const bool found               = ::GetFileAttributesExW(
+      ToWString(fullPath).c_str(), GetFileExInfoStandard, &data);
+
+  const quint64 size =
+      (static_cast<quint64>(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+  const quint64 time =
+      (static_cast<quint64>(data.ftLastWriteTime.dwHighDateTime) << 32) |
+      data.ftLastWriteTime.dwLowDateTime;
+
+  const QString key = fullPath.toLower();
+
+  // plugins that can't be stat'ed are parsed every time, ESP::File will most
+  // likely fail on them anyway
+  if (found) {
+    std::scoped_lock lock(m_Mutex);
+
+    if (!m_Loaded) {
+      load();
+    }
+
+    auto itor = m_Entries.find(key);
+    if (itor != m_Entries.end() && itor->size == size && itor->time == time) {
+      itor->used = true;
+      return itor->header;
+    }
+  }
+
+  // parsing is done without the lock so other threads can keep going
+  PluginHeader header;
+
+  try {
+    header = PluginHeader::read(fullPath);
+  } catch (const std::exception& e) {
+    log::error("failed to parse plugin file {}: {}", fullPath, e.what());
+    return {};
+  }
+
+  if (found) {
+    std::scoped_lock lock(m_Mutex);
+    m_Entries.insert(key, Entry{fullPath, size, time, header, true});
+    m_Changed = true;
+  }
+
+  return header;
+}
+
+void PluginHeaderCache::save(bool prune)
+{
+  std::scoped_lock lock(m_Mutex);
+
+  if (!m_Loaded || m_Path.isEmpty()) {
+    return;
+  }
+
+  // plugins that weren't part of the last refresh are usually in mods that are
+  // disabled and will come back, so they're only dropped when they're gone
+  for (auto itor = m_Entries.begin(); prune && itor != m_Entries.end();) {
+    if (!itor->used && !QFileInfo::exists(itor->path)) {
+      itor      = m_Entries.erase(itor);
+      m_Changed = true;
+    } else {
+      itor->used = false;
+      ++itor;
+    }
+  }
+
+  if (!m_Changed) {
+    return;
+  }
+
+  QSaveFile file(m_Path);
+  if (!file.open(QIODevice::WriteOnly)) {
+    log::error("failed to save plugin header cache to {}: {}", m_Path,
+               file.errorString());
+    return;
+  }
+
+  QDataStream out(&file);
+  out.setVersion(QDataStream::Qt_5_15);
+
+  out << CacheMagic << CacheVersion << static_cast<quint32>(m_Entries.size());
+
+  for (auto&& e : m_Entries) {
+    out << e.path << e.size << e.time << e.header;
+  }
+
+  if (!file.commit()) {
+    log::error("failed to save plugin header cache to {}: {}", m_Path,
+               file.errorString());
+    return;
+  }
+
+  m_Changed = false;
+}
+
+void PluginHeaderCache::load()
+{
+  m_Loaded = true;
+  m_Entries.clear();
+
+  if (m_Path.isEmpty()) {
+    return;
+  }
+
+  QFile file(m_Path);
+  if (!file.open(QIODevice::ReadOnly)) {
+    // not necessarily a problem, the file may just not exist (yet)
+    return;
+  }
+
+  QDataStream in(&file);
+  in.setVersion(QDataStream::Qt_5_15);
+
+  quint32 magic = 0, version = 0, count = 0;
+  in >> magic >> version >> count;
+
+  if (magic != CacheMagic || version != CacheVersion) {
+    log::debug("ignoring plugin header cache {}, unknown format", m_Path);
+    return;
+  }
+
+  for (quint32 i = 0; i < count; ++i) {
+    Entry e;
+    in >> e.path >> e.size >> e.time >> e.header;
+
+    if (in.status() != QDataStream::Ok) {
+      log::warn("plugin header cache {} is corrupted, ignoring it", m_Path);
+      m_Entries.clear();
+      return;
+    }
+
+    m_Entries.insert(e.path.toLower(), std::move(e));
+  }
+}
@@ -0,0 +1,87 @@
+#ifndef PLUGINHEADERCACHE_H
+#define PLUGINHEADERCACHE_H
+
+#include <QHash>
+#include <QString>
+#include <QStringList>
+
+#include <mutex>
+#include <optional>
+
+// the parts of a plugin's header used by the plugin list, see ESP::File
+//
+struct PluginHeader
+{
+  bool isMaster  = false;
+  bool isOverlay = false;
+
+  // ESP::File::isLight() without and with overlay support, the plugin list
+  // picks one depending on the game
+  bool isLight             = false;
+  bool isLightWithOverlays = false;
+
+  bool isDummy = false;
+
+  QString author;
+  QString description;
+  QStringList masters;
+
+  // parses the header of the given plugin, throws on errors
+  //
+  static PluginHeader read(const QString& fullPath);
+};
+
+// headers of plugins that have been parsed before, saved to a file so plugins
+// that haven't changed are not opened again on the next refresh, even after a
+// restart
+//
+// entries are keyed by the full path of the plugin and are only used if its
+// size and modification time haven't changed
+//
+class PluginHeaderCache
+{
+public:
+  // sets the file the cache is saved to, the cache is reloaded from it the next
+  // time it's used if it's different from the current one
+  //
+  void setPath(const QString& path);
+
+  // returns the header of the given plugin, parsing it if it's not in the cache
+  // or if the file has changed; returns empty if the plugin can't be parsed,
+  // errors are logged
+  //
+  // can be called from multiple threads
+  //
+  std::optional<PluginHeader> get(const QString& fullPath);
+
+  // writes the cache if anything has changed since it was loaded; if `prune`
+  // is set, entries that haven't been requested since the last time it was
+  // pruned are dropped if their plugin doesn't exist anymore
+  //
+  // this checks every unused entry on disk, so it should only be done after
+  // all the plugins have been requested, not when only new ones were
+  //
+  void save(bool prune);
+
+private:
+  struct Entry
+  {
+    QString path;
+    quint64 size = 0;
+    quint64 time = 0;
+    PluginHeader header;
+    bool used = false;
+  };
+
+  std::mutex m_Mutex;
+  QString m_Path;
+  bool m_Loaded  = false;
+  bool m_Changed = false;
+
+  // by lowercase path
+  QHash<QString, Entry> m_Entries;
+
+  void load();
+};
+
+#endif  // PLUGINHEADERCACHE_H
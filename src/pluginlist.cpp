@@ -20,15 +20,16 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include "pluginlist.h"
 #include "modinfo.h"
 #include "modlist.h"
+#include "pluginarchives.h"
 #include "scopeguard.h"
 #include "settings.h"
 #include "shared/directoryentry.h"
 #include "shared/fileentry.h"
 #include "shared/filesorigin.h"
+#include "thread_utils.h"
 #include "viewmarkingscrollbar.h"
 
 #include "shared/windows_error.h"
-#include <espfile.h>
 #include <gameplugins.h>
 #include <iplugingame.h>
 #include <report.h>
@@ -173,6 +174,10 @@ void PluginList::refresh(const QString& profileName,
     m_ESPsByPriority.clear();
   }
 
+  // every plugin is requested from the header cache when the list is empty,
+  // otherwise only the new ones are
+  const bool requestsAll = m_ESPsByName.empty();
+
   ChangeBracket<PluginList> layoutChange(this);
 
   QStringList primaryPlugins = m_GamePlugin->primaryPlugins();
@@ -187,7 +192,26 @@ void PluginList::refresh(const QString& profileName,
 
   QStringList availablePlugins;
 
+  // plugins that weren't in the list yet, their headers are read in parallel
+  // once they've all been found
+  struct NewPlugin
+  {
+    QString name;
+    QString fullPath;
+    QString originName;
+    bool forceLoaded;
+    bool forceEnabled;
+    bool forceDisabled;
+    bool hasIni;
+    std::set<QString> archives;
+    std::optional<PluginHeader> header;
+  };
+
+  std::vector<NewPlugin> newPlugins;
+
   std::vector<FileEntryPtr> files = baseDirectory.getFiles();
+  const PluginArchives archives(files);
+
   for (FileEntryPtr current : files) {
     if (current.get() == nullptr) {
       continue;
@@ -223,16 +247,7 @@ void PluginList::refresh(const QString& profileName,
 
         QString iniPath = baseName + ".ini";
         bool hasIni     = baseDirectory.findFile(ToWString(iniPath)).get() != nullptr;
-        std::set<QString> loadedArchives;
-        QString candidateName;
-        for (FileEntryPtr archiveCandidate : files) {
-          candidateName = ToQString(archiveCandidate->getName());
-          if (candidateName.startsWith(baseName, Qt::CaseInsensitive) &&
-              (candidateName.endsWith(".bsa", Qt::CaseInsensitive) ||
-               candidateName.endsWith(".ba2", Qt::CaseInsensitive))) {
-            loadedArchives.insert(candidateName);
-          }
-        }
+        std::set<QString> loadedArchives = archives.forPlugin(baseName);
 
         QString originName    = ToQString(origin.getName());
         unsigned int modIndex = ModInfo::getIndex(originName);
@@ -241,11 +256,9 @@ void PluginList::refresh(const QString& profileName,
           originName           = modInfo->name();
         }
 
-        m_ESPs.push_back(ESPInfo(filename, forceLoaded, forceEnabled, forceDisabled,
-                                 originName, ToQString(current->getFullPath()), hasIni,
-                                 loadedArchives, lightPluginsAreSupported,
-                                 overridePluginsAreSupported));
-        m_ESPs.rbegin()->priority = -1;
+        newPlugins.push_back({filename, ToQString(current->getFullPath()),
+                              originName, forceLoaded, forceEnabled, forceDisabled,
+                              hasIni, std::move(loadedArchives)});
       } catch (const std::exception& e) {
         reportError(
             tr("failed to update esp info for file %1 (source id: %2), error: %3")
@@ -256,6 +269,28 @@ void PluginList::refresh(const QString& profileName,
     }
   }
 
+  // headers that haven't changed since the last refresh come from the cache,
+  // the others are parsed on the refresh threads
+  m_HeaderCache.setPath(Settings::instance().paths().cache() + "/plugins.cache");
+
+  parallelMap(
+      newPlugins.begin(), newPlugins.end(),
+      [this](NewPlugin& p) {
+        p.header = m_HeaderCache.get(p.fullPath);
+      },
+      std::min(Settings::instance().refreshThreadCount(), newPlugins.size()));
+
+  // unused entries are only pruned when they really weren't requested
+  m_HeaderCache.save(requestsAll);
+
+  for (auto& p : newPlugins) {
+    m_ESPs.push_back(ESPInfo(p.name, p.forceLoaded, p.forceEnabled, p.forceDisabled,
+                             p.originName, p.fullPath, p.hasIni, std::move(p.archives),
+                             p.header ? &*p.header : nullptr, lightPluginsAreSupported,
+                             overridePluginsAreSupported));
+    m_ESPs.rbegin()->priority = -1;
+  }
+
   for (const auto& espName : m_ESPsByName) {
     if (!availablePlugins.contains(espName.first, Qt::CaseInsensitive)) {
       m_ESPs[espName.second].name = "";
@@ -1801,32 +1836,31 @@ QModelIndex PluginList::parent(const QModelIndex&) const
 PluginList::ESPInfo::ESPInfo(const QString& name, bool forceLoaded, bool forceEnabled,
                              bool forceDisabled, const QString& originName,
                              const QString& fullPath, bool hasIni,
-                             std::set<QString> archives, bool lightSupported,
-                             bool overlaySupported)
+                             std::set<QString> archives, const PluginHeader* header,
+                             bool lightSupported, bool overlaySupported)
     : name(name), fullPath(fullPath), enabled(forceLoaded), forceLoaded(forceLoaded),
       forceEnabled(forceEnabled), forceDisabled(forceDisabled), priority(0),
       loadOrder(-1), originName(originName), hasIni(hasIni),
       archives(archives.begin(), archives.end()), modSelected(false)
 {
-  try {
-    ESP::File file(ToWString(fullPath));
+  if (header) {
     auto extension     = name.right(3).toLower();
     hasMasterExtension = (extension == "esm");
     hasLightExtension  = (extension == "esl");
-    isMasterFlagged    = file.isMaster();
-    isOverlayFlagged   = overlaySupported && file.isOverlay();
-    isLightFlagged =
-        lightSupported && !isOverlayFlagged && file.isLight(overlaySupported);
-    hasNoRecords = file.isDummy();
+    isMasterFlagged    = header->isMaster;
+    isOverlayFlagged   = overlaySupported && header->isOverlay;
+    isLightFlagged     = lightSupported && !isOverlayFlagged &&
+                     (overlaySupported ? header->isLightWithOverlays : header->isLight);
+    hasNoRecords = header->isDummy;
 
-    author      = QString::fromLatin1(file.author().c_str());
-    description = QString::fromLatin1(file.description().c_str());
+    author      = header->author;
+    description = header->description;
 
-    for (auto&& m : file.masters()) {
-      masters.insert(QString::fromStdString(m));
+    for (auto&& m : header->masters) {
+      masters.insert(m);
     }
-  } catch (const std::exception& e) {
-    log::error("failed to parse plugin file {}: {}", fullPath, e.what());
+  } else {
+    // the header couldn't be parsed, see PluginHeaderCache::get()
     hasMasterExtension = false;
     hasLightExtension  = false;
     isMasterFlagged    = false;
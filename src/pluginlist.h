@@ -21,6 +21,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #define PLUGINLIST_H
 
 #include "loot.h"
+#include "pluginheadercache.h"
 #include "profile.h"
 #include <ifiletree.h>
 #include <ipluginlist.h>
@@ -316,8 +317,8 @@ private:
   {
     ESPInfo(const QString& name, bool forceLoaded, bool forceEnabled,
             bool forceDisabled, const QString& originName, const QString& fullPath,
-            bool hasIni, std::set<QString> archives, bool lightSupported,
-            bool overrideSupported);
+            bool hasIni, std::set<QString> archives, const PluginHeader* header,
+            bool lightSupported, bool overrideSupported);
 
     QString name;
     QString fullPath;
@@ -385,6 +386,7 @@ private:
   OrganizerCore& m_Organizer;
 
   std::vector<ESPInfo> m_ESPs;
+  PluginHeaderCache m_HeaderCache;
   mutable std::map<QString, QByteArray> m_LastSaveHash;
 
   std::map<QString, int, MOBase::FileNameComparator> m_ESPsByName;
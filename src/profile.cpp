@@ -698,32 +698,109 @@ bool Profile::setModPriority(unsigned int index, int& newPriority)
 
   newPriority = std::clamp(newPriority, 0, static_cast<int>(m_NumRegularMods) - 1);
 
-  int oldPriority  = m_ModStatus.at(index).m_Priority;
-  int lastPriority = INT_MIN;
+  const int oldPriority = m_ModStatus.at(index).m_Priority;
 
   if (newPriority == oldPriority) {
     // nothing to do
     return false;
   }
 
-  for (const auto& [priority, index] : m_ModIndexByPriority) {
-    if (newPriority < oldPriority && priority >= newPriority &&
-        priority < oldPriority) {
-      m_ModStatus.at(index).m_Priority += 1;
-    } else if (newPriority > oldPriority && priority <= newPriority &&
-               priority > oldPriority) {
-      m_ModStatus.at(index).m_Priority -= 1;
+  // the mod must end up at the given priority, so when moving it up, it goes
+  // after the mod that is currently there
+  const auto moved = setModsPriority(
+      {index}, newPriority > oldPriority ? newPriority + 1 : newPriority);
+
+  newPriority = m_ModStatus[index].m_Priority;
+
+  return !moved.empty();
+}
+
+std::vector<std::pair<unsigned int, int>>
+Profile::setModsPriority(const std::vector<unsigned int>& indices, int newPriority)
+{
+  // mods that can be moved as (old priority, index), by ascending priority
+  std::vector<std::pair<int, unsigned int>> moving;
+
+  for (const auto index : indices) {
+    if (index >= m_ModStatus.size() ||
+        ModInfo::getByIndex(index)->hasAutomaticPriority()) {
+      continue;
     }
-    lastPriority = std::max(lastPriority, priority);
+
+    moving.push_back({m_ModStatus[index].m_Priority, index});
   }
 
-  newPriority                      = std::min(newPriority, lastPriority);
-  m_ModStatus.at(index).m_Priority = std::min(newPriority, lastPriority);
+  std::sort(moving.begin(), moving.end());
+  moving.erase(std::unique(moving.begin(), moving.end()), moving.end());
 
-  updateIndices();
-  m_ModListWriter.write();
+  if (moving.empty()) {
+    return {};
+  }
 
-  return true;
+  const int target = std::clamp(newPriority, 0, static_cast<int>(m_NumRegularMods));
+
+  // the moving mods below the target leave a hole, so the block starts that
+  // many priorities lower
+  const auto below = std::lower_bound(moving.begin(), moving.end(),
+                                      std::make_pair(target, 0u)) -
+                     moving.begin();
+
+  const int start = target - static_cast<int>(below);
+
+  // only the mods in this range change priority
+  const int first = std::min(start, moving.front().first);
+  const int last =
+      std::max(start + static_cast<int>(moving.size()) - 1, moving.back().first);
+
+  // the other mods in the range in order, with the moving mods inserted as a
+  // block; moving mods are skipped by walking both lists together since they
+  // are both sorted by priority
+  std::vector<unsigned int> order;
+  auto nextMoving = moving.begin();
+
+  const auto rangeBegin = m_ModIndexByPriority.lower_bound(first);
+  const auto rangeEnd   = m_ModIndexByPriority.upper_bound(last);
+
+  for (auto itor = rangeBegin; itor != rangeEnd; ++itor) {
+    while (nextMoving != moving.end() && nextMoving->first < itor->first) {
+      ++nextMoving;
+    }
+
+    if (nextMoving == moving.end() || nextMoving->first != itor->first) {
+      order.push_back(itor->second);
+    }
+  }
+
+  const auto blockPos = std::min<std::size_t>(start - first, order.size());
+  order.insert(order.begin() + blockPos, moving.size(), 0);
+
+  for (std::size_t i = 0; i < moving.size(); ++i) {
+    order[blockPos + i] = moving[i].second;
+  }
+
+  // renumbers the range, gaps in the old priorities are closed
+  m_ModIndexByPriority.erase(rangeBegin, rangeEnd);
+
+  for (std::size_t i = 0; i < order.size(); ++i) {
+    const int priority = first + static_cast<int>(i);
+
+    m_ModStatus[order[i]].m_Priority = priority;
+    m_ModIndexByPriority[priority]   = order[i];
+  }
+
+  std::vector<std::pair<unsigned int, int>> moved;
+
+  for (const auto& [oldPriority, index] : moving) {
+    if (m_ModStatus[index].m_Priority != oldPriority) {
+      moved.push_back({index, oldPriority});
+    }
+  }
+
+  if (!moved.empty()) {
+    m_ModListWriter.write();
+  }
+
+  return moved;
 }
 
 Profile* Profile::createPtrFrom(const QString& name, const Profile& reference,
@@ -301,6 +301,19 @@ public:
   //
   bool setModPriority(unsigned int index, int& newPriority);
 
+  // moves the given mods as a block in front of the mod that is currently at
+  // the given priority, keeping their relative order; this is what dropping a
+  // selection on a row does
+  //
+  // only the priorities between the old and new positions are renumbered,
+  // instead of shifting the whole list once per mod
+  //
+  // mods with automatic priority are ignored; returns the index and old
+  // priority of every given mod that was actually moved
+  //
+  std::vector<std::pair<unsigned int, int>>
+  setModsPriority(const std::vector<unsigned int>& indices, int newPriority);
+
   /**
    * @brief determine if a mod is enabled
    *
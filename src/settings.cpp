@@ -274,6 +274,26 @@ void Settings::setRefreshThreadCount(std::size_t n) const
   return set(m_Settings, "Settings", "refresh_thread_count", n);
 }
 
+bool Settings::incrementalRefresh() const
+{
+  return get<bool>(m_Settings, "Settings", "incremental_refresh", true);
+}
+
+void Settings::setIncrementalRefresh(bool b)
+{
+  set(m_Settings, "Settings", "incremental_refresh", b);
+}
+
+bool Settings::directorySnapshot() const
+{
+  return get<bool>(m_Settings, "Settings", "directory_snapshot", true);
+}
+
+void Settings::setDirectorySnapshot(bool b)
+{
+  set(m_Settings, "Settings", "directory_snapshot", b);
+}
+
 std::optional<QVersionNumber> Settings::version() const
 {
   if (auto v = getOptional<QString>(m_Settings, "General", "version")) {
@@ -1739,6 +1759,16 @@ void NetworkSettings::setUseProxy(bool b)
   set(m_Settings, "Settings", "use_proxy", b);
 }
 
+int NetworkSettings::downloadSegments() const
+{
+  return get<int>(m_Settings, "Settings", "download_segments", 4);
+}
+
+void NetworkSettings::setDownloadSegments(int n)
+{
+  set(m_Settings, "Settings", "download_segments", n);
+}
+
 void NetworkSettings::setDownloadSpeed(const QString& name, int bytesPerSecond)
 {
   auto current = servers();
@@ -442,6 +442,12 @@ public:
   bool useProxy() const;
   void setUseProxy(bool b);
 
+  // number of connections a single download is split into when the server
+  // supports it, 1 disables segmented downloads
+  //
+  int downloadSegments() const;
+  void setDownloadSegments(int n);
+
   // add a new download speed to the list for the given server; each server
   // remembers the last couple of download speeds and displays the average in
   // the network settings
@@ -845,6 +851,19 @@ public:
   std::size_t refreshThreadCount() const;
   void setRefreshThreadCount(std::size_t n) const;
 
+  // whether refreshes should update the previous directory structure in place
+  // by only re-adding the mods that have changed on disk
+  //
+  bool incrementalRefresh() const;
+  void setIncrementalRefresh(bool b);
+
+  // whether the directory structure should be saved in the cache directory
+  // after each refresh and reused on the next start; only used with
+  // incremental refreshes
+  //
+  bool directorySnapshot() const;
+  void setDirectorySnapshot(bool b);
+
   GameSettings& game();
   const GameSettings& game() const;
 
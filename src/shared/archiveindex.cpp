@@ -0,0 +1,454 @@
+#include "archiveindex.h"
+#include "stringpool.h"
+#include "util.h"
+#include <bsatk.h>
+#include <log.h>
+#include <utility.h>
+
+#include <QFile>
+
+#include <chrono>
+#include <set>
+
+namespace MOShared
+{
+
+using namespace MOBase;
+
+namespace
+{
+
+constexpr char IndexMagic[4]   = {'M', 'O', 'B', 'I'};
+constexpr uint32_t IndexVersion = 1;
+
+// the file is:
+//  - the header,
+//  - the path of the archive,
+//  - the root folder
+//
+// a folder is its name, the number of files and subfolders, then its files,
+// then its subfolders; a file is its name, size and uncompressed size
+//
+// strings are a uint32_t length followed by that many wchar_t, without a null
+// terminator
+
+struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint64_t archiveSize;
+  FILETIME archiveTime;
+};
+
+struct InvalidIndex : public std::runtime_error
+{
+  using runtime_error::runtime_error;
+};
+
+// bounds-checked sequential access to the file
+//
+class Reader
+{
+public:
+  Reader(const char* data, std::size_t size) : m_Data(data), m_Size(size), m_Pos(0)
+  {}
+
+  template <class T>
+  T get()
+  {
+    T t;
+    read(&t, sizeof(T));
+    return t;
+  }
+
+  std::wstring string()
+  {
+    const auto length = get<uint32_t>();
+
+    if (length > (m_Size - m_Pos) / sizeof(wchar_t)) {
+      throw InvalidIndex("file is truncated");
+    }
+
+    std::wstring s(length, L'\0');
+    read(s.data(), length * sizeof(wchar_t));
+
+    return s;
+  }
+
+  // a count of elements, each of which takes at least minSize bytes in the
+  // file, so a corrupted count can't allocate more than the file's size
+  //
+  uint32_t count(std::size_t minSize)
+  {
+    const auto n = get<uint32_t>();
+
+    if (n > (m_Size - m_Pos) / minSize) {
+      throw InvalidIndex("bad count");
+    }
+
+    return n;
+  }
+
+  void folder(ArchiveIndex::Folder& f)
+  {
+    f.name = string();
+
+    const auto fileCount = count(sizeof(uint32_t) + 2 * sizeof(uint64_t));
+    f.files.resize(fileCount);
+
+    const auto folderCount = count(3 * sizeof(uint32_t));
+    f.folders.resize(folderCount);
+
+    for (auto& file : f.files) {
+      file.name             = string();
+      file.size             = get<uint64_t>();
+      file.uncompressedSize = get<uint64_t>();
+    }
+
+    for (auto& sub : f.folders) {
+      folder(sub);
+    }
+  }
+
+private:
+  const char* m_Data;
+  std::size_t m_Size;
+  std::size_t m_Pos;
+
+  void read(void* out, std::size_t bytes)
+  {
+    if (bytes > m_Size - m_Pos) {
+      throw InvalidIndex("file is truncated");
+    }
+
+    std::memcpy(out, m_Data + m_Pos, bytes);
+    m_Pos += bytes;
+  }
+};
+
+class Writer
+{
+public:
+  template <class T>
+  void put(const T& t)
+  {
+    write(&t, sizeof(T));
+  }
+
+  void string(const std::wstring& s)
+  {
+    put(static_cast<uint32_t>(s.size()));
+    write(s.data(), s.size() * sizeof(wchar_t));
+  }
+
+  void folder(const ArchiveIndex::Folder& f)
+  {
+    string(f.name);
+    put(static_cast<uint32_t>(f.files.size()));
+    put(static_cast<uint32_t>(f.folders.size()));
+
+    for (auto&& file : f.files) {
+      string(file.name);
+      put(file.size);
+      put(file.uncompressedSize);
+    }
+
+    for (auto&& sub : f.folders) {
+      folder(sub);
+    }
+  }
+
+  const std::vector<char>& data() const { return m_Data; }
+
+private:
+  std::vector<char> m_Data;
+
+  void write(const void* p, std::size_t size)
+  {
+    const auto* c = static_cast<const char*>(p);
+    m_Data.insert(m_Data.end(), c, c + size);
+  }
+};
+
+// size and last modification time of the given file, logs errors
+//
+bool archiveKey(const std::wstring& path, uint64_t& size, FILETIME& time)
+{
+  WIN32_FILE_ATTRIBUTE_DATA data = {};
+
+  if (!::GetFileAttributesExW(path.c_str(), GetFileExInfoStandard, &data)) {
+    const auto e = ::GetLastError();
+    log::error("can't read archive '{}', {}", path, formatSystemMessage(e));
+    return false;
+  }
+
+  size = (uint64_t(data.nFileSizeHigh) << 32) | data.nFileSizeLow;
+  time = data.ftLastWriteTime;
+
+  return true;
+}
+
+void addFolder(ArchiveIndex::Folder& out, const BSA::Folder::Ptr& in)
+{
+  out.name = ToWString(in->getName(), true);
+
+  const auto fileCount = in->getNumFiles();
+  out.files.reserve(fileCount);
+
+  for (unsigned int i = 0; i < fileCount; ++i) {
+    const BSA::File::Ptr file = in->getFile(i);
+
+    out.files.push_back({ToWString(file->getName(), true), file->getFileSize(),
+                         file->getUncompressedFileSize()});
+  }
+
+  const auto folderCount = in->getNumSubFolders();
+  out.folders.resize(folderCount);
+
+  for (unsigned int i = 0; i < folderCount; ++i) {
+    addFolder(out.folders[i], in->getSubFolder(i));
+  }
+}
+
+}  // namespace
+
+std::optional<ArchiveIndex> ArchiveIndex::read(const std::wstring& path)
+{
+  ArchiveIndex index;
+
+  if (!archiveKey(path, index.archiveSize, index.archiveTime)) {
+    return {};
+  }
+
+  BSA::Archive archive;
+  BSA::EErrorCode res = BSA::ERROR_NONE;
+
+  try {
+    // read() can return an error, but it can also throw if the file is not a
+    // valid bsa
+    res = archive.read(ToString(path, false).c_str(), false);
+  } catch (std::exception& e) {
+    log::error("invalid bsa '{}', error {}", path, e.what());
+    return {};
+  }
+
+  if ((res != BSA::ERROR_NONE) && (res != BSA::ERROR_INVALIDHASHES)) {
+    log::error("invalid bsa '{}', error {}", path, res);
+    return {};
+  }
+
+  addFolder(index.root, archive.getRoot());
+
+  return index;
+}
+
+ArchiveIndexCache::ArchiveIndexCache(std::wstring directory)
+    : m_Directory(std::move(directory))
+{
+  if (m_Directory.empty()) {
+    return;
+  }
+
+  std::error_code ec;
+  std::filesystem::create_directories(m_Directory, ec);
+
+  if (ec) {
+    log::error("can't create archive index cache '{}', {}", m_Directory,
+               ec.message());
+
+    m_Directory.clear();
+  }
+}
+
+std::optional<ArchiveIndex>
+ArchiveIndexCache::get(const std::wstring& archivePath) const
+{
+  if (m_Directory.empty()) {
+    return ArchiveIndex::read(archivePath);
+  }
+
+  uint64_t size = 0;
+  FILETIME time = {};
+
+  if (!archiveKey(archivePath, size, time)) {
+    return {};
+  }
+
+  const auto path = cachePath(archivePath);
+
+  if (auto index = load(path, archivePath, size, time)) {
+    return index;
+  }
+
+  auto index = ArchiveIndex::read(archivePath);
+
+  if (index) {
+    save(path, archivePath, *index);
+  }
+
+  return index;
+}
+
+void ArchiveIndexCache::prune(const std::vector<std::wstring>& archivePaths) const
+{
+  if (m_Directory.empty()) {
+    return;
+  }
+
+  namespace fs = std::filesystem;
+
+  std::set<std::wstring> used;
+  for (auto&& a : archivePaths) {
+    used.insert(cacheFileName(a));
+  }
+
+  const auto oldTemp = fs::file_time_type::clock::now() - std::chrono::hours(24);
+
+  std::error_code ec;
+  std::size_t removed = 0;
+
+  for (fs::directory_iterator itor(m_Directory, ec), end; !ec && itor != end;
+       itor.increment(ec)) {
+    const auto& path = itor->path();
+    std::error_code fileEc;
+    bool stale = false;
+
+    if (path.extension() == L".bsaindex") {
+      stale = !used.contains(path.filename().native());
+    } else if (path.extension() == L".tmp") {
+      const auto time = itor->last_write_time(fileEc);
+      stale           = (!fileEc && time < oldTemp);
+    }
+
+    if (!stale) {
+      continue;
+    }
+
+    if (fs::remove(path, fileEc)) {
+      ++removed;
+    } else if (fileEc) {
+      log::warn("can't remove archive index '{}', {}", path.native(),
+                fileEc.message());
+    }
+  }
+
+  if (ec) {
+    log::warn("can't list archive indices in '{}', {}", m_Directory, ec.message());
+  }
+
+  if (removed > 0) {
+    log::debug("removed {} unused archive indices", removed);
+  }
+}
+
+std::wstring ArchiveIndexCache::cacheFileName(const std::wstring& archivePath) const
+{
+  return std::format(L"{:016x}.bsaindex", hashCaseFolded(archivePath));
+}
+
+std::wstring ArchiveIndexCache::cachePath(const std::wstring& archivePath) const
+{
+  return m_Directory + L"\\" + cacheFileName(archivePath);
+}
+
+std::optional<ArchiveIndex>
+ArchiveIndexCache::load(const std::wstring& path, const std::wstring& archivePath,
+                        uint64_t archiveSize, FILETIME archiveTime) const
+{
+  QFile file(QString::fromStdWString(path));
+
+  if (!file.exists()) {
+    return {};
+  }
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    log::error("failed to open archive index '{}', {}", path, file.errorString());
+    return {};
+  }
+
+  const QByteArray data = file.readAll();
+
+  try {
+    Reader r(data.constData(), static_cast<std::size_t>(data.size()));
+
+    const auto h = r.get<Header>();
+
+    if (std::memcmp(h.magic, IndexMagic, sizeof(h.magic)) != 0) {
+      throw InvalidIndex("bad magic");
+    }
+
+    if (h.version != IndexVersion) {
+      throw InvalidIndex(std::format("unsupported version {}", h.version));
+    }
+
+    if (h.archiveSize != archiveSize ||
+        CompareFileTime(&h.archiveTime, &archiveTime) != 0 ||
+        !equalsCaseFolded(r.string(), archivePath)) {
+      // archive has changed or the file is for another one with the same hash
+      return {};
+    }
+
+    ArchiveIndex index;
+    index.archiveSize = h.archiveSize;
+    index.archiveTime = h.archiveTime;
+    r.folder(index.root);
+
+    return index;
+  } catch (InvalidIndex& e) {
+    log::warn("ignoring archive index '{}': {}", path, e.what());
+    return {};
+  }
+}
+
+bool ArchiveIndexCache::save(const std::wstring& path, const std::wstring& archivePath,
+                             const ArchiveIndex& index) const
+{
+  Header h = {};
+  std::memcpy(h.magic, IndexMagic, sizeof(h.magic));
+  h.version     = IndexVersion;
+  h.archiveSize = index.archiveSize;
+  h.archiveTime = index.archiveTime;
+
+  Writer w;
+  w.put(h);
+  w.string(archivePath);
+  w.folder(index.root);
+
+  // written to a temporary file first so a crash never leaves a truncated
+  // index behind; the name is unique to this thread, another one can be saving
+  // the same archive at the same time
+  const std::wstring temp = std::format(L"{}.{}.tmp", path, ::GetCurrentThreadId());
+
+  std::FILE* f = nullptr;
+  auto e       = _wfopen_s(&f, temp.c_str(), L"wb");
+
+  if (e != 0 || !f) {
+    log::error("failed to open '{}' for writing, {} ({})", temp, std::strerror(e), e);
+    return false;
+  }
+
+  const auto& data = w.data();
+  bool ok          = (std::fwrite(data.data(), data.size(), 1, f) == 1);
+
+  if (std::fclose(f) != 0) {
+    ok = false;
+  }
+
+  if (!ok) {
+    const auto e = errno;
+    log::error("failed to write '{}', {} ({})", temp, std::strerror(e), e);
+    ::DeleteFileW(temp.c_str());
+    return false;
+  }
+
+  if (!::MoveFileExW(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    const auto e = ::GetLastError();
+    log::error("failed to rename '{}' to '{}', {}", temp, path, formatSystemMessage(e));
+    ::DeleteFileW(temp.c_str());
+    return false;
+  }
+
+  return true;
+}
+
+}  // namespace MOShared
@@ -0,0 +1,95 @@
+#ifndef MO_REGISTER_ARCHIVEINDEX_INCLUDED
+#define MO_REGISTER_ARCHIVEINDEX_INCLUDED
+
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace MOShared
+{
+
+// folders and files of a bsa, which is all the structure needs from an archive;
+// made by parsing the archive or loaded from an ArchiveIndexCache
+//
+struct ArchiveIndex
+{
+  struct File
+  {
+    std::wstring name;
+    uint64_t size;
+
+    // 0 if the file isn't compressed
+    uint64_t uncompressedSize;
+  };
+
+  struct Folder
+  {
+    // as given by the archive, may be a relative path
+    std::wstring name;
+
+    std::vector<File> files;
+    std::vector<Folder> folders;
+  };
+
+  // size and last modification time of the archive when it was indexed
+  uint64_t archiveSize = 0;
+  FILETIME archiveTime = {};
+
+  Folder root;
+
+  // parses the given archive; returns empty on errors, which are logged
+  //
+  static std::optional<ArchiveIndex> read(const std::wstring& path);
+};
+
+// keeps the indices of archives in a directory so they're not parsed again on
+// every refresh
+//
+// every archive gets its own file, named after a hash of its path, which also
+// has the path, size and modification time of the archive; the archive is
+// parsed again when any of them doesn't match
+//
+// different archives can be requested from multiple threads at the same time
+//
+class ArchiveIndexCache
+{
+public:
+  // an empty directory disables the cache, archives are always parsed
+  //
+  explicit ArchiveIndexCache(std::wstring directory = {});
+
+  // returns the index of the given archive from the cache, or parses the
+  // archive and updates the cache; returns empty if the archive can't be read,
+  // errors are logged
+  //
+  std::optional<ArchiveIndex> get(const std::wstring& archivePath) const;
+
+  // deletes the indices of archives that are not in the given list, which
+  // should have all the archives used by the last refresh; indices of archives
+  // that were updated or removed would otherwise stay forever
+  //
+  // temporary files left behind by a crash are also deleted once they're old
+  // enough to not be written anymore
+  //
+  void prune(const std::vector<std::wstring>& archivePaths) const;
+
+private:
+  std::wstring m_Directory;
+
+  std::wstring cacheFileName(const std::wstring& archivePath) const;
+  std::wstring cachePath(const std::wstring& archivePath) const;
+
+  // returns empty if the file doesn't exist, is invalid or is for another
+  // version of the archive
+  //
+  std::optional<ArchiveIndex> load(const std::wstring& path,
+                                   const std::wstring& archivePath,
+                                   uint64_t archiveSize, FILETIME archiveTime) const;
+
+  bool save(const std::wstring& path, const std::wstring& archivePath,
+            const ArchiveIndex& index) const;
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_ARCHIVEINDEX_INCLUDED
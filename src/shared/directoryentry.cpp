@@ -77,21 +77,25 @@ bool DirCompareByName::operator()(const DirectoryEntry* lhs,
   return _wcsicmp(lhs->getName().c_str(), rhs->getName().c_str()) < 0;
 }
 
-DirectoryEntry::DirectoryEntry(std::wstring name, DirectoryEntry* parent, int originID)
-    : m_OriginConnection(new OriginConnection), m_Name(std::move(name)),
+DirectoryEntry::DirectoryEntry(std::wstring_view name, DirectoryEntry* parent,
+                               int originID)
+    : m_OriginConnection(new OriginConnection),
+      m_Name(StringPool::instance().intern(name)),
       m_Parent(parent), m_Populated(false), m_TopLevel(true)
 {
   m_FileRegister.reset(new FileRegister(m_OriginConnection));
-  m_Origins.insert(originID);
+  m_Origins.push_back(originID);
 }
 
-DirectoryEntry::DirectoryEntry(std::wstring name, DirectoryEntry* parent, int originID,
+DirectoryEntry::DirectoryEntry(std::wstring_view name, DirectoryEntry* parent,
+                               int originID,
                                boost::shared_ptr<FileRegister> fileRegister,
                                boost::shared_ptr<OriginConnection> originConnection)
     : m_FileRegister(fileRegister), m_OriginConnection(originConnection),
-      m_Name(std::move(name)), m_Parent(parent), m_Populated(false), m_TopLevel(false)
+      m_Name(StringPool::instance().intern(name)), m_Parent(parent), m_Populated(false),
+      m_TopLevel(false)
 {
-  m_Origins.insert(originID);
+  m_Origins.push_back(originID);
 }
 
 DirectoryEntry::~DirectoryEntry()
@@ -101,14 +105,37 @@ DirectoryEntry::~DirectoryEntry()
 
 void DirectoryEntry::clear()
 {
-  for (auto itor = m_SubDirectories.rbegin(); itor != m_SubDirectories.rend(); ++itor) {
-    delete *itor;
+  for (auto* d : m_SubDirectories.values()) {
+    delete d;
   }
 
   m_Files.clear();
-  m_FilesLookup.clear();
   m_SubDirectories.clear();
-  m_SubDirectoriesLookup.clear();
+}
+
+void DirectoryEntry::freeze()
+{
+  m_Files.freeze([&](FileIndex a, FileIndex b) {
+    return fileNameLess(a, b);
+  });
+
+  m_SubDirectories.freeze(DirCompareByName());
+
+  for (auto* d : m_SubDirectories.values()) {
+    d->freeze();
+  }
+}
+
+std::size_t DirectoryEntry::indexMemoryUsage() const
+{
+  std::size_t n = m_Files.memoryUsage() + m_SubDirectories.memoryUsage() +
+                  m_Origins.capacity() * sizeof(OriginID);
+
+  for (auto* d : m_SubDirectories.values()) {
+    n += d->indexMemoryUsage();
+  }
+
+  return n;
 }
 
 void DirectoryEntry::addFromOrigin(const std::wstring& originName,
@@ -154,8 +181,13 @@ void DirectoryEntry::addDir(FilesOrigin& origin, env::Directory& d,
   });
 
   elapsed(stats.fileTimes, [&] {
+    // once for all the files instead of walking up to the root for each one
+    if (!d.files.empty()) {
+      propagateOrigin(origin.getID());
+    }
+
     for (auto& f : d.files) {
-      insert(f, origin, L"", -1, stats);
+      append(f, origin, stats);
     }
   });
 
@@ -183,11 +215,26 @@ void DirectoryEntry::addFromAllBSAs(const std::wstring& originName,
                                     const std::vector<std::wstring>& archives,
                                     const std::set<std::wstring>& enabledArchives,
                                     const std::vector<std::wstring>& loadOrder,
+                                    const ArchiveIndexCache& cache,
                                     DirectoryStats& stats)
+{
+  addFromBSAs(originName, directory, priority,
+              readBSAs(directory, archives, enabledArchives, loadOrder, cache),
+              stats);
+}
+
+std::vector<DirectoryEntry::LoadedBSA>
+DirectoryEntry::readBSAs(const std::wstring& directory,
+                         const std::vector<std::wstring>& archives,
+                         const std::set<std::wstring>& enabledArchives,
+                         const std::vector<std::wstring>& loadOrder,
+                         const ArchiveIndexCache& cache)
 {
   const IPluginGame* game = qApp->property("managed_game").value<IPluginGame*>();
   const QString gameName  = game->gameName();
 
+  std::vector<LoadedBSA> v;
+
   for (const auto& archive : archives) {
     const std::filesystem::path archivePath(archive);
     const auto filename = archivePath.filename().native();
@@ -215,23 +262,46 @@ void DirectoryEntry::addFromAllBSAs(const std::wstring& originName,
 
     const auto filenameLc = ToLowerCopy(filename);
 
-    int order = -1;
-
-    for (auto plugin : loadOrder) {
+    // the first plugin that loads this archive gives its order
+    for (std::size_t i = 0; i < loadOrder.size(); ++i) {
       const auto pluginNameLc =
-          ToLowerCopy(std::filesystem::path(plugin).stem().native());
+          ToLowerCopy(std::filesystem::path(loadOrder[i]).stem().native());
 
       if (filenameLc.starts_with(pluginNameLc + L" - ") ||
           filenameLc.starts_with(pluginNameLc + L".")) {
-        auto itor = std::find(loadOrder.begin(), loadOrder.end(), plugin);
-        if (itor != loadOrder.end()) {
-          order = std::distance(loadOrder.begin(), itor);
-          addFromBSA(originName, directory, archivePath.native(), priority, order,
-                     stats);
+        if (auto index = cache.get(archivePath.native())) {
+          v.push_back({filename, static_cast<int>(i), std::move(*index)});
         }
+
+        break;
       }
     }
   }
+
+  return v;
+}
+
+void DirectoryEntry::addFromBSAs(const std::wstring& originName,
+                                 const std::wstring& directory, int priority,
+                                 const std::vector<LoadedBSA>& archives,
+                                 DirectoryStats& stats)
+{
+  if (archives.empty()) {
+    return;
+  }
+
+  FilesOrigin& origin = createOrigin(originName, directory, priority, stats);
+
+  for (auto&& bsa : archives) {
+    if (containsArchive(bsa.name)) {
+      continue;
+    }
+
+    addFiles(origin, bsa.index.root, bsa.index.archiveTime, bsa.name, bsa.order,
+             stats);
+
+    m_Populated = true;
+  }
 }
 
 void DirectoryEntry::addFromBSA(const std::wstring& originName,
@@ -246,48 +316,44 @@ void DirectoryEntry::addFromBSA(const std::wstring& originName,
     return;
   }
 
-  BSA::Archive archive;
-  BSA::EErrorCode res = BSA::ERROR_NONE;
-
-  try {
-    // read() can return an error, but it can also throw if the file is not a
-    // valid bsa
-    res = archive.read(ToString(archivePath, false).c_str(), false);
-  } catch (std::exception& e) {
-    log::error("invalid bsa '{}', error {}", archivePath, e.what());
-    return;
-  }
-
-  if ((res != BSA::ERROR_NONE) && (res != BSA::ERROR_INVALIDHASHES)) {
-    log::error("invalid bsa '{}', error {}", archivePath, res);
-    return;
+  if (auto index = ArchiveIndex::read(archivePath)) {
+    addFiles(origin, index->root, index->archiveTime, archiveName, order, stats);
+    m_Populated = true;
   }
+}
 
-  std::error_code ec;
-  const auto lwt = std::filesystem::last_write_time(archivePath, ec);
-  FILETIME ft    = {};
+void DirectoryEntry::propagateOrigin(int origin)
+{
+  addOrigin(origin);
 
-  if (ec) {
-    log::warn("failed to get last modified date for '{}', {}", archivePath,
-              ec.message());
-  } else {
-    ft = ToFILETIME(lwt);
+  if (m_Parent != nullptr) {
+    m_Parent->propagateOrigin(origin);
   }
-
-  addFiles(origin, archive.getRoot(), ft, archiveName, order, stats);
-
-  m_Populated = true;
 }
 
-void DirectoryEntry::propagateOrigin(int origin)
+void DirectoryEntry::removeOrigins(const std::set<OriginID>& origins)
 {
   {
     std::scoped_lock lock(m_OriginsMutex);
-    m_Origins.insert(origin);
+
+    std::erase_if(m_Origins, [&](OriginID id) {
+      return origins.contains(id);
+    });
   }
 
-  if (m_Parent != nullptr) {
-    m_Parent->propagateOrigin(origin);
+  std::vector<DirectoryEntry*> empty;
+
+  for (DirectoryEntry* entry : m_SubDirectories.values()) {
+    entry->removeOrigins(origins);
+
+    if (entry->isEmpty() && entry->m_Origins.empty()) {
+      empty.push_back(entry);
+    }
+  }
+
+  for (DirectoryEntry* entry : empty) {
+    removeDirectoryFromList(entry);
+    delete entry;
   }
 }
 
@@ -315,52 +381,88 @@ int DirectoryEntry::anyOrigin() const
 {
   bool ignore;
 
-  for (auto iter = m_Files.begin(); iter != m_Files.end(); ++iter) {
-    FileEntryPtr entry = m_FileRegister->getFile(iter->second);
-    if ((entry.get() != nullptr) && !entry->isFromArchive()) {
+  for (auto index : m_Files.values()) {
+    const FileEntry* entry = m_FileRegister->fileAt(index);
+    if ((entry != nullptr) && !entry->isFromArchive()) {
       return entry->getOrigin(ignore);
     }
   }
 
   // if we got here, no file directly within this directory is a valid indicator for a
   // mod, thus we continue looking in subdirectories
-  for (DirectoryEntry* entry : m_SubDirectories) {
+  for (DirectoryEntry* entry : m_SubDirectories.values()) {
     int res = entry->anyOrigin();
     if (res != InvalidOriginID) {
       return res;
     }
   }
 
-  return *(m_Origins.begin());
+  // the root can lose all its origins when they are removed
+  return (m_Origins.empty() ? InvalidOriginID : m_Origins.front());
 }
 
 std::vector<FileEntryPtr> DirectoryEntry::getFiles() const
 {
   std::vector<FileEntryPtr> result;
 
-  for (auto iter = m_Files.begin(); iter != m_Files.end(); ++iter) {
-    result.push_back(m_FileRegister->getFile(iter->second));
+  result.reserve(m_Files.size());
+
+  for (auto index : m_Files.values()) {
+    result.push_back(m_FileRegister->getFile(index));
   }
 
   return result;
 }
 
 DirectoryEntry* DirectoryEntry::findSubDirectory(const std::wstring& name,
-                                                 bool alreadyLowerCase) const
+                                                 bool) const
 {
-  SubDirectoriesLookup::const_iterator itor;
+  // names are compared case-insensitively without allocating, so whether
+  // `name` is already lowercase doesn't matter anymore
+  return lookupSubDirectory(name, hashCaseFolded(name));
+}
 
-  if (alreadyLowerCase) {
-    itor = m_SubDirectoriesLookup.find(name);
-  } else {
-    itor = m_SubDirectoriesLookup.find(ToLowerCopy(name));
-  }
+DirectoryEntry* DirectoryEntry::lookupSubDirectory(std::wstring_view name,
+                                                   std::size_t hash) const
+{
+  auto* d = m_SubDirectories.find(hash, [&](const DirectoryEntry* d) {
+    return equalsCaseFolded(d->getName(), name);
+  });
 
-  if (itor == m_SubDirectoriesLookup.end()) {
-    return nullptr;
+  return (d ? *d : nullptr);
+}
+
+FileIndex DirectoryEntry::findFileIndex(std::wstring_view name,
+                                        std::size_t hash) const
+{
+  auto* index = m_Files.find(hash, [&](FileIndex i) {
+    const auto* f = m_FileRegister->fileAt(i);
+    return (f && equalsCaseFolded(f->getName(), name));
+  });
+
+  return (index ? *index : InvalidFileIndex);
+}
+
+bool DirectoryEntry::fileNameLess(FileIndex a, FileIndex b) const
+{
+  const auto* fa = m_FileRegister->fileAt(a);
+  const auto* fb = m_FileRegister->fileAt(b);
+
+  if (!fa || !fb) {
+    return (fa == nullptr && fb != nullptr);
   }
 
-  return itor->second;
+  return _wcsicmp(fa->getName().c_str(), fb->getName().c_str()) < 0;
+}
+
+void DirectoryEntry::addOrigin(OriginID origin)
+{
+  std::scoped_lock lock(m_OriginsMutex);
+
+  auto itor = std::lower_bound(m_Origins.begin(), m_Origins.end(), origin);
+  if (itor == m_Origins.end() || *itor != origin) {
+    m_Origins.insert(itor, origin);
+  }
 }
 
 DirectoryEntry* DirectoryEntry::findSubDirectoryRecursive(const std::wstring& path)
@@ -372,16 +474,11 @@ DirectoryEntry* DirectoryEntry::findSubDirectoryRecursive(const std::wstring& pa
 const FileEntryPtr DirectoryEntry::findFile(const std::wstring& name,
                                             bool alreadyLowerCase) const
 {
-  FilesLookup::const_iterator iter;
-
-  if (alreadyLowerCase) {
-    iter = m_FilesLookup.find(DirectoryEntryFileKey(name));
-  } else {
-    iter = m_FilesLookup.find(DirectoryEntryFileKey(ToLowerCopy(name)));
-  }
+  // see findSubDirectory()
+  const auto index = findFileIndex(name, hashCaseFolded(name));
 
-  if (iter != m_FilesLookup.end()) {
-    return m_FileRegister->getFile(iter->second);
+  if (index != InvalidFileIndex) {
+    return m_FileRegister->getFile(index);
   } else {
     return FileEntryPtr();
   }
@@ -389,10 +486,10 @@ const FileEntryPtr DirectoryEntry::findFile(const std::wstring& name,
 
 const FileEntryPtr DirectoryEntry::findFile(const DirectoryEntryFileKey& key) const
 {
-  auto iter = m_FilesLookup.find(key);
+  const auto index = findFileIndex(key.value, key.hash);
 
-  if (iter != m_FilesLookup.end()) {
-    return m_FileRegister->getFile(iter->second);
+  if (index != InvalidFileIndex) {
+    return m_FileRegister->getFile(index);
   } else {
     return FileEntryPtr();
   }
@@ -400,14 +497,14 @@ const FileEntryPtr DirectoryEntry::findFile(const DirectoryEntryFileKey& key) co
 
 bool DirectoryEntry::hasFile(const std::wstring& name) const
 {
-  return m_Files.contains(ToLowerCopy(name));
+  return (findFileIndex(name, hashCaseFolded(name)) != InvalidFileIndex);
 }
 
 bool DirectoryEntry::containsArchive(std::wstring archiveName)
 {
-  for (auto iter = m_Files.begin(); iter != m_Files.end(); ++iter) {
-    FileEntryPtr entry = m_FileRegister->getFile(iter->second);
-    if (entry->isFromArchive(archiveName)) {
+  for (auto index : m_Files.values()) {
+    const FileEntry* entry = m_FileRegister->fileAt(index);
+    if (entry && entry->isFromArchive(archiveName)) {
       return true;
     }
   }
@@ -435,10 +532,10 @@ const FileEntryPtr DirectoryEntry::searchFile(const std::wstring& path,
 
   if (len == std::string::npos) {
     // no more path components
-    auto iter = m_Files.find(ToLowerCopy(path));
+    const auto index = findFileIndex(path, hashCaseFolded(path));
 
-    if (iter != m_Files.end()) {
-      return m_FileRegister->getFile(iter->second);
+    if (index != InvalidFileIndex) {
+      return m_FileRegister->getFile(index);
     } else if (directory != nullptr) {
       DirectoryEntry* temp = findSubDirectory(path);
       if (temp != nullptr) {
@@ -494,12 +591,10 @@ void DirectoryEntry::removeDir(const std::wstring& path)
   size_t pos = path.find_first_of(L"\\/");
 
   if (pos == std::string::npos) {
-    for (auto iter = m_SubDirectories.begin(); iter != m_SubDirectories.end(); ++iter) {
-      DirectoryEntry* entry = *iter;
-
+    for (DirectoryEntry* entry : m_SubDirectories.values()) {
       if (CaseInsensitiveEqual(entry->getName(), path)) {
         entry->removeDirRecursive();
-        removeDirectoryFromList(iter);
+        removeDirectoryFromList(entry);
         delete entry;
         break;
       }
@@ -519,21 +614,19 @@ void DirectoryEntry::removeDir(const std::wstring& path)
 
 bool DirectoryEntry::remove(const std::wstring& fileName, int* origin)
 {
-  const auto lcFileName = ToLowerCopy(fileName);
+  const auto index = findFileIndex(fileName, hashCaseFolded(fileName));
+  bool b           = false;
 
-  auto iter = m_Files.find(lcFileName);
-  bool b    = false;
-
-  if (iter != m_Files.end()) {
+  if (index != InvalidFileIndex) {
     if (origin != nullptr) {
-      FileEntryPtr entry = m_FileRegister->getFile(iter->second);
-      if (entry.get() != nullptr) {
+      const FileEntry* entry = m_FileRegister->fileAt(index);
+      if (entry != nullptr) {
         bool ignore;
         *origin = entry->getOrigin(ignore);
       }
     }
 
-    b = m_FileRegister->removeFile(iter->second);
+    b = m_FileRegister->removeFile(index);
   }
 
   return b;
@@ -541,7 +634,8 @@ bool DirectoryEntry::remove(const std::wstring& fileName, int* origin)
 
 bool DirectoryEntry::hasContentsFromOrigin(int originID) const
 {
-  return m_Origins.find(originID) != m_Origins.end();
+  std::scoped_lock lock(m_OriginsMutex);
+  return std::binary_search(m_Origins.begin(), m_Origins.end(), originID);
 }
 
 FilesOrigin& DirectoryEntry::createOrigin(const std::wstring& originName,
@@ -565,38 +659,34 @@ void DirectoryEntry::removeFiles(const std::set<FileIndex>& indices)
   removeFilesFromList(indices);
 }
 
-FileEntryPtr DirectoryEntry::insert(std::wstring_view fileName, FilesOrigin& origin,
-                                    FILETIME fileTime, std::wstring_view archive,
-                                    int order, DirectoryStats& stats)
+FileEntry* DirectoryEntry::insert(std::wstring_view fileName, FilesOrigin& origin,
+                                  FILETIME fileTime, std::wstring_view archive,
+                                  int order, DirectoryStats& stats)
 {
-  std::wstring fileNameLower = ToLowerCopy(fileName);
-  FileEntryPtr fe;
-
-  DirectoryEntryFileKey key(std::move(fileNameLower));
+  const auto hash = hashCaseFolded(fileName);
+  FileEntry* fe   = nullptr;
 
   {
     std::unique_lock lock(m_FilesMutex);
 
-    FilesLookup::iterator itor;
+    FileIndex index = InvalidFileIndex;
 
     elapsed(stats.filesLookupTimes, [&] {
-      itor = m_FilesLookup.find(key);
+      index = findFileIndex(fileName, hash);
     });
 
-    if (itor != m_FilesLookup.end()) {
+    if (index != InvalidFileIndex) {
       lock.unlock();
       ++stats.fileExists;
-      fe = m_FileRegister->getFile(itor->second);
+      fe = m_FileRegister->fileAt(index);
     } else {
       ++stats.fileCreate;
-      fe = m_FileRegister->createFile(std::wstring(fileName.begin(), fileName.end()),
+      fe = m_FileRegister->createFile(StringPool::instance().intern(fileName, hash),
                                       this, stats);
 
       elapsed(stats.addFileTimes, [&] {
-        addFileToList(std::move(key.value), fe->getIndex());
+        addFileToList(hash, fe->getIndex());
       });
-
-      // fileNameLower has moved from this point
     }
   }
 
@@ -611,40 +701,38 @@ FileEntryPtr DirectoryEntry::insert(std::wstring_view fileName, FilesOrigin& ori
   return fe;
 }
 
-FileEntryPtr DirectoryEntry::insert(env::File& file, FilesOrigin& origin,
-                                    std::wstring_view archive, int order,
-                                    DirectoryStats& stats)
+FileEntry* DirectoryEntry::append(env::File& file, FilesOrigin& origin,
+                                  DirectoryStats& stats)
 {
-  FileEntryPtr fe;
+  const auto hash = hashCaseFolded(file.lcname);
+  FileEntry* fe   = nullptr;
 
   {
     std::unique_lock lock(m_FilesMutex);
 
-    FilesMap::iterator itor;
+    FileIndex index = InvalidFileIndex;
 
     elapsed(stats.filesLookupTimes, [&] {
-      itor = m_Files.find(file.lcname);
+      index = findFileIndex(file.lcname, hash);
     });
 
-    if (itor != m_Files.end()) {
+    if (index != InvalidFileIndex) {
       lock.unlock();
       ++stats.fileExists;
-      fe = m_FileRegister->getFile(itor->second);
+      fe = m_FileRegister->fileAt(index);
     } else {
       ++stats.fileCreate;
-      fe = m_FileRegister->createFile(std::move(file.name), this, stats);
-      // file.name has been moved from this point
+      fe = m_FileRegister->createFile(StringPool::instance().intern(file.name, hash),
+                                      this, stats);
 
       elapsed(stats.addFileTimes, [&] {
-        addFileToList(std::move(file.lcname), fe->getIndex());
+        addFileToList(hash, fe->getIndex());
       });
-
-      // file.lcname has been moved from this point
     }
   }
 
   elapsed(stats.addOriginToFileTimes, [&] {
-    fe->addOrigin(origin.getID(), file.lastModified, archive, order);
+    fe->appendOrigin(origin.getID(), origin.getPriority(), file.lastModified);
   });
 
   elapsed(stats.addFileToOriginTimes, [&] {
@@ -659,6 +747,7 @@ struct DirectoryEntry::Context
   FilesOrigin& origin;
   DirectoryStats& stats;
   std::stack<DirectoryEntry*> current;
+  OriginFingerprint fingerprint;
 };
 
 void DirectoryEntry::addFiles(env::DirectoryWalker& walker, FilesOrigin& origin,
@@ -677,9 +766,11 @@ void DirectoryEntry::addFiles(env::DirectoryWalker& walker, FilesOrigin& origin,
         onDirectoryEnd((Context*)pcx, path);
       },
 
-      [](void* pcx, std::wstring_view path, FILETIME ft, uint64_t) {
-        onFile((Context*)pcx, path, ft);
+      [](void* pcx, std::wstring_view path, FILETIME ft, uint64_t size) {
+        onFile((Context*)pcx, path, ft, size);
       });
+
+  origin.setFingerprint(cx.fingerprint);
 }
 
 void DirectoryEntry::onDirectoryStart(Context* cx, std::wstring_view path)
@@ -690,6 +781,8 @@ void DirectoryEntry::onDirectoryStart(Context* cx, std::wstring_view path)
 
     cx->current.push(sd);
   });
+
+  cx->fingerprint.addDirectory(path);
 }
 
 void DirectoryEntry::onDirectoryEnd(Context* cx, std::wstring_view path)
@@ -697,43 +790,42 @@ void DirectoryEntry::onDirectoryEnd(Context* cx, std::wstring_view path)
   elapsed(cx->stats.dirTimes, [&] {
     cx->current.pop();
   });
+
+  cx->fingerprint.endDirectory();
 }
 
-void DirectoryEntry::onFile(Context* cx, std::wstring_view path, FILETIME ft)
+void DirectoryEntry::onFile(Context* cx, std::wstring_view path, FILETIME ft,
+                            uint64_t size)
 {
   elapsed(cx->stats.fileTimes, [&] {
     cx->current.top()->insert(path, cx->origin, ft, L"", -1, cx->stats);
   });
+
+  cx->fingerprint.addFile(path, ft, size);
 }
 
-void DirectoryEntry::addFiles(FilesOrigin& origin, const BSA::Folder::Ptr archiveFolder,
+void DirectoryEntry::addFiles(FilesOrigin& origin,
+                              const ArchiveIndex::Folder& archiveFolder,
                               FILETIME fileTime, const std::wstring& archiveName,
                               int order, DirectoryStats& stats)
 {
   // add files
-  const auto fileCount = archiveFolder->getNumFiles();
-  for (unsigned int i = 0; i < fileCount; ++i) {
-    const BSA::File::Ptr file = archiveFolder->getFile(i);
-
-    auto f = insert(ToWString(file->getName(), true), origin, fileTime, archiveName,
-                    order, stats);
+  for (auto&& file : archiveFolder.files) {
+    auto f = insert(file.name, origin, fileTime, archiveName, order, stats);
 
     if (f) {
-      if (file->getUncompressedFileSize() > 0) {
-        f->setFileSize(file->getFileSize(), file->getUncompressedFileSize());
+      if (file.uncompressedSize > 0) {
+        f->setFileSize(file.size, file.uncompressedSize);
       } else {
-        f->setFileSize(file->getFileSize(), FileEntry::NoFileSize);
+        f->setFileSize(file.size, FileEntry::NoFileSize);
       }
     }
   }
 
   // recurse into subdirectories
-  const auto dirCount = archiveFolder->getNumSubFolders();
-  for (unsigned int i = 0; i < dirCount; ++i) {
-    const BSA::Folder::Ptr folder = archiveFolder->getSubFolder(i);
-
-    DirectoryEntry* folderEntry = getSubDirectoryRecursive(
-        ToWString(folder->getName(), true), true, stats, origin.getID());
+  for (auto&& folder : archiveFolder.folders) {
+    DirectoryEntry* folderEntry =
+        getSubDirectoryRecursive(folder.name, true, stats, origin.getID());
 
     folderEntry->addFiles(origin, folder, fileTime, archiveName, order, stats);
   }
@@ -742,29 +834,35 @@ void DirectoryEntry::addFiles(FilesOrigin& origin, const BSA::Folder::Ptr archiv
 DirectoryEntry* DirectoryEntry::getSubDirectory(std::wstring_view name, bool create,
                                                 DirectoryStats& stats, int originID)
 {
-  std::wstring nameLc = ToLowerCopy(name);
+  const auto hash = hashCaseFolded(name);
 
   std::scoped_lock lock(m_SubDirMutex);
 
-  SubDirectoriesLookup::iterator itor;
+  DirectoryEntry* existing = nullptr;
   elapsed(stats.subdirLookupTimes, [&] {
-    itor = m_SubDirectoriesLookup.find(nameLc);
+    existing = lookupSubDirectory(name, hash);
   });
 
-  if (itor != m_SubDirectoriesLookup.end()) {
+  if (existing) {
     ++stats.subdirExists;
-    return itor->second;
+
+    // directories can exist in several origins even when they're empty, they
+    // only go away once none of them has it anymore
+    if (originID != InvalidOriginID) {
+      existing->addOrigin(originID);
+    }
+
+    return existing;
   }
 
   if (create) {
     ++stats.subdirCreate;
 
-    auto* entry = new DirectoryEntry(std::wstring(name.begin(), name.end()), this,
-                                     originID, m_FileRegister, m_OriginConnection);
+    auto* entry = new DirectoryEntry(name, this, originID, m_FileRegister,
+                                     m_OriginConnection);
 
     elapsed(stats.addDirectoryTimes, [&] {
-      addDirectoryToList(entry, std::move(nameLc));
-      // nameLc is moved from this point
+      addDirectoryToList(entry, hash);
     });
 
     return entry;
@@ -776,32 +874,37 @@ DirectoryEntry* DirectoryEntry::getSubDirectory(std::wstring_view name, bool cre
 DirectoryEntry* DirectoryEntry::getSubDirectory(env::Directory& dir, bool create,
                                                 DirectoryStats& stats, int originID)
 {
-  SubDirectoriesLookup::iterator itor;
+  const auto hash = hashCaseFolded(dir.lcname);
 
   std::scoped_lock lock(m_SubDirMutex);
 
+  DirectoryEntry* existing = nullptr;
   elapsed(stats.subdirLookupTimes, [&] {
-    itor = m_SubDirectoriesLookup.find(dir.lcname);
+    existing = lookupSubDirectory(dir.lcname, hash);
   });
 
-  if (itor != m_SubDirectoriesLookup.end()) {
+  if (existing) {
     ++stats.subdirExists;
-    return itor->second;
+
+    // directories can exist in several origins even when they're empty, they
+    // only go away once none of them has it anymore
+    if (originID != InvalidOriginID) {
+      existing->addOrigin(originID);
+    }
+
+    return existing;
   }
 
   if (create) {
     ++stats.subdirCreate;
 
-    auto* entry = new DirectoryEntry(std::move(dir.name), this, originID,
-                                     m_FileRegister, m_OriginConnection);
-    // dir.name is moved from this point
+    auto* entry = new DirectoryEntry(dir.name, this, originID, m_FileRegister,
+                                     m_OriginConnection);
 
     elapsed(stats.addDirectoryTimes, [&] {
-      addDirectoryToList(entry, std::move(dir.lcname));
+      addDirectoryToList(entry, hash);
     });
 
-    // dir.lcname is moved from this point
-
     return entry;
   } else {
     return nullptr;
@@ -821,7 +924,7 @@ DirectoryEntry* DirectoryEntry::getSubDirectoryRecursive(const std::wstring& pat
   const size_t pos = path.find_first_of(L"\\/");
 
   if (pos == std::wstring::npos) {
-    return getSubDirectory(path, create, stats);
+    return getSubDirectory(path, create, stats, originID);
   } else {
     DirectoryEntry* nextChild =
         getSubDirectory(path.substr(0, pos), create, stats, originID);
@@ -837,98 +940,68 @@ DirectoryEntry* DirectoryEntry::getSubDirectoryRecursive(const std::wstring& pat
 
 void DirectoryEntry::removeDirRecursive()
 {
-  while (!m_Files.empty()) {
-    m_FileRegister->removeFile(m_Files.begin()->second);
+  // removed in one go, the index of this directory is only rebuilt once
+  if (!m_Files.empty()) {
+    const auto files = m_Files.values();
+    m_FileRegister->removeFiles(std::set<FileIndex>(files.begin(), files.end()));
   }
 
-  m_FilesLookup.clear();
-
-  for (DirectoryEntry* entry : m_SubDirectories) {
+  for (DirectoryEntry* entry : m_SubDirectories.values()) {
     entry->removeDirRecursive();
     delete entry;
   }
 
   m_SubDirectories.clear();
-  m_SubDirectoriesLookup.clear();
 }
 
-void DirectoryEntry::addDirectoryToList(DirectoryEntry* e, std::wstring nameLc)
+void DirectoryEntry::addDirectoryToList(DirectoryEntry* e, std::size_t hash)
 {
-  m_SubDirectories.insert(e);
-  m_SubDirectoriesLookup.emplace(std::move(nameLc), e);
+  m_SubDirectories.add(hash, e, DirCompareByName());
 }
 
-void DirectoryEntry::removeDirectoryFromList(SubDirectories::iterator itor)
+void DirectoryEntry::removeDirectoryFromList(DirectoryEntry* e)
 {
-  const auto* entry = *itor;
-
-  {
-    auto itor2 = std::find_if(m_SubDirectoriesLookup.begin(),
-                              m_SubDirectoriesLookup.end(), [&](auto&& d) {
-                                return (d.second == entry);
-                              });
+  const bool removed = m_SubDirectories.removeOne([&](const DirectoryEntry* d) {
+    return (d == e);
+  });
 
-    if (itor2 == m_SubDirectoriesLookup.end()) {
-      log::error("entry {} not in sub directories map", entry->getName());
-    } else {
-      m_SubDirectoriesLookup.erase(itor2);
-    }
+  if (!removed) {
+    log::error("entry {} not in sub directories map", e->getName());
   }
-
-  m_SubDirectories.erase(itor);
 }
 
 void DirectoryEntry::removeFileFromList(FileIndex index)
 {
-  auto removeFrom = [&](auto& list) {
-    auto iter = std::find_if(list.begin(), list.end(), [&index](auto&& pair) {
-      return (pair.second == index);
-    });
+  const bool removed = m_Files.removeOne([&](FileIndex i) {
+    return (i == index);
+  });
 
-    if (iter == list.end()) {
-      auto f = m_FileRegister->getFile(index);
+  if (!removed) {
+    auto f = m_FileRegister->getFile(index);
 
-      if (f) {
-        log::error("can't remove file '{}', not in directory entry '{}'", f->getName(),
-                   getName());
-      } else {
-        log::error("can't remove file with index {}, not in directory entry '{}' and "
-                   "not in register",
-                   index, getName());
-      }
+    if (f) {
+      log::error("can't remove file '{}', not in directory entry '{}'", f->getName(),
+                 getName());
     } else {
-      list.erase(iter);
+      log::error("can't remove file with index {}, not in directory entry '{}' and "
+                 "not in register",
+                 index, getName());
     }
-  };
-
-  removeFrom(m_FilesLookup);
-  removeFrom(m_Files);
+  }
 }
 
 void DirectoryEntry::removeFilesFromList(const std::set<FileIndex>& indices)
 {
-  for (auto iter = m_Files.begin(); iter != m_Files.end();) {
-    if (indices.find(iter->second) != indices.end()) {
-      iter = m_Files.erase(iter);
-    } else {
-      ++iter;
-    }
-  }
-
-  for (auto iter = m_FilesLookup.begin(); iter != m_FilesLookup.end();) {
-    if (indices.find(iter->second) != indices.end()) {
-      iter = m_FilesLookup.erase(iter);
-    } else {
-      ++iter;
-    }
-  }
+  m_Files.removeIf([&](FileIndex i) {
+    return indices.contains(i);
+  });
 }
 
-void DirectoryEntry::addFileToList(std::wstring fileNameLower, FileIndex index)
+void DirectoryEntry::addFileToList(std::size_t hash, FileIndex index)
 {
-  m_FilesLookup.emplace(fileNameLower, index);
-  m_Files.emplace(std::move(fileNameLower), index);
-  // fileNameLower has been moved from this point
+  m_Files.add(hash, index, [&](FileIndex a, FileIndex b) {
+    return fileNameLess(a, b);
+  });
 }
 
 struct DumpFailed : public std::runtime_error
@@ -962,8 +1035,8 @@ void DirectoryEntry::dump(std::FILE* f, const std::wstring& parentPath) const
   {
     std::scoped_lock lock(m_FilesMutex);
 
-    for (auto&& index : m_Files) {
-      const auto file = m_FileRegister->getFile(index.second);
+    for (auto index : m_Files.values()) {
+      const auto* file = m_FileRegister->fileAt(index);
       if (!file) {
         continue;
       }
@@ -988,8 +1061,8 @@ void DirectoryEntry::dump(std::FILE* f, const std::wstring& parentPath) const
 
   {
     std::scoped_lock lock(m_SubDirMutex);
-    for (auto&& d : m_SubDirectories) {
-      const auto path = parentPath + L"\\" + d->m_Name;
+    for (auto* d : m_SubDirectories.values()) {
+      const auto path = parentPath + L"\\" + d->getName();
       d->dump(f, path);
     }
   }
@@ -20,7 +20,11 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #ifndef MO_REGISTER_DIRECTORYENTRY_INCLUDED
 #define MO_REGISTER_DIRECTORYENTRY_INCLUDED
 
+#include "../thread_utils.h"
+#include "archiveindex.h"
 #include "fileregister.h"
+#include "flatindex.h"
+#include "originconnection.h"
 #include <bsatk.h>
 
 namespace env
@@ -50,14 +54,16 @@ struct DirCompareByName
   bool operator()(const DirectoryEntry* a, const DirectoryEntry* b) const;
 };
 
+// files and subdirectories are kept in flat indices that are appended to while
+// the structure is built; freeze() sorts them by name and releases unused
+// memory once it's done, which cleanStructure() does after every change
+//
 class DirectoryEntry
 {
 public:
-  using SubDirectories = std::set<DirectoryEntry*, DirCompareByName>;
+  DirectoryEntry(std::wstring_view name, DirectoryEntry* parent, OriginID originID);
 
-  DirectoryEntry(std::wstring name, DirectoryEntry* parent, OriginID originID);
-
-  DirectoryEntry(std::wstring name, DirectoryEntry* parent, OriginID originID,
+  DirectoryEntry(std::wstring_view name, DirectoryEntry* parent, OriginID originID,
                  boost::shared_ptr<FileRegister> fileRegister,
                  boost::shared_ptr<OriginConnection> originConnection);
 
@@ -77,6 +83,16 @@ public:
 
   bool hasFiles() const { return !m_Files.empty(); }
 
+  // sorts files and subdirectories by name and trims the memory used by this
+  // directory and all its subdirectories
+  //
+  void freeze();
+
+  // bytes allocated for the files and subdirectories indices of this directory
+  // and all its subdirectories, not including the entries themselves
+  //
+  std::size_t indexMemoryUsage() const;
+
   const DirectoryEntry* getParent() const { return m_Parent; }
 
   // add files to this directory (and subdirectories) from the specified origin.
@@ -92,7 +108,32 @@ public:
                       int priority, const std::vector<std::wstring>& archives,
                       const std::set<std::wstring>& enabledArchives,
                       const std::vector<std::wstring>& loadOrder,
-                      DirectoryStats& stats);
+                      const ArchiveIndexCache& cache, DirectoryStats& stats);
+
+  // an archive that has been read by readBSAs(), but not added yet
+  //
+  struct LoadedBSA
+  {
+    std::wstring name;
+    int order;
+    ArchiveIndex index;
+  };
+
+  // reads the archives that addFromAllBSAs() would add without touching any
+  // structure, can be called from any thread; errors are logged and the
+  // archive is skipped
+  //
+  static std::vector<LoadedBSA> readBSAs(const std::wstring& directory,
+                                         const std::vector<std::wstring>& archives,
+                                         const std::set<std::wstring>& enabledArchives,
+                                         const std::vector<std::wstring>& loadOrder,
+                                         const ArchiveIndexCache& cache);
+
+  // adds archives returned by readBSAs()
+  //
+  void addFromBSAs(const std::wstring& originName, const std::wstring& directory,
+                   int priority, const std::vector<LoadedBSA>& archives,
+                   DirectoryStats& stats);
 
   void addFromBSA(const std::wstring& originName, const std::wstring& directory,
                   const std::wstring& archivePath, int priority, int order,
@@ -103,7 +144,13 @@ public:
 
   void propagateOrigin(OriginID origin);
 
-  const std::wstring& getName() const { return m_Name; }
+  // forgets the given origins in this directory and all its subdirectories,
+  // then deletes the subdirectories that are left without files, subdirectories
+  // or origins; a full refresh would not have created them
+  //
+  void removeOrigins(const std::set<OriginID>& origins);
+
+  const std::wstring& getName() const { return m_Name.str(); }
 
   boost::shared_ptr<FileRegister> getFileRegister() { return m_FileRegister; }
 
@@ -112,16 +159,34 @@ public:
   FilesOrigin& getOriginByName(const std::wstring& name) const;
   const FilesOrigin* findOriginByID(OriginID ID) const;
 
+  // same as getOriginByID(ID).getPriority(), without locking
+  //
+  int getOriginPriority(OriginID ID) const
+  {
+    return m_OriginConnection->getPriority(ID);
+  }
+
+  // calls f(FilesOrigin&) for every origin known to this structure, including
+  // disabled ones
+  //
+  template <class F>
+  void forEachOrigin(F&& f) const
+  {
+    m_OriginConnection->forEachOrigin(std::forward<F>(f));
+  }
+
   OriginID anyOrigin() const;
 
   std::vector<FileEntryPtr> getFiles() const;
 
-  const SubDirectories& getSubDirectories() const { return m_SubDirectories; }
+  // range of DirectoryEntry*
+  //
+  auto getSubDirectories() const { return m_SubDirectories.values(); }
 
   template <class F>
   void forEachDirectory(F&& f) const
   {
-    for (auto&& d : m_SubDirectories) {
+    for (auto* d : m_SubDirectories.values()) {
       if (!f(*d)) {
         break;
       }
@@ -131,8 +196,8 @@ public:
   template <class F>
   void forEachFile(F&& f) const
   {
-    for (auto&& p : m_Files) {
-      if (auto file = m_FileRegister->getFile(p.second)) {
+    for (auto index : m_Files.values()) {
+      if (auto* file = m_FileRegister->fileAt(index)) {
         if (!f(*file)) {
           break;
         }
@@ -143,8 +208,8 @@ public:
   template <class F>
   void forEachFileIndex(F&& f) const
   {
-    for (auto&& p : m_Files) {
-      if (!f(p.second)) {
+    for (auto index : m_Files.values()) {
+      if (!f(index)) {
         break;
       }
     }
@@ -205,39 +270,48 @@ public:
   void dump(const std::wstring& file) const;
 
 private:
-  using FilesMap             = std::map<std::wstring, FileIndex>;
-  using FilesLookup          = std::unordered_map<DirectoryEntryFileKey, FileIndex>;
-  using SubDirectoriesLookup = std::unordered_map<std::wstring, DirectoryEntry*>;
+  friend class DirectorySnapshot;
 
   boost::shared_ptr<FileRegister> m_FileRegister;
   boost::shared_ptr<OriginConnection> m_OriginConnection;
 
-  std::wstring m_Name;
-  FilesMap m_Files;
-  FilesLookup m_FilesLookup;
-  SubDirectories m_SubDirectories;
-  SubDirectoriesLookup m_SubDirectoriesLookup;
+  PooledString m_Name;
+  FlatIndex<FileIndex> m_Files;
+  FlatIndex<DirectoryEntry*> m_SubDirectories;
 
   DirectoryEntry* m_Parent;
-  std::set<OriginID> m_Origins;
+
+  // sorted
+  std::vector<OriginID> m_Origins;
+
   bool m_Populated;
   bool m_TopLevel;
-  mutable std::mutex m_SubDirMutex;
-  mutable std::mutex m_FilesMutex;
-  mutable std::mutex m_OriginsMutex;
+  mutable CompactMutex m_SubDirMutex;
+  mutable CompactMutex m_FilesMutex;
+  mutable CompactMutex m_OriginsMutex;
 
-  FileEntryPtr insert(std::wstring_view fileName, FilesOrigin& origin,
-                      FILETIME fileTime, std::wstring_view archive, int order,
-                      DirectoryStats& stats);
+  // both take any case and a hash from hashCaseFolded()
+  FileIndex findFileIndex(std::wstring_view name, std::size_t hash) const;
+  DirectoryEntry* lookupSubDirectory(std::wstring_view name, std::size_t hash) const;
 
-  FileEntryPtr insert(env::File& file, FilesOrigin& origin, std::wstring_view archive,
-                      int order, DirectoryStats& stats);
+  bool fileNameLess(FileIndex a, FileIndex b) const;
+  void addOrigin(OriginID origin);
+
+  FileEntry* insert(std::wstring_view fileName, FilesOrigin& origin,
+                    FILETIME fileTime, std::wstring_view archive, int order,
+                    DirectoryStats& stats);
+
+  // adds a loose file with FileEntry::appendOrigin(), the origin must already
+  // have been propagated to this directory
+  //
+  FileEntry* append(env::File& file, FilesOrigin& origin, DirectoryStats& stats);
 
   void addFiles(env::DirectoryWalker& walker, FilesOrigin& origin,
                 const std::wstring& path, DirectoryStats& stats);
 
-  void addFiles(FilesOrigin& origin, BSA::Folder::Ptr archiveFolder, FILETIME fileTime,
-                const std::wstring& archiveName, int order, DirectoryStats& stats);
+  void addFiles(FilesOrigin& origin, const ArchiveIndex::Folder& archiveFolder,
+                FILETIME fileTime, const std::wstring& archiveName, int order,
+                DirectoryStats& stats);
 
   void addDir(FilesOrigin& origin, env::Directory& d, DirectoryStats& stats);
 
@@ -255,17 +329,18 @@ private:
 
   void removeDirRecursive();
 
-  void addDirectoryToList(DirectoryEntry* e, std::wstring nameLc);
-  void removeDirectoryFromList(SubDirectories::iterator itor);
+  void addDirectoryToList(DirectoryEntry* e, std::size_t hash);
+  void removeDirectoryFromList(DirectoryEntry* e);
 
-  void addFileToList(std::wstring fileNameLower, FileIndex index);
+  void addFileToList(std::size_t hash, FileIndex index);
   void removeFileFromList(FileIndex index);
   void removeFilesFromList(const std::set<FileIndex>& indices);
 
   struct Context;
   static void onDirectoryStart(Context* cx, std::wstring_view path);
   static void onDirectoryEnd(Context* cx, std::wstring_view path);
-  static void onFile(Context* cx, std::wstring_view path, FILETIME ft);
+  static void onFile(Context* cx, std::wstring_view path, FILETIME ft,
+                     uint64_t size);
 
   void dump(std::FILE* f, const std::wstring& parentPath) const;
 };
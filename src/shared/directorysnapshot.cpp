@@ -0,0 +1,551 @@
+#include "directorysnapshot.h"
+#include "directoryentry.h"
+#include "fileentry.h"
+#include "filesorigin.h"
+#include "originconnection.h"
+#include "util.h"
+#include <log.h>
+#include <utility.h>
+
+#include <QFile>
+
+namespace MOShared
+{
+
+using namespace MOBase;
+
+namespace
+{
+
+constexpr char SnapshotMagic[4]   = {'M', 'O', 'D', 'S'};
+constexpr uint32_t SnapshotVersion = 2;
+constexpr uint32_t NoIndex         = std::numeric_limits<uint32_t>::max();
+
+// the file is:
+//  - the header,
+//  - stringCount + 1 offsets into the characters, followed by the characters
+//    of all strings, without null terminators,
+//  - tagCount string indices,
+//  - originCount origins, ordered by id,
+//  - dirCount directories, parents always come before their children and the
+//    first one is the root,
+//  - dirOriginCount origin ids referenced by the directories,
+//  - fileCount files,
+//  - altCount alternatives referenced by the files
+//
+// each section starts on an 8 byte boundary
+
+struct Header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t stringCount;
+  uint32_t charCount;
+  uint32_t tagCount;
+  uint32_t originCount;
+  uint32_t dirCount;
+  uint32_t dirOriginCount;
+  uint32_t fileCount;
+  uint32_t altCount;
+};
+
+struct OriginRecord
+{
+  uint64_t fingerprintHash;
+  uint64_t fingerprintFileCount;
+  uint64_t fingerprintTotalSize;
+  uint32_t name;
+  uint32_t path;
+  int32_t priority;
+  uint32_t disabled;
+};
+
+struct DirRecord
+{
+  uint32_t name;
+  uint32_t parent;
+  uint32_t firstOrigin;
+  uint32_t originCount;
+};
+
+struct FileRecord
+{
+  uint64_t size;
+  uint64_t compressedSize;
+  FILETIME time;
+  uint32_t name;
+  uint32_t dir;
+  int32_t origin;
+  uint32_t archive;
+  int32_t order;
+  uint32_t firstAlt;
+  uint32_t altCount;
+  uint32_t unused;
+};
+
+struct AltRecord
+{
+  int32_t origin;
+  uint32_t archive;
+  int32_t order;
+  uint32_t unused;
+};
+
+static_assert(sizeof(Header) % 8 == 0);
+static_assert(sizeof(OriginRecord) % 8 == 0);
+static_assert(sizeof(FileRecord) % 8 == 0);
+
+struct InvalidSnapshot : public std::runtime_error
+{
+  using runtime_error::runtime_error;
+};
+
+// bounds-checked sequential access to the mapped file
+//
+class Reader
+{
+public:
+  Reader(const unsigned char* data, std::size_t size)
+      : m_Data(data), m_Size(size), m_Pos(0)
+  {}
+
+  template <class T>
+  const T* get(std::size_t count)
+  {
+    const std::size_t bytes = count * sizeof(T);
+
+    if (bytes > m_Size - m_Pos) {
+      throw InvalidSnapshot("file is truncated");
+    }
+
+    const auto* p = reinterpret_cast<const T*>(m_Data + m_Pos);
+    m_Pos += bytes;
+
+    return p;
+  }
+
+  void align() { m_Pos = std::min(m_Size, (m_Pos + 7) & ~std::size_t(7)); }
+
+private:
+  const unsigned char* m_Data;
+  std::size_t m_Size;
+  std::size_t m_Pos;
+};
+
+}  // namespace
+
+struct DirectorySnapshot::Writer
+{
+  std::vector<uint32_t> offsets = {0};
+  std::vector<wchar_t> chars;
+  std::unordered_map<std::wstring, uint32_t> stringLookup;
+
+  std::vector<uint32_t> tags;
+  std::vector<OriginRecord> origins;
+  std::vector<DirRecord> dirs;
+  std::vector<int32_t> dirOrigins;
+  std::vector<FileRecord> files;
+  std::vector<AltRecord> alts;
+
+  uint32_t string(const std::wstring& s)
+  {
+    auto [itor, inserted] =
+        stringLookup.emplace(s, static_cast<uint32_t>(offsets.size() - 1));
+
+    if (inserted) {
+      chars.insert(chars.end(), s.begin(), s.end());
+      offsets.push_back(static_cast<uint32_t>(chars.size()));
+    }
+
+    return itor->second;
+  }
+};
+
+void DirectorySnapshot::addDirectory(Writer& w, const DirectoryEntry& d,
+                                     uint32_t parent)
+{
+  const auto index = static_cast<uint32_t>(w.dirs.size());
+
+  w.dirs.push_back({w.string(d.getName()), parent,
+                    static_cast<uint32_t>(w.dirOrigins.size()),
+                    static_cast<uint32_t>(d.m_Origins.size())});
+
+  w.dirOrigins.insert(w.dirOrigins.end(), d.m_Origins.begin(), d.m_Origins.end());
+
+  d.forEachFile([&](const FileEntry& f) {
+    FileRecord r = {};
+
+    r.size           = f.getFileSize();
+    r.compressedSize = f.getCompressedFileSize();
+    r.time           = f.getFileTime();
+    r.name           = w.string(f.getName());
+    r.dir            = index;
+    r.origin         = f.getOrigin();
+    r.archive        = w.string(f.getArchive().name());
+    r.order          = f.getArchive().order();
+    r.firstAlt       = static_cast<uint32_t>(w.alts.size());
+    r.altCount       = static_cast<uint32_t>(f.getAlternatives().size());
+
+    for (auto&& alt : f.getAlternatives()) {
+      w.alts.push_back({alt.originID(), w.string(alt.archive().name()),
+                        alt.archive().order(), 0});
+    }
+
+    w.files.push_back(r);
+    return true;
+  });
+
+  for (auto* sd : d.m_SubDirectories.values()) {
+    addDirectory(w, *sd, index);
+  }
+}
+
+DirectorySnapshot::DirectorySnapshot()                                        = default;
+DirectorySnapshot::DirectorySnapshot(DirectorySnapshot&&) noexcept            = default;
+DirectorySnapshot& DirectorySnapshot::operator=(DirectorySnapshot&&) noexcept = default;
+DirectorySnapshot::~DirectorySnapshot()                                       = default;
+
+bool DirectorySnapshot::empty() const
+{
+  return !m_Data;
+}
+
+DirectorySnapshot DirectorySnapshot::capture(const DirectoryEntry& root,
+                                             const Tags& tags)
+{
+  auto w = std::make_unique<Writer>();
+
+  for (auto&& t : tags) {
+    w->tags.push_back(w->string(t));
+  }
+
+  bool contiguous = true;
+
+  root.forEachOrigin([&](const FilesOrigin& o) {
+    if (o.getID() != static_cast<OriginID>(w->origins.size())) {
+      contiguous = false;
+    }
+
+    const auto& fp = o.fingerprint();
+
+    w->origins.push_back({fp.hash(), fp.fileCount(), fp.totalSize(),
+                          w->string(o.getName()), w->string(o.getPath()),
+                          o.getPriority(), o.isDisabled() ? 1u : 0u});
+  });
+
+  if (!contiguous) {
+    // ids are given back as the origins are created when loading
+    log::error("can't save directory snapshot, origin ids are not contiguous");
+    return {};
+  }
+
+  addDirectory(*w, root, NoIndex);
+
+  // the lookup is only needed while strings are added
+  w->stringLookup = {};
+
+  DirectorySnapshot snapshot;
+  snapshot.m_Data = std::move(w);
+
+  return snapshot;
+}
+
+bool DirectorySnapshot::write(const std::wstring& path) const
+{
+  if (!m_Data) {
+    return false;
+  }
+
+  const Writer& w = *m_Data;
+
+  Header h = {};
+  std::memcpy(h.magic, SnapshotMagic, sizeof(h.magic));
+  h.version        = SnapshotVersion;
+  h.stringCount    = static_cast<uint32_t>(w.offsets.size() - 1);
+  h.charCount      = static_cast<uint32_t>(w.chars.size());
+  h.tagCount       = static_cast<uint32_t>(w.tags.size());
+  h.originCount    = static_cast<uint32_t>(w.origins.size());
+  h.dirCount       = static_cast<uint32_t>(w.dirs.size());
+  h.dirOriginCount = static_cast<uint32_t>(w.dirOrigins.size());
+  h.fileCount      = static_cast<uint32_t>(w.files.size());
+  h.altCount       = static_cast<uint32_t>(w.alts.size());
+
+  // written to a temporary file first so a crash never leaves a truncated
+  // snapshot behind
+  const std::wstring temp = path + L".tmp";
+
+  std::FILE* f = nullptr;
+  auto e       = _wfopen_s(&f, temp.c_str(), L"wb");
+
+  if (e != 0 || !f) {
+    log::error("failed to open '{}' for writing, {} ({})", temp, std::strerror(e), e);
+    return false;
+  }
+
+  std::size_t written = 0;
+  bool ok             = true;
+
+  auto write = [&](const void* data, std::size_t size) {
+    if (ok && size > 0 && std::fwrite(data, size, 1, f) != 1) {
+      ok = false;
+    }
+
+    written += size;
+  };
+
+  auto align = [&] {
+    static const char zeroes[8] = {};
+    write(zeroes, ((written + 7) & ~std::size_t(7)) - written);
+  };
+
+  auto writeVector = [&](const auto& v) {
+    write(v.data(), v.size() * sizeof(v[0]));
+    align();
+  };
+
+  write(&h, sizeof(h));
+  write(w.offsets.data(), w.offsets.size() * sizeof(uint32_t));
+  writeVector(w.chars);
+  writeVector(w.tags);
+  writeVector(w.origins);
+  writeVector(w.dirs);
+  writeVector(w.dirOrigins);
+  writeVector(w.files);
+  writeVector(w.alts);
+
+  if (std::fclose(f) != 0) {
+    ok = false;
+  }
+
+  if (!ok) {
+    const auto e = errno;
+    log::error("failed to write '{}', {} ({})", temp, std::strerror(e), e);
+    ::DeleteFileW(temp.c_str());
+    return false;
+  }
+
+  if (!::MoveFileExW(temp.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+    const auto e = ::GetLastError();
+    log::error("failed to rename '{}' to '{}', {}", temp, path, formatSystemMessage(e));
+    ::DeleteFileW(temp.c_str());
+    return false;
+  }
+
+  log::debug("saved directory snapshot, {} directories, {} files, {} bytes",
+             w.dirs.size(), w.files.size(), written);
+
+  return true;
+}
+
+std::unique_ptr<DirectoryEntry> DirectorySnapshot::load(const std::wstring& path,
+                                                        Tags& tags)
+{
+  QFile file(QString::fromStdWString(path));
+
+  if (!file.exists()) {
+    return {};
+  }
+
+  if (!file.open(QIODevice::ReadOnly)) {
+    log::error("failed to open directory snapshot '{}', {}", path, file.errorString());
+    return {};
+  }
+
+  const auto size   = static_cast<std::size_t>(file.size());
+  const uchar* data = file.map(0, file.size());
+
+  if (!data) {
+    log::error("failed to map directory snapshot '{}', {}", path, file.errorString());
+    return {};
+  }
+
+  try {
+    return load(data, size, tags);
+  } catch (InvalidSnapshot& e) {
+    log::warn("ignoring directory snapshot '{}': {}", path, e.what());
+    tags.clear();
+    return {};
+  }
+}
+
+std::unique_ptr<DirectoryEntry>
+DirectorySnapshot::load(const unsigned char* data, std::size_t size, Tags& tags)
+{
+  Reader r(data, size);
+
+  const auto* h = r.get<Header>(1);
+
+  if (std::memcmp(h->magic, SnapshotMagic, sizeof(h->magic)) != 0) {
+    throw InvalidSnapshot("bad magic");
+  }
+
+  if (h->version != SnapshotVersion) {
+    throw InvalidSnapshot(std::format("unsupported version {}", h->version));
+  }
+
+  const auto* offsets = r.get<uint32_t>(std::size_t(h->stringCount) + 1);
+  const auto* chars   = r.get<wchar_t>(h->charCount);
+  r.align();
+  const auto* tagIndices = r.get<uint32_t>(h->tagCount);
+  r.align();
+  const auto* origins = r.get<OriginRecord>(h->originCount);
+  r.align();
+  const auto* dirs = r.get<DirRecord>(h->dirCount);
+  r.align();
+  const auto* dirOrigins = r.get<int32_t>(h->dirOriginCount);
+  r.align();
+  const auto* files = r.get<FileRecord>(h->fileCount);
+  r.align();
+  const auto* alts = r.get<AltRecord>(h->altCount);
+
+  auto str = [&](uint32_t i) {
+    if (i >= h->stringCount || offsets[i] > offsets[i + 1] ||
+        offsets[i + 1] > h->charCount) {
+      throw InvalidSnapshot(std::format("bad string index {}", i));
+    }
+
+    return std::wstring_view(chars + offsets[i], offsets[i + 1] - offsets[i]);
+  };
+
+  // names and archives are repeated a lot, each string from the table is only
+  // interned once
+  std::vector<PooledString> pooledStrings(h->stringCount);
+  std::vector<bool> interned(h->stringCount);
+
+  auto pooled = [&](uint32_t i) {
+    const auto s = str(i);
+
+    if (!interned[i]) {
+      pooledStrings[i] = StringPool::instance().intern(s);
+      interned[i]      = true;
+    }
+
+    return pooledStrings[i];
+  };
+
+  auto checkOrigin = [&](int32_t id) {
+    if (id < 0 || static_cast<uint32_t>(id) >= h->originCount) {
+      throw InvalidSnapshot(std::format("bad origin id {}", id));
+    }
+
+    return id;
+  };
+
+  tags.clear();
+  for (uint32_t i = 0; i < h->tagCount; ++i) {
+    tags.emplace_back(str(tagIndices[i]));
+  }
+
+  if (h->dirCount == 0 || dirs[0].parent != NoIndex) {
+    throw InvalidSnapshot("missing root");
+  }
+
+  auto root = std::make_unique<DirectoryEntry>(L"data", nullptr, 0);
+  DirectoryStats dummy;
+
+  // origins, their ids are given in creation order
+  std::vector<FilesOrigin*> originList;
+
+  for (uint32_t i = 0; i < h->originCount; ++i) {
+    const auto& rec = origins[i];
+
+    FilesOrigin& o = root->createOrigin(std::wstring(str(rec.name)),
+                                        std::wstring(str(rec.path)), rec.priority,
+                                        dummy);
+
+    if (o.getID() != static_cast<OriginID>(i)) {
+      throw InvalidSnapshot("origin ids are not contiguous");
+    }
+
+    o.setFingerprint(OriginFingerprint(rec.fingerprintHash, rec.fingerprintFileCount,
+                                       rec.fingerprintTotalSize));
+
+    if (rec.disabled) {
+      o.enable(false);
+    }
+
+    originList.push_back(&o);
+  }
+
+  // directories
+  std::vector<DirectoryEntry*> dirList(h->dirCount);
+  dirList[0] = root.get();
+
+  for (uint32_t i = 0; i < h->dirCount; ++i) {
+    const auto& rec = dirs[i];
+
+    if (i > 0) {
+      if (rec.parent >= i) {
+        throw InvalidSnapshot(std::format("bad parent for directory {}", i));
+      }
+
+      DirectoryEntry* parent = dirList[rec.parent];
+      const auto name        = str(rec.name);
+
+      auto* d = new DirectoryEntry(name, parent, InvalidOriginID,
+                                   parent->m_FileRegister, parent->m_OriginConnection);
+
+      parent->addDirectoryToList(d, hashCaseFolded(name));
+      dirList[i] = d;
+    }
+
+    if (rec.firstOrigin > h->dirOriginCount ||
+        rec.originCount > h->dirOriginCount - rec.firstOrigin) {
+      throw InvalidSnapshot(std::format("bad origins for directory {}", i));
+    }
+
+    auto& list = dirList[i]->m_Origins;
+    list.assign(dirOrigins + rec.firstOrigin,
+                dirOrigins + rec.firstOrigin + rec.originCount);
+
+    std::sort(list.begin(), list.end());
+    list.erase(std::unique(list.begin(), list.end()), list.end());
+  }
+
+  // files
+  auto fileRegister = root->getFileRegister();
+
+  for (uint32_t i = 0; i < h->fileCount; ++i) {
+    const auto& rec = files[i];
+
+    if (rec.dir >= h->dirCount) {
+      throw InvalidSnapshot(std::format("bad directory for file {}", i));
+    }
+
+    if (rec.firstAlt > h->altCount || rec.altCount > h->altCount - rec.firstAlt) {
+      throw InvalidSnapshot(std::format("bad alternatives for file {}", i));
+    }
+
+    DirectoryEntry* dir = dirList[rec.dir];
+
+    FileEntry* fe    = fileRegister->createFile(pooled(rec.name), dir, dummy);
+    const auto index = fe->getIndex();
+
+    fe->m_Origin   = checkOrigin(rec.origin);
+    fe->m_Archive  = DataArchiveOrigin(pooled(rec.archive), rec.order);
+    fe->m_FileTime = rec.time;
+    fe->m_FileSize           = rec.size;
+    fe->m_CompressedFileSize = rec.compressedSize;
+
+    originList[rec.origin]->addFile(index);
+
+    for (uint32_t j = 0; j < rec.altCount; ++j) {
+      const auto& alt = alts[rec.firstAlt + j];
+
+      fe->m_Alternatives.push_back(
+          {checkOrigin(alt.origin),
+           DataArchiveOrigin(pooled(alt.archive), alt.order)});
+
+      originList[alt.origin]->addFile(index);
+    }
+
+    dir->addFileToList(fe->getPooledName().foldedHash(), index);
+  }
+
+  root->m_Populated = true;
+  root->freeze();
+
+  return root;
+}
+
+}  // namespace MOShared
@@ -0,0 +1,62 @@
+#ifndef MO_REGISTER_DIRECTORYSNAPSHOT_INCLUDED
+#define MO_REGISTER_DIRECTORYSNAPSHOT_INCLUDED
+
+#include "fileregisterfwd.h"
+
+namespace MOShared
+{
+
+// compact binary copy of a whole directory structure: a string table followed
+// by flat arrays of origins, directories, files and alternatives that refer to
+// each other by index
+//
+// the file is memory mapped when loading and the structure is rebuilt directly
+// from it, without walking any directory or parsing any archive; origins keep
+// their fingerprints, so the caller can check which of them are still valid
+//
+class DirectorySnapshot
+{
+public:
+  // arbitrary strings saved along with the structure, used by the caller to
+  // check whether the snapshot was made with the same global state
+  //
+  using Tags = std::vector<std::wstring>;
+
+  // serializes the given structure in memory; the snapshot is empty if the
+  // structure can't be saved, which is logged
+  //
+  static DirectorySnapshot capture(const DirectoryEntry& root, const Tags& tags);
+
+  DirectorySnapshot();
+  DirectorySnapshot(DirectorySnapshot&&) noexcept;
+  DirectorySnapshot& operator=(DirectorySnapshot&&) noexcept;
+  ~DirectorySnapshot();
+
+  // whether capture() failed
+  //
+  bool empty() const;
+
+  // writes a captured snapshot to the given file, returns false on errors,
+  // which are logged; this doesn't touch the structure anymore, so it can run on
+  // any thread while the structure is used
+  //
+  bool write(const std::wstring& path) const;
+
+  // rebuilds a structure from the given file and fills `tags`; returns null if
+  // the file doesn't exist or is invalid
+  //
+  static std::unique_ptr<DirectoryEntry> load(const std::wstring& path, Tags& tags);
+
+private:
+  struct Writer;
+  std::unique_ptr<Writer> m_Data;
+
+  static void addDirectory(Writer& w, const DirectoryEntry& d, uint32_t parent);
+
+  static std::unique_ptr<DirectoryEntry> load(const unsigned char* data,
+                                              std::size_t size, Tags& tags);
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_DIRECTORYSNAPSHOT_INCLUDED
@@ -10,8 +10,8 @@ FileEntry::FileEntry()
       m_FileSize(NoFileSize), m_CompressedFileSize(NoFileSize)
 {}
 
-FileEntry::FileEntry(FileIndex index, std::wstring name, DirectoryEntry* parent)
-    : m_Index(index), m_Name(std::move(name)), m_Origin(-1), m_Archive(L"", -1),
+FileEntry::FileEntry(FileIndex index, PooledString name, DirectoryEntry* parent)
+    : m_Index(index), m_Name(name), m_Origin(-1), m_Archive(L"", -1),
       m_Parent(parent), m_FileSize(NoFileSize), m_CompressedFileSize(NoFileSize)
 {}
 
@@ -29,10 +29,10 @@ void FileEntry::addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view
     // alternatives
     m_Origin   = origin;
     m_FileTime = fileTime;
-    m_Archive  = DataArchiveOrigin(std::wstring(archive.begin(), archive.end()), order);
+    m_Archive  = DataArchiveOrigin(archive, order);
   } else if ((m_Parent != nullptr) &&
-             ((m_Parent->getOriginByID(origin).getPriority() >
-               m_Parent->getOriginByID(m_Origin).getPriority()) ||
+             ((m_Parent->getOriginPriority(origin) >
+               m_Parent->getOriginPriority(m_Origin)) ||
               (archive.size() == 0 && m_Archive.isValid()))) {
     // If this mod has a higher priority than the origin mod OR
     // this mod has a loose file and the origin mod has an archived file,
@@ -49,7 +49,7 @@ void FileEntry::addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view
 
     m_Origin   = origin;
     m_FileTime = fileTime;
-    m_Archive  = DataArchiveOrigin(std::wstring(archive.begin(), archive.end()), order);
+    m_Archive  = DataArchiveOrigin(archive, order);
   } else {
     // This mod is just an alternative
     bool found = false;
@@ -66,22 +66,39 @@ void FileEntry::addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view
       }
 
       if ((m_Parent != nullptr) &&
-          (m_Parent->getOriginByID(iter->originID()).getPriority() <
-           m_Parent->getOriginByID(origin).getPriority())) {
-        m_Alternatives.insert(
-            iter, {origin, {std::wstring(archive.begin(), archive.end()), order}});
+          (m_Parent->getOriginPriority(iter->originID()) <
+           m_Parent->getOriginPriority(origin))) {
+        m_Alternatives.insert(iter, {origin, {archive, order}});
         found = true;
         break;
       }
     }
 
     if (!found) {
-      m_Alternatives.push_back(
-          {origin, {std::wstring(archive.begin(), archive.end()), order}});
+      m_Alternatives.push_back({origin, {archive, order}});
     }
   }
 }
 
+void FileEntry::appendOrigin(OriginID origin, int priority, FILETIME fileTime)
+{
+  if (m_Origin != -1 && !m_Archive.isValid() &&
+      m_Parent->getOriginPriority(m_Origin) >= priority) {
+    // a loose file that isn't overridden, changed mods are added back to an
+    // existing structure in any order
+    addOrigin(origin, fileTime, L"", -1);
+    return;
+  }
+
+  if (m_Origin != -1) {
+    m_Alternatives.push_back({m_Origin, m_Archive});
+  }
+
+  m_Origin   = origin;
+  m_FileTime = fileTime;
+  m_Archive  = DataArchiveOrigin(L"", -1);
+}
+
 bool FileEntry::removeOrigin(OriginID origin)
 {
   std::scoped_lock lock(m_OriginsMutex);
@@ -94,8 +111,8 @@ bool FileEntry::removeOrigin(OriginID origin)
         if (iter->originID() != origin) {
           // Both files are not from archives.
           if (!iter->isFromArchive() && !currentIter->isFromArchive()) {
-            if ((m_Parent->getOriginByID(iter->originID()).getPriority() >
-                 m_Parent->getOriginByID(currentIter->originID()).getPriority())) {
+            if ((m_Parent->getOriginPriority(iter->originID()) >
+                 m_Parent->getOriginPriority(currentIter->originID()))) {
               currentIter = iter;
             }
           } else {
@@ -146,12 +163,12 @@ void FileEntry::sortOrigins()
 
   std::sort(m_Alternatives.begin(), m_Alternatives.end(), [&](auto&& LHS, auto&& RHS) {
     if (!LHS.isFromArchive() && !RHS.isFromArchive()) {
-      int l = m_Parent->getOriginByID(LHS.originID()).getPriority();
+      int l = m_Parent->getOriginPriority(LHS.originID());
       if (l < 0) {
         l = INT_MAX;
       }
 
-      int r = m_Parent->getOriginByID(RHS.originID()).getPriority();
+      int r = m_Parent->getOriginPriority(RHS.originID());
       if (r < 0) {
         r = INT_MAX;
       }
@@ -225,7 +242,7 @@ std::wstring FileEntry::getFullPath(OriginID originID) const
   // all intermediate directories
   recurseParents(result, m_Parent);
 
-  return result + L"\\" + m_Name;
+  return result + L"\\" + m_Name.str();
 }
 
 std::wstring FileEntry::getRelativePath() const
@@ -235,7 +252,7 @@ std::wstring FileEntry::getRelativePath() const
   // all intermediate directories
   recurseParents(result, m_Parent);
 
-  return result + L"\\" + m_Name;
+  return result + L"\\" + m_Name.str();
 }
 
 bool FileEntry::recurseParents(std::wstring& path, const DirectoryEntry* parent) const
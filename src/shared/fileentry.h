@@ -1,6 +1,7 @@
 #ifndef MO_REGISTER_FILEENTRY_INCLUDED
 #define MO_REGISTER_FILEENTRY_INCLUDED
 
+#include "../thread_utils.h"
 #include "fileregisterfwd.h"
 
 namespace MOShared
@@ -12,7 +13,7 @@ public:
   static constexpr uint64_t NoFileSize = std::numeric_limits<uint64_t>::max();
 
   FileEntry();
-  FileEntry(FileIndex index, std::wstring name, DirectoryEntry* parent);
+  FileEntry(FileIndex index, PooledString name, DirectoryEntry* parent);
 
   // noncopyable
   FileEntry(const FileEntry&)            = delete;
@@ -23,6 +24,18 @@ public:
   void addOrigin(OriginID origin, FILETIME fileTime, std::wstring_view archive,
                  int order);
 
+  // adds a loose file from an origin that is expected to override all the
+  // current ones, which is the case when mods are added by increasing
+  // priority; the current origin is appended to the alternatives without
+  // looking at them, and falls back to addOrigin() if the expectation doesn't
+  // hold
+  //
+  // doesn't lock or propagate the origin to the parent directories, the
+  // caller does it once per directory; only for a structure that is being
+  // built by a single thread
+  //
+  void appendOrigin(OriginID origin, int priority, FILETIME fileTime);
+
   // remove the specified origin from the list of origins that contain this
   // file. if no origin is left, the file is effectively deleted and true is
   // returned. otherwise, false is returned
@@ -35,7 +48,9 @@ public:
   // (ascending)
   const AlternativesVector& getAlternatives() const { return m_Alternatives; }
 
-  const std::wstring& getName() const { return m_Name; }
+  const std::wstring& getName() const { return m_Name.str(); }
+
+  const PooledString& getPooledName() const { return m_Name; }
 
   OriginID getOrigin() const { return m_Origin; }
 
@@ -73,15 +88,17 @@ public:
   uint64_t getCompressedFileSize() const { return m_CompressedFileSize; }
 
 private:
+  friend class DirectorySnapshot;
+
   FileIndex m_Index;
-  std::wstring m_Name;
+  PooledString m_Name;
   OriginID m_Origin;
   DataArchiveOrigin m_Archive;
   AlternativesVector m_Alternatives;
   DirectoryEntry* m_Parent;
   mutable FILETIME m_FileTime;
   uint64_t m_FileSize, m_CompressedFileSize;
-  mutable std::mutex m_OriginsMutex;
+  mutable CompactMutex m_OriginsMutex;
 
   bool recurseParents(std::wstring& path, const DirectoryEntry* parent) const;
 };
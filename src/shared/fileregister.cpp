@@ -10,38 +10,80 @@ namespace MOShared
 
 using namespace MOBase;
 
+enum class SlotState : uint8_t
+{
+  // nothing was ever constructed in this slot
+  Empty = 0,
+
+  // the file is constructed and visible
+  Alive,
+
+  // the file was removed, but is still constructed because there might be
+  // pointers to it
+  Removed
+};
+
+struct FileRegister::Slot
+{
+  alignas(FileEntry) unsigned char storage[sizeof(FileEntry)];
+  std::atomic<SlotState> state = SlotState::Empty;
+
+  FileEntry* entry() { return std::launder(reinterpret_cast<FileEntry*>(storage)); }
+};
+
+struct FileRegister::Chunk
+{
+  Slot slots[ChunkSize];
+};
+
 FileRegister::FileRegister(boost::shared_ptr<OriginConnection> originConnection)
-    : m_OriginConnection(originConnection), m_NextIndex(0)
+    : m_Chunks(new std::atomic<Chunk*>[MaxChunks]()),
+      m_OriginConnection(originConnection), m_NextIndex(0), m_RemovedCount(0)
 {}
 
-bool FileRegister::indexValid(FileIndex index) const
+FileRegister::~FileRegister()
 {
-  std::scoped_lock lock(m_Mutex);
+  for (std::size_t c = 0; c < MaxChunks; ++c) {
+    Chunk* chunk = m_Chunks[c].load(std::memory_order_acquire);
+    if (!chunk) {
+      continue;
+    }
 
-  if (index < m_Files.size()) {
-    return (m_Files[index].get() != nullptr);
+    for (auto& s : chunk->slots) {
+      if (s.state.load(std::memory_order_acquire) != SlotState::Empty) {
+        s.entry()->~FileEntry();
+      }
+    }
+
+    delete chunk;
   }
+}
 
-  return false;
+bool FileRegister::indexValid(FileIndex index) const
+{
+  return (fileAt(index) != nullptr);
 }
 
-FileEntryPtr FileRegister::createFile(std::wstring name, DirectoryEntry* parent,
-                                      DirectoryStats& stats)
+FileEntry* FileRegister::createFile(PooledString name, DirectoryEntry* parent,
+                                    DirectoryStats& stats)
 {
   const auto index = generateIndex();
-  auto p           = FileEntryPtr(new FileEntry(index, std::move(name), parent));
 
-  {
-    std::scoped_lock lock(m_Mutex);
+  if (index >= MaxFiles) {
+    throw std::runtime_error(
+        QObject::tr("too many files in the register").toStdString());
+  }
 
-    if (index >= m_Files.size()) {
-      m_Files.resize(index + 1);
-    }
+  Chunk* chunk = getOrCreateChunk(index >> ChunkBits);
+  Slot& s      = chunk->slots[index & (ChunkSize - 1)];
 
-    m_Files[index] = p;
-  }
+  auto* fe = new (s.storage) FileEntry(index, name, parent);
 
-  return p;
+  // publish
+  s.state.store(SlotState::Alive, std::memory_order_release);
+  ++stats.filesInsertedInRegister;
+
+  return fe;
 }
 
 FileIndex FileRegister::generateIndex()
@@ -49,12 +91,71 @@ FileIndex FileRegister::generateIndex()
   return m_NextIndex++;
 }
 
-FileEntryPtr FileRegister::getFile(FileIndex index) const
+FileRegister::Slot* FileRegister::slot(FileIndex index) const
+{
+  const std::size_t c = index >> ChunkBits;
+
+  if (c >= MaxChunks) {
+    return nullptr;
+  }
+
+  Chunk* chunk = m_Chunks[c].load(std::memory_order_acquire);
+  if (!chunk) {
+    return nullptr;
+  }
+
+  return &chunk->slots[index & (ChunkSize - 1)];
+}
+
+FileRegister::Chunk* FileRegister::getOrCreateChunk(std::size_t chunkIndex)
+{
+  Chunk* chunk = m_Chunks[chunkIndex].load(std::memory_order_acquire);
+  if (chunk) {
+    return chunk;
+  }
+
+  // several threads might race to create the same chunk, only one wins
+  auto* fresh = new Chunk;
+
+  if (m_Chunks[chunkIndex].compare_exchange_strong(chunk, fresh,
+                                                   std::memory_order_acq_rel,
+                                                   std::memory_order_acquire)) {
+    return fresh;
+  }
+
+  delete fresh;
+  return chunk;
+}
+
+bool FileRegister::markRemoved(Slot& s)
+{
+  auto expected = SlotState::Alive;
+
+  if (s.state.compare_exchange_strong(expected, SlotState::Removed,
+                                      std::memory_order_acq_rel)) {
+    ++m_RemovedCount;
+    return true;
+  }
+
+  return false;
+}
+
+FileEntry* FileRegister::fileAt(FileIndex index) const
 {
-  std::scoped_lock lock(m_Mutex);
+  Slot* s = slot(index);
+
+  if (s && s->state.load(std::memory_order_acquire) == SlotState::Alive) {
+    return s->entry();
+  }
 
-  if (index < m_Files.size()) {
-    return m_Files[index];
+  return nullptr;
+}
+
+FileEntryPtr FileRegister::getFile(FileIndex index) const
+{
+  if (FileEntry* fe = fileAt(index)) {
+    // aliasing constructor, shares the register's control block
+    return FileEntryPtr(shared_from_this(), fe);
   } else {
     return {};
   }
@@ -62,66 +163,76 @@ FileEntryPtr FileRegister::getFile(FileIndex index) const
 
 bool FileRegister::removeFile(FileIndex index)
 {
-  std::scoped_lock lock(m_Mutex);
-
-  if (index < m_Files.size()) {
-    FileEntryPtr p;
-    m_Files[index].swap(p);
+  Slot* s = slot(index);
 
-    if (p) {
-      unregisterFile(p);
-      return true;
-    }
+  if (s && markRemoved(*s)) {
+    unregisterFile(s->entry());
+    return true;
   }
 
   log::error("{}: {}", QObject::tr("invalid file index for remove"), index);
   return false;
 }
 
-void FileRegister::removeOrigin(FileIndex index, OriginID originID)
+void FileRegister::removeFiles(std::set<FileIndex> indices)
 {
-  std::unique_lock lock(m_Mutex);
+  std::set<DirectoryEntry*> parents;
 
-  if (index < m_Files.size()) {
-    FileEntryPtr& p = m_Files[index];
+  for (auto iter = indices.begin(); iter != indices.end();) {
+    Slot* s = slot(*iter);
 
-    if (p) {
-      if (p->removeOrigin(originID)) {
-        m_Files[index] = {};
-        lock.unlock();
-        unregisterFile(p);
-        return;
-      }
+    if (!s || !markRemoved(*s)) {
+      log::error("{}: {}", QObject::tr("invalid file index for remove"), *iter);
+      iter = indices.erase(iter);
+      continue;
+    }
+
+    unregisterFromOrigins(s->entry());
+
+    if (s->entry()->getParent() != nullptr) {
+      parents.insert(s->entry()->getParent());
     }
+
+    ++iter;
   }
 
-  log::error("{}: {}", QObject::tr("invalid file index for remove (for origin)"),
-             index);
+  for (DirectoryEntry* parent : parents) {
+    parent->removeFiles(indices);
+  }
 }
 
-void FileRegister::removeOriginMulti(std::set<FileIndex> indices, OriginID originID)
+void FileRegister::removeOrigin(FileIndex index, OriginID originID)
 {
-  std::vector<FileEntryPtr> removedFiles;
+  Slot* s = slot(index);
 
-  {
-    std::scoped_lock lock(m_Mutex);
+  if (!s || s->state.load(std::memory_order_acquire) != SlotState::Alive) {
+    log::error("{}: {}", QObject::tr("invalid file index for remove (for origin)"),
+               index);
 
-    for (auto iter = indices.begin(); iter != indices.end();) {
-      const auto index = *iter;
+    return;
+  }
 
-      if (index < m_Files.size()) {
-        const auto& p = m_Files[index];
+  if (s->entry()->removeOrigin(originID) && markRemoved(*s)) {
+    unregisterFile(s->entry());
+  }
+}
 
-        if (p && p->removeOrigin(originID)) {
-          removedFiles.push_back(p);
-          m_Files[index] = {};
-          ++iter;
-          continue;
-        }
-      }
+void FileRegister::removeOriginMulti(std::set<FileIndex> indices, OriginID originID)
+{
+  std::vector<FileEntry*> removedFiles;
 
-      iter = indices.erase(iter);
+  for (auto iter = indices.begin(); iter != indices.end();) {
+    Slot* s = slot(*iter);
+
+    if (s && s->state.load(std::memory_order_acquire) == SlotState::Alive) {
+      if (s->entry()->removeOrigin(originID) && markRemoved(*s)) {
+        removedFiles.push_back(s->entry());
+        ++iter;
+        continue;
+      }
     }
+
+    iter = indices.erase(iter);
   }
 
   // optimization: this is only called when disabling an origin and in this case
@@ -139,7 +250,7 @@ void FileRegister::removeOriginMulti(std::set<FileIndex> indices, OriginID origi
   // frequently the case
 
   std::set<DirectoryEntry*> parents;
-  for (const FileEntryPtr& file : removedFiles) {
+  for (FileEntry* file : removedFiles) {
     if (file->getParent() != nullptr) {
       parents.insert(file->getParent());
     }
@@ -152,20 +263,29 @@ void FileRegister::removeOriginMulti(std::set<FileIndex> indices, OriginID origi
 
 void FileRegister::sortOrigins()
 {
-  std::scoped_lock lock(m_Mutex);
+  const auto count = static_cast<FileIndex>(highestCount());
 
-  for (auto&& p : m_Files) {
-    if (p) {
-      p->sortOrigins();
+  for (FileIndex i = 0; i < count; ++i) {
+    if (FileEntry* fe = fileAt(i)) {
+      fe->sortOrigins();
     }
   }
 }
 
-void FileRegister::unregisterFile(FileEntryPtr file)
+void FileRegister::unregisterFile(FileEntry* file)
+{
+  unregisterFromOrigins(file);
+
+  // unregister from directory
+  if (file->getParent() != nullptr) {
+    file->getParent()->removeFile(file->getIndex());
+  }
+}
+
+void FileRegister::unregisterFromOrigins(FileEntry* file)
 {
   bool ignore;
 
-  // unregister from origin
   OriginID originID = file->getOrigin(ignore);
   m_OriginConnection->getByID(originID).removeFile(file->getIndex());
   const auto& alternatives = file->getAlternatives();
@@ -173,11 +293,6 @@ void FileRegister::unregisterFile(FileEntryPtr file)
   for (const auto& alt : alternatives) {
     m_OriginConnection->getByID(alt.originID()).removeFile(file->getIndex());
   }
-
-  // unregister from directory
-  if (file->getParent() != nullptr) {
-    file->getParent()->removeFile(file->getIndex());
-  }
 }
 
 }  // namespace MOShared
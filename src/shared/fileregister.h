@@ -2,16 +2,37 @@
 #define MO_REGISTER_FILESREGISTER_INCLUDED
 
 #include "fileregisterfwd.h"
+#include <boost/enable_shared_from_this.hpp>
 #include <boost/shared_ptr.hpp>
 #include <mutex>
 
 namespace MOShared
 {
 
-class FileRegister
+// owns all the files of a structure
+//
+// files are stored in fixed-size chunks that are allocated on demand and never
+// moved or freed until the register is destroyed; a new file gets the next
+// index and is published atomically once constructed, so looking up files
+// never takes a lock and indices and pointers stay valid for the lifetime of
+// the register
+//
+// removed files are only flagged as such, their memory is reclaimed when the
+// register is destroyed; slots can't be reused because readers don't lock and
+// indices of removed files can still be around, in origins or in the indices
+// built over a structure, and would silently point to another file
+//
+// the waste is bounded by the refresher instead: an incremental refresh only
+// updates a structure while tooManyRemoved() is false, otherwise it builds a
+// new structure from scratch, which comes with a new register; pointers from
+// getFile() keep the whole register alive, so they shouldn't be held on to
+// once the structure has been replaced
+//
+class FileRegister : public boost::enable_shared_from_this<FileRegister>
 {
 public:
   FileRegister(boost::shared_ptr<OriginConnection> originConnection);
+  ~FileRegister();
 
   // noncopyable
   FileRegister(const FileRegister&)            = delete;
@@ -19,32 +40,68 @@ public:
 
   bool indexValid(FileIndex index) const;
 
-  FileEntryPtr createFile(std::wstring name, DirectoryEntry* parent,
-                          DirectoryStats& stats);
+  // the returned file is owned by the register
+  //
+  FileEntry* createFile(PooledString name, DirectoryEntry* parent,
+                        DirectoryStats& stats);
 
+  // the returned pointer keeps the register alive, but doesn't have its own
+  // control block
+  //
   FileEntryPtr getFile(FileIndex index) const;
 
-  size_t highestCount() const
-  {
-    std::scoped_lock lock(m_Mutex);
-    return m_Files.size();
-  }
+  // same as getFile(), but without touching any reference count; the pointer
+  // is valid as long as the register is alive
+  //
+  FileEntry* fileAt(FileIndex index) const;
+
+  // number of indices given out so far, including removed files
+  //
+  size_t highestCount() const { return std::min<FileIndex>(m_NextIndex, MaxFiles); }
+
+  // number of files that have been removed
+  //
+  size_t removedCount() const { return m_RemovedCount; }
+
+  // whether removed files take more than half of the indices given out so
+  // far, in which case the register should be replaced instead of growing
+  //
+  bool tooManyRemoved() const { return (removedCount() > highestCount() / 2); }
 
   bool removeFile(FileIndex index);
+
+  // removes all the given files, each parent directory is updated once instead
+  // of once per file
+  //
+  void removeFiles(std::set<FileIndex> indices);
+
   void removeOrigin(FileIndex index, OriginID originID);
   void removeOriginMulti(std::set<FileIndex> indices, OriginID originID);
 
   void sortOrigins();
 
 private:
-  using FileMap = std::deque<FileEntryPtr>;
+  static constexpr std::size_t ChunkBits = 12;
+  static constexpr std::size_t ChunkSize = std::size_t(1) << ChunkBits;
+  static constexpr std::size_t MaxChunks = std::size_t(1) << 16;
+  static constexpr std::size_t MaxFiles  = ChunkSize * MaxChunks;
+
+  struct Slot;
+  struct Chunk;
 
-  mutable std::mutex m_Mutex;
-  FileMap m_Files;
+  std::unique_ptr<std::atomic<Chunk*>[]> m_Chunks;
   boost::shared_ptr<OriginConnection> m_OriginConnection;
   std::atomic<FileIndex> m_NextIndex;
+  std::atomic<std::size_t> m_RemovedCount;
+
+  Slot* slot(FileIndex index) const;
+  Chunk* getOrCreateChunk(std::size_t chunkIndex);
+
+  // flags the file as removed, returns false if it was already removed
+  bool markRemoved(Slot& s);
 
-  void unregisterFile(FileEntryPtr file);
+  void unregisterFile(FileEntry* file);
+  void unregisterFromOrigins(FileEntry* file);
   FileIndex generateIndex();
 };
 
@@ -1,6 +1,9 @@
 #ifndef MO_REGISTER_FILEREGISTERFWD_INCLUDED
 #define MO_REGISTER_FILEREGISTERFWD_INCLUDED
 
+#include "stringpool.h"
+#include <boost/container/small_vector.hpp>
+
 class DirectoryRefreshProgress;
 
 namespace MOShared
@@ -12,9 +15,9 @@ struct DirectoryEntryFileKey
 
   bool operator==(const DirectoryEntryFileKey& o) const { return (value == o.value); }
 
-  static std::size_t getHash(const std::wstring& value)
+  static std::size_t getHash(std::wstring_view value)
   {
-    return std::hash<std::wstring>()(value);
+    return hashCaseFolded(value);
   }
 
   std::wstring value;
@@ -22,6 +25,7 @@ struct DirectoryEntryFileKey
 };
 
 class DirectoryEntry;
+class DirectorySnapshot;
 class OriginConnection;
 class FileRegister;
 class FilesOrigin;
@@ -39,21 +43,25 @@ constexpr OriginID InvalidOriginID   = -1;
 // is the order of the associated plugin in the plugins list
 // is a file is not in an archive, archiveName is empty and order is usually
 // -1
+//
+// archive names are pooled, every file from the same archive shares one copy
 class DataArchiveOrigin
 {
-  std::wstring name_ = L"";
-  int order_         = -1;
+  PooledString name_;
+  int order_ = -1;
 
 public:
   int order() const { return order_; }
-  const std::wstring& name() const { return name_; }
+  const std::wstring& name() const { return name_.str(); }
 
-  bool isValid() const { return name_.size() > 0; }
+  bool isValid() const { return !name_.empty(); }
 
-  DataArchiveOrigin(std::wstring name, int order)
-      : name_(std::move(name)), order_(order)
+  DataArchiveOrigin(std::wstring_view name, int order)
+      : name_(StringPool::instance().intern(name)), order_(order)
   {}
 
+  DataArchiveOrigin(PooledString name, int order) : name_(name), order_(order) {}
+
   DataArchiveOrigin() = default;
 };
 
@@ -75,7 +83,61 @@ public:
   {}
 };
 
-using AlternativesVector = std::vector<FileAlternative>;
+// most files have at most one alternative, which is kept inline
+using AlternativesVector = boost::container::small_vector<FileAlternative, 1>;
+
+// cheap summary of the loose files an origin had on disk the last time it was
+// walked: names, times and sizes of everything in it
+//
+// every directory is hashed on its own, seeded with its path, and the origin's
+// hash is the sum of those, so it doesn't depend on the order in which
+// directories are walked
+//
+// the refresher compares the fingerprint stored in an origin with a fresh one
+// to decide whether the origin has to be re-added to the structure
+//
+class OriginFingerprint
+{
+public:
+  OriginFingerprint() = default;
+
+  OriginFingerprint(uint64_t hash, uint64_t fileCount, uint64_t totalSize)
+      : m_Hash(hash), m_FileCount(fileCount), m_TotalSize(totalSize), m_Open()
+  {}
+
+  void addDirectory(std::wstring_view name);
+  void endDirectory();
+  void addFile(std::wstring_view name, FILETIME ft, uint64_t size);
+
+  uint64_t hash() const;
+  uint64_t fileCount() const { return m_FileCount; }
+  uint64_t totalSize() const { return m_TotalSize; }
+
+  bool operator==(const OriginFingerprint& o) const;
+
+private:
+  static constexpr uint64_t Basis = 14695981039346656037ull;
+
+  struct Directory
+  {
+    // hash of the path, relative to the origin
+    uint64_t path;
+
+    // seeded with the path
+    uint64_t contents;
+  };
+
+  // sum of the directories that have been ended
+  uint64_t m_Hash      = 0;
+  uint64_t m_FileCount = 0;
+  uint64_t m_TotalSize = 0;
+
+  // directories being walked, the root is at the bottom
+  std::vector<Directory> m_Open = {{Basis, Basis}};
+
+  // directory for the given subdirectory of the current one
+  Directory child(std::wstring_view name) const;
+};
 
 struct DirectoryStats
 {
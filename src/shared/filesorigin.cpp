@@ -15,6 +15,94 @@ std::wstring tail(const std::wstring& source, const size_t count)
   return source.substr(source.length() - count);
 }
 
+namespace
+{
+
+// fnv-1a
+//
+void combine(uint64_t& hash, const void* data, std::size_t size)
+{
+  const auto* p = static_cast<const unsigned char*>(data);
+
+  for (std::size_t i = 0; i < size; ++i) {
+    hash ^= p[i];
+    hash *= 1099511628211ull;
+  }
+}
+
+// spreads the bits of a directory's hash before it's added to the sum, so
+// similar directories don't cancel each other out
+//
+uint64_t mix(uint64_t h)
+{
+  h ^= h >> 30;
+  h *= 0xbf58476d1ce4e5b9ull;
+  h ^= h >> 27;
+  h *= 0x94d049bb133111ebull;
+  h ^= h >> 31;
+
+  return h;
+}
+
+}  // namespace
+
+void OriginFingerprint::addDirectory(std::wstring_view name)
+{
+  m_Open.push_back(child(name));
+}
+
+void OriginFingerprint::endDirectory()
+{
+  if (m_Open.empty()) {
+    return;
+  }
+
+  m_Hash += mix(m_Open.back().contents);
+  m_Open.pop_back();
+}
+
+void OriginFingerprint::addFile(std::wstring_view name, FILETIME ft, uint64_t size)
+{
+  if (m_Open.empty()) {
+    return;
+  }
+
+  auto& h = m_Open.back().contents;
+  combine(h, name.data(), name.size() * sizeof(wchar_t));
+  combine(h, &ft, sizeof(ft));
+  combine(h, &size, sizeof(size));
+
+  ++m_FileCount;
+  m_TotalSize += size;
+}
+
+uint64_t OriginFingerprint::hash() const
+{
+  uint64_t h = m_Hash;
+
+  for (auto&& d : m_Open) {
+    h += mix(d.contents);
+  }
+
+  return h;
+}
+
+OriginFingerprint::Directory
+OriginFingerprint::child(std::wstring_view name) const
+{
+  uint64_t path = m_Open.empty() ? Basis : m_Open.back().path;
+  combine(path, L"\\", sizeof(wchar_t));
+  combine(path, name.data(), name.size() * sizeof(wchar_t));
+
+  return {path, path};
+}
+
+bool OriginFingerprint::operator==(const OriginFingerprint& o) const
+{
+  return hash() == o.hash() && m_FileCount == o.m_FileCount &&
+         m_TotalSize == o.m_TotalSize;
+}
+
 FilesOrigin::FilesOrigin()
     : m_ID(0), m_Disabled(false), m_Name(), m_Path(), m_Priority(0)
 {}
@@ -30,6 +118,10 @@ FilesOrigin::FilesOrigin(OriginID ID, const std::wstring& name,
 void FilesOrigin::setPriority(int priority)
 {
   m_Priority = priority;
+
+  if (auto oc = m_OriginConnection.lock()) {
+    oc->changePriorityLookup(m_ID, priority);
+  }
 }
 
 void FilesOrigin::setName(const std::wstring& name)
@@ -51,6 +51,12 @@ public:
 
   bool containsArchive(std::wstring archiveName);
 
+  // fingerprint of the loose files found the last time this origin was walked,
+  // see DirectoryEntry::addFromOrigin()
+  //
+  const OriginFingerprint& fingerprint() const { return m_Fingerprint; }
+  void setFingerprint(const OriginFingerprint& fp) { m_Fingerprint = fp; }
+
 private:
   OriginID m_ID;
   bool m_Disabled;
@@ -58,6 +64,7 @@ private:
   std::wstring m_Name;
   std::wstring m_Path;
   int m_Priority;
+  OriginFingerprint m_Fingerprint;
   boost::weak_ptr<FileRegister> m_FileRegister;
   boost::weak_ptr<OriginConnection> m_OriginConnection;
   mutable std::mutex m_Mutex;
@@ -0,0 +1,261 @@
+#ifndef MO_REGISTER_FLATINDEX_INCLUDED
+#define MO_REGISTER_FLATINDEX_INCLUDED
+
+#include <ranges>
+
+namespace MOShared
+{
+
+// compact replacement for a sorted map and a hash map kept side by side:
+// values are stored once in a vector along with the hash of their key and an
+// open-addressing table of positions into that vector is used for lookups
+//
+// the index doesn't store keys; the caller gives a hash when adding and an
+// equality predicate when looking up, which lets directories compare against
+// the names already stored in their files and subdirectories
+//
+// values are appended while the structure is being built and freeze() sorts
+// them once it's done, so readers see them in order
+//
+template <class T>
+class FlatIndex
+{
+public:
+  struct Entry
+  {
+    std::size_t hash;
+    T value;
+  };
+
+  // range over the values, in order after freeze()
+  //
+  auto values() const { return std::views::transform(m_Entries, &Entry::value); }
+
+  std::size_t size() const { return m_Entries.size(); }
+  bool empty() const { return m_Entries.empty(); }
+
+  // returns the first value with the given hash for which eq(value) is true,
+  // or null
+  //
+  template <class Eq>
+  const T* find(std::size_t hash, Eq&& eq) const
+  {
+    if (m_Table.empty()) {
+      for (auto&& e : m_Entries) {
+        if (e.hash == hash && eq(e.value)) {
+          return &e.value;
+        }
+      }
+
+      return nullptr;
+    }
+
+    const std::size_t mask = m_Table.size() - 1;
+
+    for (std::size_t i = hash & mask;; i = (i + 1) & mask) {
+      const auto pos = m_Table[i];
+
+      if (pos == Empty) {
+        return nullptr;
+      }
+
+      const auto& e = m_Entries[pos];
+      if (e.hash == hash && eq(e.value)) {
+        return &e.value;
+      }
+    }
+  }
+
+  // adds a value without checking for duplicates; less(a, b) is only used to
+  // remember whether the values are still in order
+  //
+  template <class Less>
+  void add(std::size_t hash, T value, Less&& less)
+  {
+    if (m_Sorted && !m_Entries.empty() && less(value, m_Entries.back().value)) {
+      m_Sorted = false;
+    }
+
+    m_Entries.push_back({hash, std::move(value)});
+
+    if (m_Table.empty()) {
+      if (m_Entries.size() > LinearMax) {
+        rebuild();
+      }
+    } else if (m_Entries.size() * 2 > m_Table.size()) {
+      rebuild();
+    } else {
+      place(m_Entries.size() - 1);
+    }
+  }
+
+  // removes all the values for which pred(value) is true, returns how many
+  // were removed
+  //
+  template <class Pred>
+  std::size_t removeIf(Pred&& pred)
+  {
+    const auto n = std::erase_if(m_Entries, [&](auto&& e) {
+      return pred(e.value);
+    });
+
+    if (n > 0) {
+      rebuild();
+    }
+
+    return n;
+  }
+
+  // removes the first value for which pred(value) is true, returns false if
+  // there was none
+  //
+  // the table is patched instead of being rebuilt, so nothing is hashed again;
+  // this still moves the values that come after the removed one, use
+  // removeIf() to remove several values at once
+  //
+  template <class Pred>
+  bool removeOne(Pred&& pred)
+  {
+    auto itor = std::find_if(m_Entries.begin(), m_Entries.end(), [&](auto&& e) {
+      return pred(e.value);
+    });
+
+    if (itor == m_Entries.end()) {
+      return false;
+    }
+
+    const auto pos = static_cast<std::uint32_t>(itor - m_Entries.begin());
+
+    if (!m_Table.empty()) {
+      unplace(pos);
+    }
+
+    m_Entries.erase(itor);
+
+    if (m_Table.empty()) {
+      return true;
+    }
+
+    if (m_Entries.size() <= LinearMax) {
+      // drops the table
+      rebuild();
+      return true;
+    }
+
+    // entries after the removed one have moved down by one
+    for (auto& p : m_Table) {
+      if (p != Empty && p > pos) {
+        --p;
+      }
+    }
+
+    return true;
+  }
+
+  // sorts the values if anything was added out of order and releases unused
+  // capacity
+  //
+  template <class Less>
+  void freeze(Less&& less)
+  {
+    m_Entries.shrink_to_fit();
+
+    if (!m_Sorted) {
+      std::sort(m_Entries.begin(), m_Entries.end(), [&](auto&& a, auto&& b) {
+        return less(a.value, b.value);
+      });
+
+      m_Sorted = true;
+      rebuild();
+    }
+  }
+
+  void clear()
+  {
+    m_Entries = {};
+    m_Table   = {};
+    m_Sorted  = true;
+  }
+
+  // bytes allocated by this index
+  //
+  std::size_t memoryUsage() const
+  {
+    return m_Entries.capacity() * sizeof(Entry) +
+           m_Table.capacity() * sizeof(std::uint32_t);
+  }
+
+private:
+  static constexpr std::uint32_t Empty = UINT32_MAX;
+
+  // indices with this many values or less don't have a table and are searched
+  // linearly, which is the case for most directories
+  static constexpr std::size_t LinearMax = 8;
+
+  std::vector<Entry> m_Entries;
+  std::vector<std::uint32_t> m_Table;
+  bool m_Sorted = true;
+
+  void rebuild()
+  {
+    m_Table.clear();
+
+    if (m_Entries.size() <= LinearMax) {
+      m_Table.shrink_to_fit();
+      return;
+    }
+
+    // keeps the load factor at or below 0.5
+    std::size_t n = 16;
+    while (n < m_Entries.size() * 2) {
+      n *= 2;
+    }
+
+    m_Table.assign(n, Empty);
+
+    for (std::size_t i = 0; i < m_Entries.size(); ++i) {
+      place(i);
+    }
+  }
+
+  void place(std::size_t pos)
+  {
+    const std::size_t mask = m_Table.size() - 1;
+    std::size_t i          = m_Entries[pos].hash & mask;
+
+    while (m_Table[i] != Empty) {
+      i = (i + 1) & mask;
+    }
+
+    m_Table[i] = static_cast<std::uint32_t>(pos);
+  }
+
+  // removes the given position from the table with backward shift deletion,
+  // entries that come after it in their probe sequence are moved up so lookups
+  // never stop early on the hole
+  void unplace(std::uint32_t pos)
+  {
+    const std::size_t mask = m_Table.size() - 1;
+    std::size_t i          = m_Entries[pos].hash & mask;
+
+    while (m_Table[i] != pos) {
+      i = (i + 1) & mask;
+    }
+
+    for (std::size_t j = (i + 1) & mask; m_Table[j] != Empty; j = (j + 1) & mask) {
+      const std::size_t home = m_Entries[m_Table[j]].hash & mask;
+
+      // the entry at j can only move to i if i is between its home and j
+      if (((j - home) & mask) >= ((j - i) & mask)) {
+        m_Table[i] = m_Table[j];
+        i          = j;
+      }
+    }
+
+    m_Table[i] = Empty;
+  }
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_FLATINDEX_INCLUDED
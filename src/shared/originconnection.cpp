@@ -8,7 +8,19 @@ namespace MOShared
 
 using namespace MOBase;
 
-OriginConnection::OriginConnection() : m_NextID(0) {}
+OriginConnection::OriginConnection() : m_Chunks(new std::atomic<Chunk*>[MaxChunks])
+{
+  for (std::size_t i = 0; i < MaxChunks; ++i) {
+    m_Chunks[i].store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+OriginConnection::~OriginConnection()
+{
+  for (std::size_t i = 0; i < MaxChunks; ++i) {
+    delete m_Chunks[i].load(std::memory_order_relaxed);
+  }
+}
 
 std::pair<FilesOrigin&, bool> OriginConnection::getOrCreate(
     const std::wstring& originName, const std::wstring& directory, int priority,
@@ -25,7 +37,7 @@ std::pair<FilesOrigin&, bool> OriginConnection::getOrCreate(
 
     return {origin, true};
   } else {
-    FilesOrigin& origin = m_Origins[itor->second];
+    FilesOrigin& origin = m_Origins[static_cast<std::size_t>(itor->second)];
     lock.unlock();
 
     origin.enable(true, stats);
@@ -53,20 +65,28 @@ bool OriginConnection::exists(const std::wstring& name)
 
 FilesOrigin& OriginConnection::getByID(OriginID ID)
 {
-  std::scoped_lock lock(m_Mutex);
-  return m_Origins[ID];
+  // this used to create an empty origin for unknown ids, which happens when
+  // files that lost all their origins are unregistered
+  if (const Slot* s = slot(ID)) {
+    return *s->origin.load(std::memory_order_acquire);
+  }
+
+  return m_InvalidOrigin;
 }
 
 const FilesOrigin* OriginConnection::findByID(OriginID ID) const
 {
-  std::scoped_lock lock(m_Mutex);
+  if (const Slot* s = slot(ID)) {
+    return s->origin.load(std::memory_order_acquire);
+  }
 
-  auto itor = m_Origins.find(ID);
+  return nullptr;
+}
 
-  if (itor == m_Origins.end()) {
-    return nullptr;
-  } else {
-    return &itor->second;
+void OriginConnection::changePriorityLookup(OriginID ID, int priority)
+{
+  if (const Slot* s = slot(ID)) {
+    const_cast<Slot*>(s)->priority.store(priority, std::memory_order_release);
   }
 }
 
@@ -77,7 +97,7 @@ FilesOrigin& OriginConnection::getByName(const std::wstring& name)
   auto iter = m_OriginsNameMap.find(name);
 
   if (iter != m_OriginsNameMap.end()) {
-    return m_Origins[iter->second];
+    return m_Origins[static_cast<std::size_t>(iter->second)];
   } else {
     std::ostringstream stream;
     stream << QObject::tr("invalid origin name: ").toStdString()
@@ -103,27 +123,37 @@ void OriginConnection::changeNameLookup(const std::wstring& oldName,
   }
 }
 
-OriginID OriginConnection::createID()
-{
-  return m_NextID++;
-}
-
 FilesOrigin& OriginConnection::createOriginNoLock(
     const std::wstring& originName, const std::wstring& directory, int priority,
     boost::shared_ptr<FileRegister> fileRegister,
     boost::shared_ptr<OriginConnection> originConnection)
 {
-  OriginID newID = createID();
+  const auto index = m_Origins.size();
+
+  if (index >= ChunkSize * MaxChunks) {
+    throw std::runtime_error(QObject::tr("too many origins").toStdString());
+  }
+
+  const auto newID = static_cast<OriginID>(index);
+
+  FilesOrigin& origin = m_Origins.emplace_back(newID, originName, directory, priority,
+                                               fileRegister, originConnection);
+
+  auto& chunk = m_Chunks[index >> ChunkBits];
+  Chunk* c    = chunk.load(std::memory_order_relaxed);
+
+  if (!c) {
+    c = new Chunk;
+    chunk.store(c, std::memory_order_release);
+  }
 
-  auto itor = m_Origins
-                  .emplace(std::piecewise_construct, std::forward_as_tuple(newID),
-                           std::forward_as_tuple(newID, originName, directory, priority,
-                                                 fileRegister, originConnection))
-                  .first;
+  Slot& s = (*c)[index & (ChunkSize - 1)];
+  s.priority.store(priority, std::memory_order_relaxed);
+  s.origin.store(&origin, std::memory_order_release);
 
   m_OriginsNameMap.insert({originName, newID});
 
-  return itor->second;
+  return origin;
 }
 
 }  // namespace MOShared
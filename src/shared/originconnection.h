@@ -2,14 +2,20 @@
 #define MO_REGISTER_ORIGINCONNECTION_INCLUDED
 
 #include "fileregisterfwd.h"
+#include "filesorigin.h"
 
 namespace MOShared
 {
 
+// origins are stored in creation order and are never removed, so their ids
+// are indices; a chunked table maps ids to origins and priorities without
+// locking, which is what FileEntry uses when adding or sorting origins
+//
 class OriginConnection
 {
 public:
   OriginConnection();
+  ~OriginConnection();
 
   // noncopyable
   OriginConnection(const OriginConnection&)            = delete;
@@ -28,21 +34,83 @@ public:
 
   bool exists(const std::wstring& name);
 
+  // returns a dummy origin if the id doesn't exist
+  //
   FilesOrigin& getByID(OriginID ID);
+
   const FilesOrigin* findByID(OriginID ID) const;
   FilesOrigin& getByName(const std::wstring& name);
 
-  void changePriorityLookup(int oldPriority, int newPriority);
+  // priority of the given origin, 0 if it doesn't exist; doesn't lock
+  //
+  int getPriority(OriginID ID) const
+  {
+    const Slot* s = slot(ID);
+    return (s ? s->priority.load(std::memory_order_acquire) : 0);
+  }
+
+  // called by FilesOrigin::setPriority()
+  //
+  void changePriorityLookup(OriginID ID, int priority);
+
+  template <class F>
+  void forEachOrigin(F&& f)
+  {
+    std::scoped_lock lock(m_Mutex);
+
+    for (auto&& origin : m_Origins) {
+      f(origin);
+    }
+  }
 
   void changeNameLookup(const std::wstring& oldName, const std::wstring& newName);
 
 private:
-  std::atomic<OriginID> m_NextID;
-  std::map<OriginID, FilesOrigin> m_Origins;
+  static constexpr std::size_t ChunkBits = 8;
+  static constexpr std::size_t ChunkSize = std::size_t(1) << ChunkBits;
+  static constexpr std::size_t MaxChunks = std::size_t(1) << 12;
+
+  struct Slot
+  {
+    std::atomic<FilesOrigin*> origin = nullptr;
+    std::atomic<int> priority        = 0;
+  };
+
+  using Chunk = std::array<Slot, ChunkSize>;
+
+  // chunks are only created while holding m_Mutex, but are read without it
+  std::unique_ptr<std::atomic<Chunk*>[]> m_Chunks;
+
+  // in id order, stable addresses
+  std::deque<FilesOrigin> m_Origins;
+
   std::map<std::wstring, OriginID> m_OriginsNameMap;
+  FilesOrigin m_InvalidOrigin;
   mutable std::mutex m_Mutex;
 
-  OriginID createID();
+  const Slot* slot(OriginID ID) const
+  {
+    if (ID < 0) {
+      return nullptr;
+    }
+
+    const auto chunkIndex = static_cast<std::size_t>(ID) >> ChunkBits;
+    if (chunkIndex >= MaxChunks) {
+      return nullptr;
+    }
+
+    const Chunk* c = m_Chunks[chunkIndex].load(std::memory_order_acquire);
+    if (!c) {
+      return nullptr;
+    }
+
+    const Slot& s = (*c)[static_cast<std::size_t>(ID) & (ChunkSize - 1)];
+    if (!s.origin.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+
+    return &s;
+  }
 
   FilesOrigin& createOriginNoLock(const std::wstring& originName,
                                   const std::wstring& directory, int priority,
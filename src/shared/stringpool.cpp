@@ -0,0 +1,174 @@
+#include "stringpool.h"
+
+namespace MOShared
+{
+
+// lowercases `n` characters from `in` into `out`; ascii is handled here and
+// CharLowerBuffW() is only called when there's anything else, which gives the
+// same result as ToLowerCopy()
+//
+static void foldChunk(const wchar_t* in, std::size_t n, wchar_t* out)
+{
+  bool ascii = true;
+
+  for (std::size_t i = 0; i < n; ++i) {
+    const wchar_t c = in[i];
+
+    if (c >= L'A' && c <= L'Z') {
+      out[i] = c + (L'a' - L'A');
+    } else {
+      out[i] = c;
+      ascii  = ascii && (c < 0x80);
+    }
+  }
+
+  if (!ascii) {
+    CharLowerBuffW(out, static_cast<DWORD>(n));
+  }
+}
+
+// calls f(const wchar_t* folded, std::size_t n) for consecutive chunks of the
+// lowercase version of `s`
+//
+template <class F>
+static void forEachFoldedChunk(std::wstring_view s, F&& f)
+{
+  wchar_t buffer[64];
+
+  for (std::size_t i = 0; i < s.size(); i += std::size(buffer)) {
+    const auto n = std::min(std::size(buffer), s.size() - i);
+    foldChunk(s.data() + i, n, buffer);
+    f(buffer, n);
+  }
+}
+
+// fnv-1a offset basis, also the hash of an empty string
+static constexpr uint64_t EmptyHash = 14695981039346656037ull;
+
+std::size_t hashCaseFolded(std::wstring_view s)
+{
+  return hashCaseFolded(s, static_cast<std::size_t>(EmptyHash));
+}
+
+std::size_t hashCaseFolded(std::wstring_view s, std::size_t previous)
+{
+  // fnv-1a over utf-16 code units
+  uint64_t h = previous;
+
+  forEachFoldedChunk(s, [&](const wchar_t* folded, std::size_t n) {
+    for (std::size_t i = 0; i < n; ++i) {
+      h ^= static_cast<uint64_t>(folded[i]);
+      h *= 1099511628211ull;
+    }
+  });
+
+  return static_cast<std::size_t>(h);
+}
+
+bool equalsCaseFolded(std::wstring_view a, std::wstring_view b)
+{
+  if (a.size() != b.size()) {
+    return false;
+  }
+
+  wchar_t buffer[64];
+  std::size_t offset = 0;
+  bool equal         = true;
+
+  forEachFoldedChunk(a, [&](const wchar_t* folded, std::size_t n) {
+    if (!equal) {
+      return;
+    }
+
+    foldChunk(b.data() + offset, n, buffer);
+    equal = (std::wmemcmp(folded, buffer, n) == 0);
+    offset += n;
+  });
+
+  return equal;
+}
+
+const PooledString::Entry PooledString::Empty = {std::wstring(), EmptyHash};
+
+StringPool& StringPool::instance()
+{
+  static StringPool pool;
+  return pool;
+}
+
+PooledString StringPool::intern(std::wstring_view s)
+{
+  if (s.empty()) {
+    return {};
+  }
+
+  return intern(s, hashCaseFolded(s));
+}
+
+PooledString StringPool::intern(std::wstring_view s, std::size_t foldedHash)
+{
+  if (s.empty()) {
+    return {};
+  }
+
+  // the low bits of the hash are used by the index, the shard is picked from
+  // the high bits so entries are spread over the whole table
+  auto& shard = m_Shards[(static_cast<uint64_t>(foldedHash) >> 32) % ShardCount];
+
+  std::scoped_lock lock(shard.mutex);
+
+  // strings are case sensitive, but the folded hash is good enough to find
+  // candidates
+  auto* existing =
+      shard.index.find(foldedHash, [&](const PooledString::Entry* candidate) {
+        return (candidate->value == s);
+      });
+
+  if (existing) {
+    return PooledString(*existing);
+  }
+
+  auto& entry = shard.entries.emplace_back(
+      PooledString::Entry{std::wstring(s.begin(), s.end()), foldedHash});
+
+  shard.index.add(foldedHash, &entry, [](auto&&, auto&&) {
+    return false;
+  });
+
+  return PooledString(&entry);
+}
+
+std::size_t StringPool::size() const
+{
+  std::size_t n = 0;
+
+  for (auto&& shard : m_Shards) {
+    std::scoped_lock lock(shard.mutex);
+    n += shard.entries.size();
+  }
+
+  return n;
+}
+
+std::size_t StringPool::memoryUsage() const
+{
+  std::size_t n = 0;
+
+  for (auto&& shard : m_Shards) {
+    std::scoped_lock lock(shard.mutex);
+
+    n += shard.index.memoryUsage();
+    n += shard.entries.size() * sizeof(PooledString::Entry);
+
+    for (auto&& e : shard.entries) {
+      if (e.value.capacity() > 7) {
+        // heap allocation, small strings are stored inline
+        n += (e.value.capacity() + 1) * sizeof(wchar_t);
+      }
+    }
+  }
+
+  return n;
+}
+
+}  // namespace MOShared
@@ -0,0 +1,114 @@
+#ifndef MO_REGISTER_STRINGPOOL_INCLUDED
+#define MO_REGISTER_STRINGPOOL_INCLUDED
+
+#include "flatindex.h"
+#include <array>
+#include <deque>
+#include <mutex>
+
+namespace MOShared
+{
+
+// hash of the lowercase version of the given string, computed without
+// allocating; `s` doesn't have to be lowercase already
+//
+std::size_t hashCaseFolded(std::wstring_view s);
+
+// continues `previous`, a value returned by hashCaseFolded(), with `s`; the
+// result is the hash of both strings concatenated, which allows hashing a path
+// from the hash of its parent
+//
+std::size_t hashCaseFolded(std::wstring_view s, std::size_t previous);
+
+// whether both strings are equal once lowercased, without allocating
+//
+bool equalsCaseFolded(std::wstring_view a, std::wstring_view b);
+
+// handle to a string interned in the StringPool, same size as a pointer
+//
+// the string itself is never freed and its address is stable, so handles can
+// be copied around freely and getName()-style functions can keep returning
+// `const std::wstring&`
+//
+class PooledString
+{
+public:
+  PooledString() : m_Entry(&Empty) {}
+
+  const std::wstring& str() const { return m_Entry->value; }
+  std::wstring_view view() const { return m_Entry->value; }
+  bool empty() const { return m_Entry->value.empty(); }
+
+  // hashCaseFolded() of the string, computed once when it was interned
+  //
+  std::size_t foldedHash() const { return m_Entry->foldedHash; }
+
+  // all strings come from the same pool, so equal strings are the same entry
+  //
+  bool operator==(const PooledString& o) const { return (m_Entry == o.m_Entry); }
+
+private:
+  friend class StringPool;
+
+  struct Entry
+  {
+    std::wstring value;
+    std::size_t foldedHash;
+  };
+
+  static const Entry Empty;
+
+  const Entry* m_Entry;
+
+  explicit PooledString(const Entry* e) : m_Entry(e) {}
+};
+
+// process-wide pool of file, directory and archive names used by the
+// directory structure; the same name is stored only once no matter how many
+// entries or structures use it
+//
+// strings are never removed, the set of names seen by MO is expected to be
+// mostly the same from one refresh to the next
+//
+// the pool is split in shards that each have their own lock, which keeps
+// contention low when the refresher adds mods from multiple threads
+//
+class StringPool
+{
+public:
+  static StringPool& instance();
+
+  // returns the pooled copy of `s`, adding it if necessary
+  //
+  PooledString intern(std::wstring_view s);
+
+  // same, with a hash already computed by hashCaseFolded()
+  //
+  PooledString intern(std::wstring_view s, std::size_t foldedHash);
+
+  // number of strings in the pool
+  //
+  std::size_t size() const;
+
+  // approximate number of bytes used by the pool
+  //
+  std::size_t memoryUsage() const;
+
+private:
+  static constexpr std::size_t ShardCount = 64;
+
+  struct Shard
+  {
+    mutable std::mutex mutex;
+    std::deque<PooledString::Entry> entries;
+    FlatIndex<const PooledString::Entry*> index;
+  };
+
+  std::array<Shard, ShardCount> m_Shards;
+
+  StringPool() = default;
+};
+
+}  // namespace MOShared
+
+#endif  // MO_REGISTER_STRINGPOOL_INCLUDED
@@ -0,0 +1,150 @@
+#include "thread_utils.h"
+#include <algorithm>
+
+namespace MOShared
+{
+
+using namespace MOBase;
+
+// scheduler and queue of the current thread, if it's a scheduler thread
+static thread_local TaskScheduler* g_currentScheduler = nullptr;
+static thread_local std::size_t g_currentWorker       = 0;
+
+TaskScheduler::TaskScheduler(std::size_t threadCount)
+    : m_next(0), m_unclaimed(0), m_pending(0), m_stop(false)
+{
+  threadCount = std::max<std::size_t>(threadCount, 1);
+
+  for (std::size_t i = 0; i < threadCount; ++i) {
+    m_workers.push_back(std::make_unique<Worker>());
+  }
+
+  for (std::size_t i = 0; i < threadCount; ++i) {
+    m_workers[i]->thread = startSafeThread([this, i] {
+      run(i);
+    });
+  }
+}
+
+TaskScheduler::~TaskScheduler()
+{
+  wait();
+
+  {
+    std::scoped_lock lock(m_mutex);
+    m_stop = true;
+  }
+
+  m_available.notify_all();
+
+  for (auto& w : m_workers) {
+    w->thread.join();
+  }
+}
+
+void TaskScheduler::submit(Task task)
+{
+  std::size_t index = 0;
+
+  if (g_currentScheduler == this) {
+    index = g_currentWorker;
+  } else {
+    index = m_next++ % m_workers.size();
+  }
+
+  {
+    auto& w = *m_workers[index];
+    std::scoped_lock lock(w.mutex);
+    w.tasks.push_back(std::move(task));
+  }
+
+  {
+    std::scoped_lock lock(m_mutex);
+    ++m_unclaimed;
+    ++m_pending;
+  }
+
+  m_available.notify_one();
+}
+
+void TaskScheduler::wait()
+{
+  std::unique_lock lock(m_mutex);
+
+  m_done.wait(lock, [&] {
+    return m_pending == 0;
+  });
+}
+
+void TaskScheduler::run(std::size_t index)
+{
+  g_currentScheduler = this;
+  g_currentWorker    = index;
+
+  for (;;) {
+    {
+      std::unique_lock lock(m_mutex);
+
+      m_available.wait(lock, [&] {
+        return m_stop || m_unclaimed > 0;
+      });
+
+      if (m_unclaimed == 0) {
+        // stopping
+        break;
+      }
+
+      --m_unclaimed;
+    }
+
+    try {
+      take(index)();
+    } catch (std::exception& e) {
+      log::error("unhandled exception in task: {}", e.what());
+    }
+
+    {
+      std::scoped_lock lock(m_mutex);
+
+      if (--m_pending == 0) {
+        m_done.notify_all();
+      }
+    }
+  }
+
+  g_currentScheduler = nullptr;
+}
+
+TaskScheduler::Task TaskScheduler::take(std::size_t index)
+{
+  // a task was claimed, so the queues hold at least one task for this thread;
+  // another thread can take it while this one looks at other queues, but only
+  // if it claimed one too, so this just goes around again
+  for (;;) {
+    {
+      // newest task from this thread's queue
+      auto& w = *m_workers[index];
+      std::scoped_lock lock(w.mutex);
+
+      if (!w.tasks.empty()) {
+        Task t = std::move(w.tasks.back());
+        w.tasks.pop_back();
+        return t;
+      }
+    }
+
+    // oldest task from the other queues
+    for (std::size_t i = 1; i < m_workers.size(); ++i) {
+      auto& w = *m_workers[(index + i) % m_workers.size()];
+      std::scoped_lock lock(w.mutex);
+
+      if (!w.tasks.empty()) {
+        Task t = std::move(w.tasks.front());
+        w.tasks.pop_front();
+        return t;
+      }
+    }
+  }
+}
+
+}  // namespace MOShared
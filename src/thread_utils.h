@@ -1,6 +1,9 @@
 #ifndef MO2_THREAD_UTILS_H
 #define MO2_THREAD_UTILS_H
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
 #include <functional>
 #include <log.h>
 #include <mutex>
@@ -24,6 +27,98 @@ std::thread startSafeThread(F&& f)
   });
 }
 
+// a mutex that only takes a few bytes, for objects that exist in very large
+// numbers and are rarely contended; waiting threads block on the flag instead
+// of spinning
+//
+class CompactMutex
+{
+public:
+  void lock()
+  {
+    while (m_flag.test_and_set(std::memory_order_acquire)) {
+      m_flag.wait(true, std::memory_order_relaxed);
+    }
+  }
+
+  bool try_lock() { return !m_flag.test_and_set(std::memory_order_acquire); }
+
+  void unlock()
+  {
+    m_flag.clear(std::memory_order_release);
+    m_flag.notify_one();
+  }
+
+private:
+  std::atomic_flag m_flag;
+};
+
+// runs tasks on a fixed number of threads; every thread has its own queue and
+// takes tasks from the other queues when it runs out, so tasks that queue more
+// tasks, like walking a directory tree, end up spread over all the threads
+//
+// a task queued from a task goes on the current thread's queue and is run
+// before older ones, which keeps threads working on their own part of the
+// tree; idle threads steal the oldest tasks instead, which tend to be the
+// largest
+//
+// idle threads and wait() block on condition variables
+//
+class TaskScheduler
+{
+public:
+  using Task = std::function<void()>;
+
+  explicit TaskScheduler(std::size_t threadCount);
+
+  // waits for all the tasks and joins the threads
+  //
+  ~TaskScheduler();
+
+  // noncopyable
+  TaskScheduler(const TaskScheduler&)            = delete;
+  TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+  std::size_t threadCount() const { return m_workers.size(); }
+
+  // queues a task, can be called from any thread, including from a task;
+  // exceptions thrown by the task are logged
+  //
+  void submit(Task task);
+
+  // blocks until all the tasks have run, including the ones queued while
+  // waiting; must not be called from a task
+  //
+  void wait();
+
+private:
+  struct Worker
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<Worker>> m_workers;
+
+  // queue used by the next task submitted from outside the scheduler
+  std::atomic<std::size_t> m_next;
+
+  std::mutex m_mutex;
+  std::condition_variable m_available;
+  std::condition_variable m_done;
+
+  // tasks in the queues that no thread has claimed yet, and tasks that are
+  // queued or running; both guarded by m_mutex
+  std::size_t m_unclaimed;
+  std::size_t m_pending;
+
+  bool m_stop;
+
+  void run(std::size_t index);
+  Task take(std::size_t index);
+};
+
 /**
  * @brief Apply the given callable to each element between the two given iterators
  *     in a parallel way.
@@ -26,6 +26,7 @@ along with Mod Organizer.  If not, see <http://www.gnu.org/licenses/>.
 #include <QDateTime>
 #include <QProgressDialog>
 #include <QTemporaryFile>
+#include <algorithm>
 #include <iomanip>
 #include <memory>
 #include <qstandardpaths.h>
@@ -178,24 +179,54 @@ UsvfsConnector::~UsvfsConnector()
   m_WorkerThread.wait();
 }
 
+static bool sameMapping(const Mapping& a, const Mapping& b)
+{
+  return a.isDirectory == b.isDirectory && a.createTarget == b.createTarget &&
+         a.source == b.source && a.destination == b.destination;
+}
+
 void UsvfsConnector::updateMapping(const MappingType& mapping)
 {
   const auto start = std::chrono::high_resolution_clock::now();
 
+  // usvfs can't remove single links, but links that are added later take
+  // precedence over the others; if the current mappings are the start of the
+  // new ones, only the rest is linked
+  std::size_t first = 0;
+
+  if (!m_Mapping.empty() && m_Mapping.size() <= mapping.size() &&
+      std::equal(m_Mapping.begin(), m_Mapping.end(), mapping.begin(), sameMapping)) {
+    first = m_Mapping.size();
+  }
+
+  if (first > 0 && first == mapping.size()) {
+    log::debug("VFS mappings are unchanged");
+    return;
+  }
+
   QProgressDialog progress(qApp->activeWindow());
   progress.setLabelText(tr("Preparing vfs"));
-  progress.setMaximum(static_cast<int>(mapping.size()));
+  progress.setMaximum(static_cast<int>(mapping.size() - first));
   progress.show();
 
   int value = 0;
   int files = 0;
   int dirs  = 0;
 
-  log::debug("Updating VFS mappings...");
+  if (first == 0) {
+    log::debug("Updating VFS mappings...");
+    ClearVirtualMappings();
+  } else {
+    log::debug("Adding {} VFS mappings...", mapping.size() - first);
+  }
+
+  // forgotten until everything is linked, a failure links everything again
+  // next time
+  m_Mapping.clear();
 
-  ClearVirtualMappings();
+  for (auto itor = mapping.begin() + first; itor != mapping.end(); ++itor) {
+    const Mapping& map = *itor;
 
-  for (auto map : mapping) {
     if (progress.wasCanceled()) {
       ClearVirtualMappings();
       throw UsvfsConnectorException("VFS mapping canceled by user");
@@ -217,6 +248,8 @@ void UsvfsConnector::updateMapping(const MappingType& mapping)
     }
   }
 
+  m_Mapping = mapping;
+
   const auto end  = std::chrono::high_resolution_clock::now();
   const auto time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
 
@@ -224,6 +257,11 @@ void UsvfsConnector::updateMapping(const MappingType& mapping)
              time.count());
 }
 
+void UsvfsConnector::invalidateMapping()
+{
+  m_Mapping.clear();
+}
+
 void UsvfsConnector::updateParams(MOBase::log::Levels logLevel,
                                   env::CoreDumpTypes coreDumpType,
                                   const QString& crashDumpsPath,
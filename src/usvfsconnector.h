@@ -80,8 +80,16 @@ public:
   UsvfsConnector();
   ~UsvfsConnector();
 
+  // links the given mappings in the vfs; links that are already there are kept
+  // when the new mappings only add to them, see invalidateMapping()
+  //
   void updateMapping(const MappingType& mapping);
 
+  // the content of the mapped directories has changed, so the next call to
+  // updateMapping() links everything again
+  //
+  void invalidateMapping();
+
   void updateParams(MOBase::log::Levels logLevel, env::CoreDumpTypes coreDumpType,
                     const QString& crashDumpsPath, std::chrono::seconds spawnDelay,
                     QString executableBlacklist);
@@ -92,6 +100,9 @@ public:
 private:
   LogWorker m_LogWorker;
   QThread m_WorkerThread;
+
+  // mappings currently linked in the vfs
+  MappingType m_Mapping;
 };
 
 CrashDumpsType crashDumpsType(int type);